@@ -0,0 +1,204 @@
+// MatchBenchmark.cpp
+//
+// Plays synthetic multi-finger glissandi through TouchTracker::findTouches() and
+// matchTouches(): fingers on two neighboring rows slide back and forth in opposite
+// directions, so that every finger passes close by each finger of the other row, at the
+// speed of a quick glissando and at one fast enough to trouble a matcher. Reports the time
+// per match, the identity swaps, frames in which a tracked touch that stays down moves
+// from one finger to another, and the drops, frames in which it is lost. Each finger's true
+// position is where findTouches() puts it when it plays alone. Frames in which fingers are
+// too close to tell apart are not counted.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "SensorFrame.h"
+#include "TouchTracker.h"
+
+using namespace std::chrono;
+
+namespace
+{
+
+constexpr int kDefaultFrames = 5000;
+
+// the blob of each finger, as in the microbenchmarks.
+constexpr float kFingerPressure = 0.3f;
+constexpr float kFingerSpread = -0.5f;
+
+// finger rows and the range each finger slides over, in taxels. Positions are kept off the
+// halfway points between taxels, where a noiseless blob has two equal maxima and no peak.
+constexpr float kRowY[2] = {2.3f, 4.6f};
+constexpr float kMinX = 4.f;
+constexpr float kMaxX = 60.f;
+
+// finger speeds in taxels per frame: about 180 keys per second, and 1400.
+const float kSpeeds[] = {0.37f, 2.9f};
+
+struct Finger
+{
+	float x;
+	float y;
+};
+
+// the fingers of an n-finger glissando in frame i: half on each row, spread evenly along it,
+// each moving back and forth between kMinX and kMaxX, those on the second row the other way.
+std::vector<Finger> getFingers(int n, float speed, int i)
+{
+	std::vector<Finger> fingers;
+	const float range = kMaxX - kMinX;
+	for(int f=0; f<n; ++f)
+	{
+		const int row = f % 2;
+		const int perRow = (n + 1)/2;
+		const float start = range*(f/2 + 0.5f*row)/perRow;
+		float d = std::fmod(start + (row ? -1.f : 1.f)*speed*i, 2.f*range);
+		if(d < 0.f) d += 2.f*range;
+		const float x = kMinX + ((d < range) ? d : 2.f*range - d);
+		fingers.push_back(Finger{x, kRowY[row]});
+	}
+	return fingers;
+}
+
+void addFinger(SensorFrame& frame, const Finger& finger)
+{
+	for(int j=0; j<SensorGeometry::height; ++j)
+	{
+		for(int c=0; c<SensorGeometry::width; ++c)
+		{
+			const float dx = c - finger.x;
+			const float dy = j - finger.y;
+			frame[j*SensorGeometry::width + c] += kFingerPressure*std::exp(kFingerSpread*(dx*dx + dy*dy));
+		}
+	}
+}
+
+// the tracked position of each finger alone, with a preprocessor for each finger.
+std::vector<Touch> getTruePositions(TouchTracker& tracker, std::vector<TouchTracker>& preprocessors,
+	const std::vector<Finger>& fingers)
+{
+	std::vector<Touch> positions;
+	SensorFrame frame, curvature;
+	for(int f=0; f<static_cast<int>(fingers.size()); ++f)
+	{
+		fill(frame, 0.f);
+		addFinger(frame, fingers[f]);
+		preprocessors[f].preprocess(frame, curvature);
+		positions.push_back(tracker.findTouches(curvature)[0]);
+	}
+	return positions;
+}
+
+// the finger nearest a touch.
+int getFinger(const Touch& t, const std::vector<Touch>& positions)
+{
+	int nearest = 0;
+	float minDist = HUGE_VALF;
+	for(int f=0; f<static_cast<int>(positions.size()); ++f)
+	{
+		const float d = std::abs(t.x - positions[f].x) + std::abs(t.y - positions[f].y);
+		if(d < minDist)
+		{
+			minDist = d;
+			nearest = f;
+		}
+	}
+	return nearest;
+}
+
+struct Result
+{
+	double nanosPerMatch;
+	int swaps;
+	int drops;
+	int touchFrames;
+};
+
+Result run(int fingers, float speed, int frames)
+{
+	TouchTracker tracker;
+	tracker.setMaxTouches(fingers);
+	TouchTracker preprocessor;
+	std::vector<TouchTracker> fingerPreprocessors(fingers);
+
+	std::vector<TouchArray> found(frames);
+	std::vector<std::vector<Touch>> truth(frames);
+	SensorFrame frame, curvature;
+	for(int i=0; i<frames; ++i)
+	{
+		const std::vector<Finger> f = getFingers(fingers, speed, i);
+		fill(frame, 0.f);
+		for(const Finger& finger : f)
+		{
+			addFinger(frame, finger);
+		}
+		preprocessor.preprocess(frame, curvature);
+		found[i] = tracker.findTouches(curvature);
+		truth[i] = getTruePositions(tracker, fingerPreprocessors, f);
+	}
+
+	std::vector<TouchArray> matched(frames);
+	TouchArray previous{};
+	const auto start = steady_clock::now();
+	for(int i=0; i<frames; ++i)
+	{
+		matched[i] = tracker.matchTouches(found[i], previous);
+		previous = matched[i];
+	}
+	const double nanos = duration<double, std::nano>(steady_clock::now() - start).count();
+
+	// count the touches that stay down from one frame to the next but change fingers. The
+	// fingers never lift, so a touch that changes fingers is always a mistake, whether or not
+	// the matcher connects it to the touch before. Fingers close enough to make one peak
+	// leave the others nothing to be matched with, so only frames with all fingers found count.
+	auto allFound = [&](const TouchArray& t)
+	{
+		return std::count_if(t.begin(), t.begin() + fingers, [](const Touch& a){ return a.z > 0.f; }) == fingers;
+	};
+	int swaps = 0;
+	int drops = 0;
+	int touchFrames = 0;
+	for(int i=1; i<frames; ++i)
+	{
+		if(!allFound(found[i - 1]) || !allFound(found[i])) continue;
+		for(int t=0; t<fingers; ++t)
+		{
+			const Touch& a = matched[i - 1][t];
+			const Touch& b = matched[i][t];
+			if((a.z > 0.f) && (b.z > 0.f))
+			{
+				touchFrames++;
+				swaps += (getFinger(a, truth[i - 1]) != getFinger(b, truth[i]));
+			}
+			else if(a.z > 0.f)
+			{
+				// the touch was lost, a note off and on at the output.
+				touchFrames++;
+				drops++;
+			}
+		}
+	}
+	return Result{nanos/frames, swaps, drops, touchFrames};
+}
+
+}
+
+int main(int argc, const char* argv[])
+{
+	const int frames = (argc > 1) ? std::atoi(argv[1]) : kDefaultFrames;
+
+	for(float speed : kSpeeds)
+	{
+		for(int fingers : {2, 4, 8})
+		{
+			const Result r = run(fingers, speed, frames);
+			std::cout << fingers << " fingers at " << speed << " taxels/frame: " << r.nanosPerMatch << " ns/match, "
+				<< r.swaps << " identity swaps and " << r.drops << " drops in " << r.touchFrames << " touch frames\n";
+		}
+	}
+	return 0;
+}
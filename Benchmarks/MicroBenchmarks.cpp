@@ -0,0 +1,515 @@
+// MicroBenchmarks.cpp
+//
+// Microbenchmarks for each step of the per-frame processing path, from unpacking packets to
+// the zones, run on fixed synthetic frames so that results can be compared between builds.
+// Steps whose cost depends on the number of touches are run with 1, 4 and 16 touches, with the
+// tracker and zones of the touch capacity the client chooses for each number.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "LatencyTrace.h"
+#include "Microbenchmark.h"
+#include "Reclocker.h"
+#include "SensorFrame.h"
+#include "SoundplaneModelA.h"
+#include "TouchTracker.h"
+#include "Unpacker.h"
+#include "Zone.h"
+
+namespace
+{
+
+// frames in each synthetic sequence. A power of two, so that i & (kFrames - 1) cycles through them.
+constexpr int kFrames = 64;
+
+// packets per endpoint in each transfer, as the drivers request them.
+constexpr int kPacketsPerTransfer = 8;
+
+const std::vector<int> kTouchCounts{1, 4, 16};
+
+// calibrated frames with n touches, each a gaussian blob like SimulatedSoundplaneDriver
+// makes, moving slowly over the sequence, plus a little noise. Always the same frames.
+const std::vector<SensorFrame>& calibratedFrames(int n)
+{
+	static std::vector<SensorFrame> frames[kMaxTouches + 1];
+	std::vector<SensorFrame>& f = frames[n];
+	if(f.empty())
+	{
+		std::mt19937 gen(n);
+		std::uniform_real_distribution<float> noise(-0.002f, 0.002f);
+		const float k = -0.5f;
+		f.resize(kFrames);
+		for(int i=0; i<kFrames; ++i)
+		{
+			const float phase = 6.2831853f*i/kFrames;
+			for(int j=0; j<SensorGeometry::height; ++j)
+			{
+				for(int c=0; c<SensorGeometry::width; ++c)
+				{
+					float z = noise(gen);
+					for(int t=0; t<n; ++t)
+					{
+						// up to 8 touches across, in two rows.
+						const float x = 4.f + 8.f*(t % 8) + std::sin(phase + t);
+						const float y = 2.f + 3.f*(t / 8) + 0.5f*std::cos(phase + t);
+						const float pressure = 0.3f + 0.1f*std::sin(phase*2.f + t);
+						z += pressure*std::exp(k*((c - x)*(c - x) + (j - y)*(j - y)));
+					}
+					set(f[i], c, j, z);
+				}
+			}
+		}
+	}
+	return f;
+}
+
+const std::vector<SensorFrame>& preprocessedFrames(int n)
+{
+	static std::vector<SensorFrame> frames[kMaxTouches + 1];
+	std::vector<SensorFrame>& f = frames[n];
+	if(f.empty())
+	{
+		TouchTracker tracker;
+		for(const SensorFrame& in : calibratedFrames(n))
+		{
+			f.push_back(tracker.preprocess(in));
+		}
+	}
+	return f;
+}
+
+// preprocessed frames crowded with peaks, like those from a palm lying on the surface: a
+// bumpy plateau of pressure over most of the sensor. Always the same frames.
+const std::vector<SensorFrame>& crowdedFrames()
+{
+	static std::vector<SensorFrame> frames;
+	if(frames.empty())
+	{
+		std::mt19937 gen(0);
+		std::uniform_real_distribution<float> bump(0.f, 0.1f);
+		TouchTracker tracker;
+		for(int i=0; i<kFrames; ++i)
+		{
+			SensorFrame f;
+			for(auto& z : f)
+			{
+				z = 0.2f + bump(gen);
+			}
+			frames.push_back(tracker.preprocess(f));
+		}
+	}
+	return frames;
+}
+
+// the packets of both endpoints for the frames with n touches, raw = (calibrated + 1)*0.25.
+struct PackedFrames
+{
+	std::vector<SoundplaneADataPacket> packets[kSoundplaneANumEndpoints];
+};
+
+const PackedFrames& packedFrames(int n)
+{
+	static PackedFrames frames[kMaxTouches + 1];
+	PackedFrames& p = frames[n];
+	if(p.packets[0].empty())
+	{
+		for(auto& packets : p.packets)
+		{
+			packets.resize(kFrames);
+		}
+		for(int i=0; i<kFrames; ++i)
+		{
+			SensorFrame raw;
+			scaleOffset(raw, calibratedFrames(n)[i], 0.25f, 0.25f);
+			K1_pack_frame(raw, p.packets[0][i].packedData, p.packets[1][i].packedData);
+			p.packets[0][i].seqNum = p.packets[1][i].seqNum = i;
+		}
+	}
+	return p;
+}
+
+// nonzero frames to divide by.
+const SensorFrame& divisorFrame()
+{
+	static SensorFrame f = add(calibratedFrames(4)[0], 1.f);
+	return f;
+}
+
+// run fn(frame) on each of the calibrated frames with 4 touches in turn.
+template<typename Fn>
+void runOnFrames(Microbenchmark& b, Fn fn)
+{
+	const std::vector<SensorFrame>& frames = calibratedFrames(4);
+	b.run([&](int i) { fn(frames[i & (kFrames - 1)]); });
+}
+
+}
+
+// ----------------------------------------------------------------
+// unpacking
+
+SP_MICROBENCHMARK(K1_unpack_float2)
+{
+	PackedFrames p = packedFrames(4);
+	SensorFrame out;
+	b.run([&](int i)
+	{
+		const int f = i & (kFrames - 1);
+		K1_unpack_float2(p.packets[0][f].packedData, p.packets[1][f].packedData, out);
+		Microbenchmark::doNotOptimize(out);
+	});
+}
+
+SP_MICROBENCHMARK(K1_unpack_frame)
+{
+	const PackedFrames& p = packedFrames(4);
+	SensorFrame out;
+	b.run([&](int i)
+	{
+		const int f = i & (kFrames - 1);
+		K1_unpack_frame(p.packets[0][f].packedData, p.packets[1][f].packedData, out);
+		Microbenchmark::doNotOptimize(out);
+	});
+}
+
+// one transfer of kPacketsPerTransfer packets on each endpoint per call, matched into frames.
+SP_MICROBENCHMARK(Unpacker_gotTransfer)
+{
+	PackedFrames p = packedFrames(4);
+	float sink = 0.f;
+	Unpacker<kSoundplaneANumEndpoints> unpacker(kPacketsPerTransfer, [&](const SensorFrame& f, uint16_t) { sink += f[0]; });
+	b.setFramesPerCall(kPacketsPerTransfer);
+	b.run([&](int i)
+	{
+		const int first = (i*kPacketsPerTransfer) & (kFrames - 1);
+		for(auto& packets : p.packets)
+		{
+			// keep the sequence numbers increasing as the frames repeat.
+			for(int k=0; k<kPacketsPerTransfer; ++k)
+			{
+				packets[first + k].seqNum = i*kPacketsPerTransfer + k;
+			}
+		}
+		unpacker.gotTransfer(0, &p.packets[0][first], kPacketsPerTransfer);
+		unpacker.gotTransfer(1, &p.packets[1][first], kPacketsPerTransfer);
+	});
+	Microbenchmark::doNotOptimize(sink);
+}
+
+// one frame per call, with one frame missing from each sequence of kFrames, which the
+// Reclocker fills in.
+SP_MICROBENCHMARK(Reclocker_frame)
+{
+	const std::vector<SensorFrame>& frames = calibratedFrames(4);
+	float sink = 0.f;
+	std::chrono::steady_clock::time_point frameTime;
+	auto reclocker = makeReclocker([](uint16_t, uint16_t, int) {}, [&](const SensorFrame& f) { sink += f[0]; });
+	reclocker.setFrameTime(&frameTime);
+	b.run([&](int i)
+	{
+		const int f = i & (kFrames - 1);
+		if(f != kFrames/2)
+		{
+			reclocker(frames[f], static_cast<uint16_t>(i));
+		}
+	});
+	Microbenchmark::doNotOptimize(sink);
+	Microbenchmark::doNotOptimize(frameTime);
+}
+
+// ----------------------------------------------------------------
+// SensorFrame operations
+
+// each operation returning a new frame, and writing to an output frame.
+#define SP_SENSORFRAME_BENCHMARKS(name, op, ...) \
+	SP_MICROBENCHMARK(SensorFrame_##name) \
+	{ \
+		const SensorFrame& d = divisorFrame(); \
+		runOnFrames(b, [&](const SensorFrame& a) \
+		{ \
+			SensorFrame y = op(__VA_ARGS__); \
+			Microbenchmark::doNotOptimize(y); \
+		}); \
+		Microbenchmark::doNotOptimize(d); \
+	} \
+	SP_MICROBENCHMARK(SensorFrame_##name##_out) \
+	{ \
+		const SensorFrame& d = divisorFrame(); \
+		SensorFrame y; \
+		runOnFrames(b, [&](const SensorFrame& a) \
+		{ \
+			op(y, __VA_ARGS__); \
+			Microbenchmark::doNotOptimize(y); \
+		}); \
+		Microbenchmark::doNotOptimize(d); \
+	}
+
+SP_SENSORFRAME_BENCHMARKS(add, add, a, d)
+SP_SENSORFRAME_BENCHMARKS(subtract, subtract, a, d)
+SP_SENSORFRAME_BENCHMARKS(multiply, multiply, a, d)
+SP_SENSORFRAME_BENCHMARKS(divide, divide, a, d)
+SP_SENSORFRAME_BENCHMARKS(add_scalar, add, a, 0.5f)
+SP_SENSORFRAME_BENCHMARKS(subtract_scalar, subtract, a, 0.5f)
+SP_SENSORFRAME_BENCHMARKS(multiply_scalar, multiply, a, 0.25f)
+SP_SENSORFRAME_BENCHMARKS(divide_scalar, divide, a, 3.f)
+SP_SENSORFRAME_BENCHMARKS(fill, fill, a[0])
+SP_SENSORFRAME_BENCHMARKS(max, max, a, 0.f)
+SP_SENSORFRAME_BENCHMARKS(min, min, a, 0.f)
+SP_SENSORFRAME_BENCHMARKS(clamp, clamp, a, 0.f, 0.5f)
+SP_SENSORFRAME_BENCHMARKS(sqrt, sqrt, d)
+SP_SENSORFRAME_BENCHMARKS(getCurvatureX, getCurvatureX, a)
+SP_SENSORFRAME_BENCHMARKS(getCurvatureY, getCurvatureY, a)
+SP_SENSORFRAME_BENCHMARKS(getCurvatureXY, getCurvatureXY, a)
+SP_SENSORFRAME_BENCHMARKS(calibrate, calibrate, a, d)
+SP_SENSORFRAME_BENCHMARKS(smoothPressureX, smoothPressureX, a)
+SP_SENSORFRAME_BENCHMARKS(smoothPressureY, smoothPressureY, a)
+
+SP_MICROBENCHMARK(SensorFrame_axpy)
+{
+	SensorFrame y{};
+	runOnFrames(b, [&](const SensorFrame& a)
+	{
+		axpy(y, 0.25f, a);
+		Microbenchmark::doNotOptimize(y);
+	});
+}
+
+SP_MICROBENCHMARK(SensorFrame_scaleOffset)
+{
+	const SensorFrame& d = divisorFrame();
+	SensorFrame y;
+	runOnFrames(b, [&](const SensorFrame& a)
+	{
+		scaleOffset(y, a, d, -1.f);
+		Microbenchmark::doNotOptimize(y);
+	});
+}
+
+SP_MICROBENCHMARK(SensorFrame_getColumnSum)
+{
+	runOnFrames(b, [&](const SensorFrame& a)
+	{
+		float sum = 0.f;
+		for(int c=0; c<SensorGeometry::width; ++c)
+		{
+			sum += getColumnSum(a, c);
+		}
+		Microbenchmark::doNotOptimize(sum);
+	});
+}
+
+SP_MICROBENCHMARK(SensorFrameStats_accumulate)
+{
+	SensorFrameStats stats;
+	runOnFrames(b, [&](const SensorFrame& a)
+	{
+		stats.accumulate(a);
+	});
+	Microbenchmark::doNotOptimize(stats.mean()[0]);
+}
+
+// ----------------------------------------------------------------
+// TouchTracker
+
+// the benchmark of one capacity, for each capacity in Touch.h.
+typedef void (*CapacityBenchmark)(Microbenchmark& b);
+
+// run the benchmark of the touch capacity the client chooses for b.arg() touches.
+void runAtCapacity(Microbenchmark& b, CapacityBenchmark small, CapacityBenchmark medium, CapacityBenchmark large)
+{
+	const int capacity = getTouchCapacity(b.arg());
+	(capacity == kMinTouchCapacity ? small : (capacity == kDefaultTouchCapacity ? medium : large))(b);
+}
+
+SP_MICROBENCHMARK_ARGS(TouchTracker_preprocess, kTouchCounts)
+{
+	const std::vector<SensorFrame>& frames = calibratedFrames(b.arg());
+	TouchTracker tracker;
+	SensorFrame out;
+	b.run([&](int i)
+	{
+		tracker.preprocess(frames[i & (kFrames - 1)], out);
+		Microbenchmark::doNotOptimize(out);
+	});
+}
+
+template<int Capacity>
+void findTouches(Microbenchmark& b)
+{
+	const std::vector<SensorFrame>& frames = preprocessedFrames(b.arg());
+	TouchTrackerN<Capacity> tracker;
+	tracker.setMaxTouches(b.arg());
+	b.run([&](int i)
+	{
+		TouchArrayN<Capacity> t = tracker.findTouches(frames[i & (kFrames - 1)]);
+		Microbenchmark::doNotOptimize(t);
+	});
+}
+
+SP_MICROBENCHMARK_ARGS(TouchTracker_findTouches, kTouchCounts)
+{
+	runAtCapacity(b, findTouches<kMinTouchCapacity>, findTouches<kDefaultTouchCapacity>, findTouches<kMaxTouches>);
+}
+
+// findTouches() on crowded frames, keeping 1, 4 or 16 of the peaks.
+template<int Capacity>
+void findTouchesCrowded(Microbenchmark& b)
+{
+	const std::vector<SensorFrame>& frames = crowdedFrames();
+	TouchTrackerN<Capacity> tracker;
+	tracker.setMaxTouches(b.arg());
+	b.run([&](int i)
+	{
+		TouchArrayN<Capacity> t = tracker.findTouches(frames[i & (kFrames - 1)]);
+		Microbenchmark::doNotOptimize(t);
+	});
+}
+
+SP_MICROBENCHMARK_ARGS(TouchTracker_findTouchesCrowded, kTouchCounts)
+{
+	runAtCapacity(b, findTouchesCrowded<kMinTouchCapacity>, findTouchesCrowded<kDefaultTouchCapacity>,
+		findTouchesCrowded<kMaxTouches>);
+}
+
+template<int Capacity>
+void matchTouches(Microbenchmark& b)
+{
+	const std::vector<SensorFrame>& frames = preprocessedFrames(b.arg());
+	TouchTrackerN<Capacity> tracker;
+	tracker.setMaxTouches(b.arg());
+
+	// match the touches found in each frame to those in the one before.
+	std::vector<TouchArrayN<Capacity>> found;
+	for(const SensorFrame& f : frames)
+	{
+		found.push_back(tracker.findTouches(f));
+	}
+	b.run([&](int i)
+	{
+		const TouchArrayN<Capacity>& x = found[i & (kFrames - 1)];
+		const TouchArrayN<Capacity>& x1 = found[(i - 1) & (kFrames - 1)];
+		TouchArrayN<Capacity> t = tracker.matchTouches(x, x1);
+		Microbenchmark::doNotOptimize(t);
+	});
+}
+
+SP_MICROBENCHMARK_ARGS(TouchTracker_matchTouches, kTouchCounts)
+{
+	runAtCapacity(b, matchTouches<kMinTouchCapacity>, matchTouches<kDefaultTouchCapacity>, matchTouches<kMaxTouches>);
+}
+
+template<int Capacity>
+void process(Microbenchmark& b)
+{
+	const std::vector<SensorFrame>& frames = preprocessedFrames(b.arg());
+	TouchTrackerN<Capacity> tracker;
+	b.run([&](int i)
+	{
+		TouchArrayN<Capacity> t = tracker.process(frames[i & (kFrames - 1)], b.arg());
+		Microbenchmark::doNotOptimize(t);
+	});
+}
+
+SP_MICROBENCHMARK_ARGS(TouchTracker_process, kTouchCounts)
+{
+	runAtCapacity(b, process<kMinTouchCapacity>, process<kDefaultTouchCapacity>, process<kMaxTouches>);
+}
+
+// ----------------------------------------------------------------
+// Zone
+
+// one frame of touches in a note row zone covering the whole surface, as ZoneMap::process()
+// sends them: newFrame, addTouchToFrame, storeAnyNewTouches, then note offs and notes.
+template<int Capacity>
+void processTouchesNoteRow(Microbenchmark& b)
+{
+	const int n = b.arg();
+	ZoneN<Capacity> zone;
+	zone.setType(kZoneNoteRow);
+	zone.setBounds(KeyRect(0, 0, kSoundplaneAKeyWidth, kSoundplaneAKeyHeight));
+
+	std::vector<TouchArrayN<Capacity>> frames(kFrames);
+	for(int i=0; i<kFrames; ++i)
+	{
+		const float phase = 6.2831853f*i/kFrames;
+		for(int t=0; t<n; ++t)
+		{
+			Touch& u = frames[i][t];
+			u.x = 2.f + 3.5f*(t % 8) + 0.2f*std::sin(phase + t);
+			u.y = 1.5f + 2.f*(t / 8);
+			u.z = 0.5f + 0.25f*std::sin(phase*2.f + t);
+			u.state = (i == 0) ? kTouchStateOn : kTouchStateContinue;
+			u.age = i + 1;
+			u.kx = (int)u.x;
+			u.ky = (int)u.y;
+		}
+	}
+
+	b.run([&](int i)
+	{
+		const TouchArrayN<Capacity>& touches = frames[i & (kFrames - 1)];
+		zone.newFrame(touches.time);
+		for(int t=0; t<n; ++t)
+		{
+			zone.addTouchToFrame(t, touches[t]);
+		}
+		zone.storeAnyNewTouches();
+
+		std::bitset<Capacity> freedTouches;
+		zone.processTouchesNoteOffs(freedTouches);
+		zone.processTouchesNoteRow(freedTouches);
+		Microbenchmark::doNotOptimize(zone.getOutputTouches());
+	});
+}
+
+SP_MICROBENCHMARK_ARGS(Zone_processTouchesNoteRow, kTouchCounts)
+{
+	runAtCapacity(b, processTouchesNoteRow<kMinTouchCapacity>, processTouchesNoteRow<kDefaultTouchCapacity>,
+		processTouchesNoteRow<kMaxTouches>);
+}
+
+// ----------------------------------------------------------------
+// latency tracing
+
+// the cost of tracing one frame: a mark at each trace point, and pushing the trace. The
+// traces are drained every 1024 frames, as a reader thread would.
+void traceFrames(Microbenchmark& b, bool enabled)
+{
+	LatencyTrace trace;
+	FrameTrace frameTrace;
+	size_t drained = 0;
+	LatencyTrace::setEnabled(enabled);
+	b.run([&](int i)
+	{
+		for(int p=0; p<kTracePoints; ++p)
+		{
+			frameTrace.mark(static_cast<TracePoint>(p));
+		}
+		if(LatencyTrace::isEnabled())
+		{
+			trace.push(frameTrace);
+		}
+		if((i & 1023) == 0)
+		{
+			drained += trace.drain([](const FrameTrace&) {});
+		}
+		Microbenchmark::doNotOptimize(frameTrace);
+	});
+	LatencyTrace::setEnabled(false);
+	Microbenchmark::doNotOptimize(drained);
+}
+
+SP_MICROBENCHMARK(LatencyTrace_frame_disabled)
+{
+	traceFrames(b, false);
+}
+
+SP_MICROBENCHMARK(LatencyTrace_frame_enabled)
+{
+	traceFrames(b, true);
+}
@@ -0,0 +1,79 @@
+// Microbenchmark.cpp
+//
+// Registry and main() for the microbenchmarks. Run with no arguments to run all of them,
+// or with part of a name to run only the matching ones:
+//
+//   ./micro_benchmark TouchTracker
+
+#include "Microbenchmark.h"
+
+#include <cstdio>
+#include <utility>
+
+constexpr std::chrono::milliseconds Microbenchmark::kMinBatchTime;
+constexpr int Microbenchmark::kMaxBatch;
+constexpr int Microbenchmark::kRepetitions;
+
+namespace
+{
+
+struct Registration
+{
+	std::string name;
+	Microbenchmark::Function fn;
+	std::vector<int> args;
+};
+
+// constructed on first use, since benchmarks register themselves during static initialization.
+std::vector<Registration>& registry()
+{
+	static std::vector<Registration> r;
+	return r;
+}
+
+}
+
+int Microbenchmark::registerBenchmark(const char* name, Function fn, std::vector<int> args)
+{
+	registry().push_back(Registration{name, fn, std::move(args)});
+	return 0;
+}
+
+int Microbenchmark::runAll(const std::string& filter)
+{
+	int count = 0;
+	for(const auto& r : registry())
+	{
+		if(r.name.find(filter) == std::string::npos) continue;
+
+		const std::vector<int> args = r.args.empty() ? std::vector<int>{0} : r.args;
+		for(int a : args)
+		{
+			Microbenchmark b;
+			b.mArg = a;
+			r.fn(b);
+
+			std::string label = r.name;
+			if(!r.args.empty())
+			{
+				label += "/" + std::to_string(a);
+			}
+			printf("%-48s %12.1f ns/frame\n", label.c_str(), b.mNanosPerFrame);
+			fflush(stdout);
+			count++;
+		}
+	}
+	return count;
+}
+
+int main(int argc, const char* argv[])
+{
+	const std::string filter = (argc > 1) ? argv[1] : "";
+	printf("%-48s %12s\n", "benchmark", "time");
+	if(Microbenchmark::runAll(filter) == 0)
+	{
+		fprintf(stderr, "no benchmarks match %s\n", filter.c_str());
+		return 1;
+	}
+	return 0;
+}
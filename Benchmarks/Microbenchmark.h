@@ -0,0 +1,93 @@
+// Microbenchmark.h
+//
+// A small harness for microbenchmarks in the style of Google Benchmark. Each benchmark
+// registers itself with SP_MICROBENCHMARK, sets up its fixtures, and times one frame's
+// worth of work with Microbenchmark::run(), which repeats it until the timing is stable.
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+class Microbenchmark
+{
+public:
+	using Function = void (*)(Microbenchmark&);
+
+	// registers fn to be run once for each argument, or once with argument 0 if there are none.
+	static int registerBenchmark(const char* name, Function fn, std::vector<int> args = {});
+
+	// runs the benchmarks whose names contain filter, or all of them. Returns the number run.
+	static int runAll(const std::string& filter);
+
+	// the argument this run was registered with, such as a number of touches.
+	int arg() const { return mArg; }
+
+	// when one call to the op in run() handles more than one frame, report the time per frame.
+	void setFramesPerCall(int n) { mFramesPerCall = n; }
+
+	// times op(i) for i = 0, 1, 2... and records the mean time per frame. Call once per
+	// benchmark, after any setup.
+	template<typename Op>
+	void run(Op op)
+	{
+		using namespace std::chrono;
+
+		// warm up caches and branch predictors, and find a batch size long enough to time.
+		int i = 0;
+		int batch = 16;
+		for(;;)
+		{
+			auto start = steady_clock::now();
+			for(int n=0; n<batch; ++n)
+			{
+				op(i++);
+			}
+			if((steady_clock::now() - start > kMinBatchTime) || (batch >= kMaxBatch)) break;
+			batch *= 2;
+		}
+
+		// the fastest batch is the one least disturbed by the rest of the system.
+		double best = 1e300;
+		for(int r=0; r<kRepetitions; ++r)
+		{
+			auto start = steady_clock::now();
+			for(int n=0; n<batch; ++n)
+			{
+				op(i++);
+			}
+			const double nanos = duration<double, std::nano>(steady_clock::now() - start).count()/batch;
+			best = (nanos < best) ? nanos : best;
+		}
+		mNanosPerFrame = best/mFramesPerCall;
+	}
+
+	// keep the compiler from optimizing away a result that is otherwise unused.
+	template<typename T>
+	static void doNotOptimize(const T& value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r"(&value) : "memory");
+#else
+		static volatile const void* sink;
+		sink = &value;
+#endif
+	}
+
+private:
+	static constexpr auto kMinBatchTime = std::chrono::milliseconds(20);
+	static constexpr int kMaxBatch = 1 << 24;
+	static constexpr int kRepetitions = 5;
+
+	int mArg{0};
+	int mFramesPerCall{1};
+	double mNanosPerFrame{0};
+};
+
+#define SP_MICROBENCHMARK_ARGS(name, ...) \
+	static void name(Microbenchmark&); \
+	static const int name##Registered = Microbenchmark::registerBenchmark(#name, name, __VA_ARGS__); \
+	static void name(Microbenchmark& b)
+
+#define SP_MICROBENCHMARK(name) SP_MICROBENCHMARK_ARGS(name, {})
@@ -0,0 +1,85 @@
+// OSCOutputBenchmark.cpp
+//
+// Microbenchmark for SoundplaneOSCOutput sending frames of touches to sockets on the loopback
+// interface. Built into micro_benchmark when madronalib is available.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <vector>
+
+#include "Microbenchmark.h"
+#include "SoundplaneOSCOutput.h"
+
+namespace
+{
+
+// away from kDefaultUDPPort, so that a running client is not disturbed.
+constexpr int kBenchmarkBasePort = 33123;
+
+// UDP sockets bound to the ports the output sends to, so that the sends go through the
+// loopback interface without errors. They are never read: once their buffers are full,
+// the kernel drops the packets.
+class LoopbackReceivers
+{
+public:
+	LoopbackReceivers()
+	{
+		for(int i=0; i<kNumUDPPorts; ++i)
+		{
+			int s = socket(AF_INET, SOCK_DGRAM, 0);
+			if(s < 0) continue;
+			sockaddr_in addr{};
+			addr.sin_family = AF_INET;
+			addr.sin_port = htons(kBenchmarkBasePort + i);
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+			mSockets.push_back(s);
+		}
+	}
+
+	~LoopbackReceivers()
+	{
+		for(int s : mSockets)
+		{
+			close(s);
+		}
+	}
+
+private:
+	std::vector<int> mSockets;
+};
+
+}
+
+// one frame with n touches, from beginOutputFrame() to endOutputFrame(), which sends it.
+SP_MICROBENCHMARK_ARGS(SoundplaneOSCOutput_sendFrame, {1, 4, 16})
+{
+	const int n = b.arg();
+	LoopbackReceivers receivers;
+	SoundplaneOSCOutput output;
+	output.setHostName("127.0.0.1");
+	output.setPort(kBenchmarkBasePort);
+	output.setMaxTouches(n);
+	output.setActive(true);
+	output.reconnect();
+
+	b.run([&](int i)
+	{
+		output.beginOutputFrame(system_clock::now());
+		for(int t=0; t<n; ++t)
+		{
+			Touch u{};
+			u.x = 2.f + 3.5f*(t % 8);
+			u.y = 1.5f + 2.f*(t / 8);
+			u.z = 0.5f + 0.25f*std::sin(i*0.1f + t);
+			u.note = 60.f + t;
+			u.state = (i == 0) ? kTouchStateOn : kTouchStateContinue;
+			output.processTouch(t, 0, u);
+		}
+		output.endOutputFrame();
+	});
+}
@@ -0,0 +1,114 @@
+// PipelineBenchmark.cpp
+//
+// Runs a SimulatedSoundplaneDriver as fast as possible and processes its frames the way
+// the model's process thread does: wait to be woken, calibrate, preprocess and track
+// touches. Reports the throughput of the whole pipeline below the USB stack and the
+// latency from the driver committing each frame to the tracker finishing with it.
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "LatencyHistogram.h"
+#include "SimulatedSoundplaneDriver.h"
+#include "TouchTracker.h"
+#include "WakeupEvent.h"
+
+using namespace std::chrono;
+
+namespace
+{
+
+constexpr uint64_t kDefaultFrames = 100000;
+constexpr int kSimulatedTouches = 4;
+
+class Listener : public SoundplaneDriverListener
+{
+public:
+	void onStartup() override {}
+	void onFrameReady() override { mFrameEvent.notify(); }
+	void onError(int err, const char* errStr) override { mErrors++; }
+	void onClose() override
+	{
+		mClosed.store(true);
+		mFrameEvent.notify();
+	}
+
+	WakeupEvent mFrameEvent;
+	std::atomic<bool> mClosed{false};
+	std::atomic<int> mErrors{0};
+};
+
+SimulatedSoundplaneConfig makeConfig(uint64_t frames)
+{
+	SimulatedSoundplaneConfig config;
+	config.touches.clear();
+	for(int i=0; i<kSimulatedTouches; ++i)
+	{
+		SimulatedTouch t;
+		t.x0 = 4.f + 14.f*i;
+		t.x1 = t.x0 + 8.f;
+		t.y0 = 1.5f + i;
+		t.y1 = 6.f - i;
+		t.movePeriod = 1.f + 0.37f*i;
+		t.pressurePeriod = 0.5f + 0.21f*i;
+		t.phase = 0.13f*i;
+		config.touches.push_back(t);
+	}
+	config.gapProbability = 0.001f;
+	config.endpointSkew = 1;
+	config.realTime = false;
+	config.frames = frames;
+	return config;
+}
+
+}
+
+int main(int argc, const char* argv[])
+{
+	const uint64_t frames = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : kDefaultFrames;
+
+	Listener listener;
+	SimulatedSoundplaneDriver driver(listener, makeConfig(frames));
+	SensorFrameRing& ring = driver.getFrameRing();
+
+	// calibrate against the baseline, so the tracker sees the touches.
+	SensorFrame meanInv;
+	fill(meanInv, 4.f);
+	driver.setCalibration(meanInv);
+
+	TouchTracker tracker;
+	tracker.setThresh(0.01f);
+	SensorFrame curvature{};
+	LatencyHistogram latency;
+	uint64_t processed = 0;
+	int touchFrames = 0;
+
+	const auto start = steady_clock::now();
+	driver.start();
+	while(!listener.mClosed.load() || ring.getFillLevel())
+	{
+		listener.mFrameEvent.waitUntil(steady_clock::now() + milliseconds(100));
+		while(const DriverFrame* p = ring.acquire())
+		{
+			tracker.preprocess(p->frame, curvature);
+			TouchArray touches = tracker.process(curvature, kSimulatedTouches);
+			if(touches[0].state) touchFrames++;
+			latency.add(duration_cast<microseconds>(steady_clock::now() - p->time).count());
+			ring.release();
+			processed++;
+		}
+	}
+	const double seconds = duration<double>(steady_clock::now() - start).count();
+
+	std::cout << "frames generated: " << driver.getFramesGenerated() << " processed: " << processed
+		<< " with touches: " << touchFrames << " errors: " << listener.mErrors.load() << "\n";
+	std::cout << "throughput: " << processed/seconds << " frames/s ("
+		<< processed/seconds/kSoundplaneFrameRate << "x real time)\n";
+	std::cout << "commit to tracked: ";
+	latency.dump(std::cout);
+	std::cout << "\n";
+	latency.dumpBuckets(std::cout);
+
+	return 0;
+}
@@ -0,0 +1,113 @@
+// ReplayBenchmark.cpp
+//
+// Replays a capture file as fast as possible, stepping the driver and the tracker in turn
+// on one thread, as a reproducible throughput and regression test of everything after the
+// USB stack. The first frames are used to calibrate, as the model does on startup. Prints
+// frames per second and a checksum of the tracked touches, which changes if the output of
+// any step of the pipeline changes.
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "ReplaySoundplaneDriver.h"
+#include "TouchTracker.h"
+
+using namespace std::chrono;
+
+namespace
+{
+
+constexpr int kTrackedTouches = 4;
+
+class Listener : public SoundplaneDriverListener
+{
+public:
+	void onStartup() override {}
+	void onFrameReady() override {}
+	void onError(int err, const char* errStr) override { mErrors++; }
+	void onClose() override {}
+
+	int mErrors{0};
+};
+
+// FNV-1a over the bytes of the touches.
+uint64_t hashTouches(uint64_t h, const TouchArray& touches)
+{
+	for(int i=0; i<kTrackedTouches; ++i)
+	{
+		const float v[3] = { touches[i].x, touches[i].y, touches[i].z };
+		unsigned char bytes[sizeof(v)];
+		memcpy(bytes, v, sizeof(v));
+		for(unsigned char b : bytes)
+		{
+			h = (h ^ b)*1099511628211ull;
+		}
+	}
+	return h;
+}
+
+}
+
+int main(int argc, const char* argv[])
+{
+	if(argc < 2)
+	{
+		std::cerr << "usage: replay_benchmark <capture file>\n";
+		return 1;
+	}
+
+	ReplayConfig config;
+	config.mode = ReplayMode::kAsFastAsPossible;
+	Listener listener;
+	ReplaySoundplaneDriver driver(listener, argv[1], config);
+	if(!driver.isOpen())
+	{
+		std::cerr << "couldn't read capture file " << argv[1] << "\n";
+		return 1;
+	}
+	SensorFrameRing& ring = driver.getFrameRing();
+
+	SensorFrame sum{};
+	int calibrateFrames = 0;
+	TouchTracker tracker;
+	SensorFrame curvature{};
+	uint64_t frames = 0;
+	uint64_t touchHash = 14695981039346656037ull;
+
+	const auto start = steady_clock::now();
+	driver.start();
+	while(driver.step())
+	{
+		while(const DriverFrame* p = ring.acquire())
+		{
+			if(!p->calibrated)
+			{
+				add(sum, sum, p->frame);
+				if(++calibrateFrames == kSoundplaneCalibrateSize)
+				{
+					SensorFrame meanInv;
+					divide(sum, sum, static_cast<float>(calibrateFrames));
+					divide(meanInv, fill(1.f), sum);
+					driver.setCalibration(meanInv);
+				}
+			}
+			else
+			{
+				tracker.preprocess(p->frame, curvature);
+				touchHash = hashTouches(touchHash, tracker.process(curvature, kTrackedTouches));
+			}
+			ring.release();
+			frames++;
+		}
+	}
+	const double seconds = duration<double>(steady_clock::now() - start).count();
+
+	std::cout << "transfers: " << driver.getTransfersReplayed() << " frames: " << frames
+		<< " errors: " << listener.mErrors << " dropped: " << ring.getOverflowCount() << "\n";
+	std::cout << "throughput: " << frames/seconds << " frames/s ("
+		<< frames/seconds/kSoundplaneFrameRate << "x real time)\n";
+	std::cout << "touch checksum: " << std::hex << touchHash << std::dec << "\n";
+
+	return 0;
+}
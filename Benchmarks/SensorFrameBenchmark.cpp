@@ -0,0 +1,601 @@
+// SensorFrameBenchmark.cpp
+//
+// Measures the per-frame cost of the unpack, handoff, calibrate and preprocess steps
+// before and after their optimized versions, and compares the SIMD kernels for each instruction set
+// with the scalar kernels for speed and accuracy. The peak finders of all instruction sets are
+// also checked against a reference, on random frames and on frames made to probe the edges,
+// and the unpackers against the unoptimized unpack on random payloads.
+// Returns nonzero if any of the checks fail. With --check, runs the checks only.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "SensorFrame.h"
+#include "SensorFrameKernels.h"
+#include "SPSCRing.h"
+#include "SoundplaneModelA.h"
+#include "TouchTracker.h"
+
+using namespace std::chrono;
+
+namespace
+{
+
+constexpr int kIterations = 20000;
+constexpr int kTestFrames = 16;
+
+// see TouchTracker::preprocess().
+constexpr float kFusedPreprocessTolerance = 1e-3f;
+
+// the preprocess chain as written with value-returning operations.
+class ValuePreprocessor
+{
+public:
+	SensorFrame preprocess(const SensorFrame& in)
+	{
+		float k = 0.25f;
+		SensorFrame y = multiply(in, k);
+		mInputZ1 = multiply(mInputZ1, 1.0 - k);
+		y = add(y, mInputZ1);
+		mInputZ1 = y;
+		y = max(y, 0.f);
+		y = smoothPressureX(smoothPressureX(smoothPressureX(smoothPressureX(y))));
+		y = smoothPressureY(smoothPressureY(smoothPressureY(y)));
+		return getCurvatureXY(multiply(y, 1.f/64.f));
+	}
+
+private:
+	SensorFrame mInputZ1{};
+};
+
+// the preprocess chain as separate in-place passes over the frame.
+class SequentialPreprocessor
+{
+public:
+	void preprocess(const SensorFrame& in, SensorFrame& y)
+	{
+		float k = 0.25f;
+		multiply(mInputZ1, mInputZ1, 1.f - k);
+		axpy(mInputZ1, k, in);
+		max(y, mInputZ1, 0.f);
+		for(int n = 0; n < 4; ++n)
+		{
+			smoothPressureX(y, y);
+		}
+		for(int n = 0; n < 3; ++n)
+		{
+			smoothPressureY(y, y);
+		}
+		multiply(y, y, 1.f/64.f);
+		getCurvatureXY(y, y);
+	}
+
+private:
+	SensorFrame mInputZ1{};
+};
+
+SensorFrame makeTestFrame(std::mt19937& gen)
+{
+	std::uniform_real_distribution<float> dist(0.9f, 1.1f);
+	SensorFrame f;
+	for(auto& x : f)
+	{
+		x = dist(gen);
+	}
+	return f;
+}
+
+template<typename Fn>
+double nanosPerFrame(Fn fn)
+{
+	// warm up caches and branch predictors
+	for(int i=0; i<kIterations/10; ++i)
+	{
+		fn(i);
+	}
+	
+	auto start = steady_clock::now();
+	for(int i=0; i<kIterations; ++i)
+	{
+		fn(i);
+	}
+	auto end = steady_clock::now();
+	return duration_cast<nanoseconds>(end - start).count() / static_cast<double>(kIterations);
+}
+
+// distance between two floats in units in the last place. NaNs are equal to each other
+// and infinitely far from anything else.
+int64_t ulpDistance(float a, float b)
+{
+	if(std::isnan(a) || std::isnan(b))
+	{
+		return (std::isnan(a) && std::isnan(b)) ? 0 : INT64_MAX;
+	}
+	int32_t ia, ib;
+	std::memcpy(&ia, &a, sizeof(float));
+	std::memcpy(&ib, &b, sizeof(float));
+	
+	// map the sign-magnitude representation onto a monotonic integer line.
+	int64_t la = (ia < 0) ? -static_cast<int64_t>(ia & 0x7FFFFFFF) : ia;
+	int64_t lb = (ib < 0) ? -static_cast<int64_t>(ib & 0x7FFFFFFF) : ib;
+	return std::llabs(la - lb);
+}
+
+int64_t maxUlpDistance(const SensorFrame& a, const SensorFrame& b)
+{
+	int64_t d = 0;
+	for(int i=0; i<SensorGeometry::elements; ++i)
+	{
+		d = std::max(d, ulpDistance(a[i], b[i]));
+	}
+	return d;
+}
+
+// the peaks of a frame by the definition in SensorFrame.h, one taxel at a time.
+SensorFrameMask referencePeaks(const SensorFrame& in, float threshold)
+{
+	constexpr int w = SensorGeometry::width;
+	constexpr int h = SensorGeometry::height;
+	SensorFrameMask peaks{};
+	for(int j=0; j<h; ++j)
+	{
+		for(int i=1; i<w - 1; ++i)
+		{
+			const float z = in[j*w + i];
+			bool peak = (z > threshold);
+			for(int y=std::max(j - 1, 0); y<=std::min(j + 1, h - 1); ++y)
+			{
+				for(int x=i - 1; x<=i + 1; ++x)
+				{
+					if(((x != i) || (y != j)) && !(z > in[y*w + x]))
+					{
+						peak = false;
+					}
+				}
+			}
+			if(peak)
+			{
+				peaks[j] |= uint64_t(1) << i;
+			}
+		}
+	}
+	return peaks;
+}
+
+// frames for checking the peak finders: a single spike at each taxel, which is a peak
+// everywhere but the edge columns, spikes next to spikes of the same height and at the
+// threshold, which are not, and spikes next to NaN, with the random frames.
+std::vector<SensorFrame> makePeakTestFrames(const SensorFrame* inputs, int frames, float threshold)
+{
+	constexpr int w = SensorGeometry::width;
+	constexpr int h = SensorGeometry::height;
+	std::vector<SensorFrame> tests(inputs, inputs + frames);
+	for(int j=0; j<h; ++j)
+	{
+		for(int i=0; i<w; ++i)
+		{
+			SensorFrame f = fill(0.f);
+			f[j*w + i] = 1.f;
+			tests.push_back(f);
+			
+			// a plateau.
+			f[j*w + (i + 1) % w] = 1.f;
+			tests.push_back(f);
+			
+			// a spike at the threshold.
+			f = fill(0.f);
+			f[j*w + i] = threshold;
+			tests.push_back(f);
+			
+			// a spike with NaN below and to the right of it.
+			f = fill(0.f);
+			f[j*w + i] = 1.f;
+			f[((j + 1) % h)*w + (i + 1) % w] = std::numeric_limits<float>::quiet_NaN();
+			tests.push_back(f);
+		}
+	}
+	return tests;
+}
+
+// checks the peak finders of each instruction set available on this CPU against the
+// reference. Returns the number of frames any of them gets wrong.
+int checkPeakFinders(const std::vector<SensorFrame>& tests, float threshold)
+{
+	int failures = 0;
+	for(auto isa : {SensorFrameISA::kScalar, SensorFrameISA::kSSE2, SensorFrameISA::kAVX2, SensorFrameISA::kNEON})
+	{
+		const SensorFrameKernels* k = getSensorFrameKernels(isa);
+		if(!k) continue;
+		
+		int wrong = 0;
+		for(const auto& f : tests)
+		{
+			SensorFrameMask peaks;
+			k->findPeaks(peaks.data(), f.data(), threshold);
+			wrong += (peaks != referencePeaks(f, threshold));
+		}
+		std::cout << "  " << k->name << ": findPeaks wrong in " << wrong << " of " << tests.size() << " frames\n";
+		failures += wrong;
+	}
+	return failures;
+}
+
+// checks K1_unpack_frame(), with the SIMD path this CPU supports, and the scalar unpacker
+// against K1_unpack_float2() followed by K1_clear_edges(), on random payloads and on
+// payloads of all zero and all one bits. Returns the largest difference seen.
+int64_t checkUnpack(std::mt19937& gen)
+{
+	int64_t ulps = 0;
+	std::array<unsigned char, kSoundplaneAPackedDataSize> payload0, payload1;
+	for(int i=0; i<kTestFrames + 2; ++i)
+	{
+		for(int j=0; j<kSoundplaneAPackedDataSize; ++j)
+		{
+			payload0[j] = (i < kTestFrames) ? gen() : ((i == kTestFrames) ? 0 : 0xFF);
+			payload1[j] = (i < kTestFrames) ? gen() : ((i == kTestFrames) ? 0 : 0xFF);
+		}
+		SensorFrame expected{}, dispatched{}, scalar{};
+		K1_unpack_float2(payload0.data(), payload1.data(), expected);
+		K1_clear_edges(expected);
+		K1_unpack_frame(payload0.data(), payload1.data(), dispatched);
+		K1_unpack_frame_scalar(payload0.data(), payload1.data(), scalar);
+		ulps = std::max(ulps, maxUlpDistance(dispatched, expected));
+		ulps = std::max(ulps, maxUlpDistance(scalar, expected));
+	}
+	std::cout << "  K1_unpack_frame: max difference from K1_unpack_float2 " << ulps << " ulp\n";
+	return ulps;
+}
+
+// weights for checking smooth(), which should give the same results for any weights.
+SmoothingWeights makeTestWeights(std::mt19937& gen)
+{
+	std::uniform_real_distribution<float> dist(0.f, 1.f);
+	SmoothingWeights w;
+	for(auto& row : w.x)
+	{
+		for(auto& x : row) x = dist(gen);
+	}
+	for(auto& row : w.y)
+	{
+		for(auto& y : row) y = dist(gen);
+	}
+	return w;
+}
+
+// the largest difference between the outputs of a kernel call fn(kernels, out) with the given
+// kernels and with the scalar kernels.
+template<typename Fn>
+int64_t kernelUlps(const SensorFrameKernels& k, const SensorFrameKernels& scalar, Fn fn)
+{
+	SensorFrame out{}, expected{};
+	fn(k, out);
+	fn(scalar, expected);
+	return maxUlpDistance(out, expected);
+}
+
+// a frame of values the kernels must treat like the scalar kernels do: signed zeros,
+// negative numbers, infinities and NaNs.
+SensorFrame makeSpecialValuesFrame()
+{
+	const float inf = std::numeric_limits<float>::infinity();
+	const float values[] = { 0.f, -0.f, 1.f, -1.f, 0.5f, -2.f, inf, -inf, std::numeric_limits<float>::quiet_NaN() };
+	constexpr int numValues = sizeof(values)/sizeof(values[0]);
+	SensorFrame f;
+	for(int i=0; i<SensorGeometry::elements; ++i)
+	{
+		f[i] = values[(i*7 + i/numValues) % numValues];
+	}
+	return f;
+}
+
+// checks every kernel of each instruction set available on this CPU against the scalar
+// kernels, on the test frames and on a frame of special values. Returns the largest
+// difference seen, or INT64_MAX if any peaks differ.
+int64_t checkKernels(const SensorFrame* inputs, int frames, const SensorFrame& meanInv, const SmoothingWeights& weights)
+{
+	const SensorFrameKernels& scalar = *getScalarSensorFrameKernels();
+	std::vector<SensorFrame> tests(inputs, inputs + frames);
+	tests.push_back(makeSpecialValuesFrame());
+	const int numTests = static_cast<int>(tests.size());
+	int64_t worstUlps = 0;
+	
+	for(auto isa : {SensorFrameISA::kScalar, SensorFrameISA::kSSE2, SensorFrameISA::kAVX2, SensorFrameISA::kNEON})
+	{
+		const SensorFrameKernels* k = getSensorFrameKernels(isa);
+		if(!k) continue;
+		
+		int64_t ulps = 0;
+		for(int i=0; i<numTests; ++i)
+		{
+			const float* a = tests[i].data();
+			const float* b = tests[(i + 1) % numTests].data();
+			const float x = tests[(i + 2) % numTests][i];
+			auto check = [&](std::function<void(const SensorFrameKernels&, SensorFrame&)> fn)
+			{
+				ulps = std::max(ulps, kernelUlps(*k, scalar, fn));
+			};
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.add(out.data(), a, b); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.subtract(out.data(), a, b); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.multiply(out.data(), a, b); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.divide(out.data(), a, b); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.addScalar(out.data(), a, x); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.subtractScalar(out.data(), a, x); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.multiplyScalar(out.data(), a, x); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.divideScalar(out.data(), a, x); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.max(out.data(), a, 1.f); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.min(out.data(), a, 1.f); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.max(out.data(), a, x); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.min(out.data(), a, x); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.fill(out.data(), x); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.clamp(out.data(), a, 0.95f, 1.05f); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.sqrt(out.data(), a); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ out = tests[i]; s.axpy(out.data(), 0.25f, b); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.scaleOffset(out.data(), a, 0.25f, -1.0f); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.scaleOffsetFrame(out.data(), a, meanInv.data(), -1.0f); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.curvatureX(out.data(), a); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.curvatureY(out.data(), a); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.curvatureXY(out.data(), a); });
+			check([&](const SensorFrameKernels& s, SensorFrame& out){ s.smooth(out.data(), a, weights.x[0].data(), weights.y[0].data()); });
+			
+			SensorFrameMask peaks, expectedPeaks;
+			k->findPeaks(peaks.data(), a, 1.f);
+			scalar.findPeaks(expectedPeaks.data(), a, 1.f);
+			if(peaks != expectedPeaks)
+			{
+				ulps = INT64_MAX;
+			}
+		}
+		std::cout << "  " << k->name << ": max difference from scalar " << ulps << " ulp\n";
+		worstUlps = std::max(worstUlps, ulps);
+	}
+	return worstUlps;
+}
+
+// times some of the kernels for each instruction set available on this CPU.
+void benchmarkKernels(const SensorFrame* inputs, int frames, const SensorFrame& meanInv, const SmoothingWeights& weights, float& sink)
+{
+	std::cout << "kernels (best: " << getSensorFrameKernels().name << ")\n";
+	for(auto isa : {SensorFrameISA::kScalar, SensorFrameISA::kSSE2, SensorFrameISA::kAVX2, SensorFrameISA::kNEON})
+	{
+		const SensorFrameKernels* k = getSensorFrameKernels(isa);
+		if(!k) continue;
+		
+		SensorFrame out;
+		double scaleOffsetTime = nanosPerFrame([&](int i)
+		{
+			k->scaleOffsetFrame(out.data(), inputs[i % frames].data(), meanInv.data(), -1.0f);
+			sink += out[i % SensorGeometry::elements];
+		});
+		double curvatureTime = nanosPerFrame([&](int i)
+		{
+			k->curvatureXY(out.data(), inputs[i % frames].data());
+			sink += out[i % SensorGeometry::elements];
+		});
+		double smoothTime = nanosPerFrame([&](int i)
+		{
+			k->smooth(out.data(), inputs[i % frames].data(), weights.x[0].data(), weights.y[0].data());
+			sink += out[i % SensorGeometry::elements];
+		});
+		SensorFrameMask peaks;
+		double peaksTime = nanosPerFrame([&](int i)
+		{
+			k->findPeaks(peaks.data(), inputs[i % frames].data(), 1.f);
+			sink += peaks[i % SensorGeometry::height] & 1;
+		});
+		std::cout << "  " << k->name << ": scaleOffset " << scaleOffsetTime << " ns/frame, curvatureXY "
+			<< curvatureTime << " ns/frame, smooth " << smoothTime << " ns/frame, findPeaks "
+			<< peaksTime << " ns/frame\n";
+	}
+}
+
+// the fused preprocessor only sums in a different order, so it should stay within a small
+// tolerance of the separate passes, relative to the largest value in the frame. Returns the
+// largest difference seen.
+float checkFusedPreprocess(const SensorFrame* inputs, int frames)
+{
+	float fusedError = 0.f;
+	SequentialPreprocessor reference;
+	TouchTracker fused;
+	SensorFrame expected, actual;
+	for(int i=0; i<frames*4; ++i)
+	{
+		reference.preprocess(inputs[i % frames], expected);
+		fused.preprocess(inputs[i % frames], actual);
+		float peak = 0.f;
+		float diff = 0.f;
+		for(int n=0; n<SensorGeometry::elements; ++n)
+		{
+			peak = std::max(peak, std::abs(expected[n]));
+			diff = std::max(diff, std::abs(expected[n] - actual[n]));
+		}
+		if(peak > 0.f)
+		{
+			fusedError = std::max(fusedError, diff/peak);
+		}
+	}
+	std::cout << "preprocess, fused: max difference " << fusedError << " of peak\n";
+	return fusedError;
+}
+
+void report(const char* name, double before, double after)
+{
+	std::cout << name << ": before " << before << " ns/frame, after " << after << " ns/frame ("
+		<< before/after << "x)\n";
+}
+
+// times the unpack, handoff, calibrate and preprocess steps and the kernels.
+void benchmark(std::mt19937& gen, const SensorFrame* inputs, const SensorFrame& meanInv, const SmoothingWeights& weights)
+{
+	constexpr int kFrames = kTestFrames;
+	float sink = 0.f;
+	
+	// unpack: separate unpack and clear edges passes vs. K1_unpack_frame()
+	std::array<unsigned char, kSoundplaneAPackedDataSize> payload0, payload1;
+	for(int i=0; i<kSoundplaneAPackedDataSize; ++i)
+	{
+		payload0[i] = gen();
+		payload1[i] = gen();
+	}
+	SensorFrame unpacked{};
+	double unpackBefore = nanosPerFrame([&](int i)
+	{
+		K1_unpack_float2(payload0.data(), payload1.data(), unpacked);
+		K1_clear_edges(unpacked);
+		sink += unpacked[i % SensorGeometry::elements];
+	});
+	double unpackAfter = nanosPerFrame([&](int i)
+	{
+		K1_unpack_frame(payload0.data(), payload1.data(), unpacked);
+		sink += unpacked[i % SensorGeometry::elements];
+	});
+	report("unpack", unpackBefore, unpackAfter);
+	
+	// handoff from driver to model: unpack, push by value into a queue and pop by value,
+	// vs. unpack into a reserved SPSCRing slot and read it in place.
+	{
+		constexpr int kQueueSize = 16;
+		std::array<SensorFrame, kQueueSize> queue;
+		SensorFrame popped{};
+		double handoffBefore = nanosPerFrame([&](int i)
+		{
+			K1_unpack_frame(payload0.data(), payload1.data(), unpacked);
+			queue[i % kQueueSize] = unpacked;
+			popped = queue[i % kQueueSize];
+			sink += popped[i % SensorGeometry::elements];
+		});
+		SPSCRing<SensorFrame> ring(kQueueSize);
+		double handoffAfter = nanosPerFrame([&](int i)
+		{
+			K1_unpack_frame(payload0.data(), payload1.data(), *ring.reserve());
+			ring.commit();
+			sink += (*ring.acquire())[i % SensorGeometry::elements];
+			ring.release();
+		});
+		report("unpack and hand off", handoffBefore, handoffAfter);
+	}
+	
+	// calibrate: the model's subtract(multiply(frame, meanInv), 1) vs. fused scaleOffset()
+	SensorFrame calibrated{};
+	double calBefore = nanosPerFrame([&](int i)
+	{
+		calibrated = subtract(multiply(inputs[i % kFrames], meanInv), 1.0f);
+		sink += calibrated[i % SensorGeometry::elements];
+	});
+	double calAfter = nanosPerFrame([&](int i)
+	{
+		scaleOffset(calibrated, inputs[i % kFrames], meanInv, -1.0f);
+		sink += calibrated[i % SensorGeometry::elements];
+	});
+	report("calibrate", calBefore, calAfter);
+	
+	// preprocess: value-returning chain vs. TouchTracker::preprocess(in, out)
+	ValuePreprocessor valuePreprocessor;
+	TouchTracker tracker;
+	SensorFrame curvature{};
+	double preBefore = nanosPerFrame([&](int i)
+	{
+		curvature = valuePreprocessor.preprocess(inputs[i % kFrames]);
+		sink += curvature[i % SensorGeometry::elements];
+	});
+	double preAfter = nanosPerFrame([&](int i)
+	{
+		tracker.preprocess(inputs[i % kFrames], curvature);
+		sink += curvature[i % SensorGeometry::elements];
+	});
+	report("preprocess", preBefore, preAfter);
+	
+	// preprocess: separate passes vs. the fused TouchTracker::preprocess(in, out)
+	SequentialPreprocessor sequentialPreprocessor;
+	double seqTime = nanosPerFrame([&](int i)
+	{
+		sequentialPreprocessor.preprocess(inputs[i % kFrames], curvature);
+		sink += curvature[i % SensorGeometry::elements];
+	});
+	report("preprocess, fused", seqTime, preAfter);
+	
+	// calibration statistics
+	SensorFrameStats stats;
+	double statsTime = nanosPerFrame([&](int i)
+	{
+		stats.accumulate(inputs[i % kFrames]);
+	});
+	sink += stats.mean()[0];
+	std::cout << "SensorFrameStats::accumulate: " << statsTime << " ns/frame\n";
+	
+	benchmarkKernels(inputs, kFrames, meanInv, weights, sink);
+	
+	// print the sink so that the work above can't be optimized away.
+	std::cout << "(checksum " << sink << ")\n";
+}
+
+// checks the SIMD kernels, the unpackers, the peak finders and the fused preprocessor. Returns the number of
+// checks that failed.
+int check(std::mt19937& gen, const SensorFrame* inputs, const SensorFrame& meanInv, const SmoothingWeights& weights)
+{
+	std::cout << "kernels\n";
+	int64_t worstUlps = checkKernels(inputs, kTestFrames, meanInv, weights);
+	const int64_t unpackUlps = checkUnpack(gen);
+	
+	// peak finders vs. the reference. The random frames are around 1.
+	constexpr float kPeakThreshold = 1.f;
+	std::cout << "peak finders\n";
+	const int peakFailures = checkPeakFinders(makePeakTestFrames(inputs, kTestFrames, kPeakThreshold), kPeakThreshold);
+	
+	const float fusedError = checkFusedPreprocess(inputs, kTestFrames);
+	
+	int failures = 0;
+	
+	// the kernels are meant to be bit-identical to the scalar ones.
+	if(worstUlps != 0)
+	{
+		std::cout << "error: SIMD kernels differ from scalar kernels\n";
+		failures++;
+	}
+	if(unpackUlps != 0)
+	{
+		std::cout << "error: K1_unpack_frame differs from K1_unpack_float2\n";
+		failures++;
+	}
+	if(peakFailures != 0)
+	{
+		std::cout << "error: peak finders differ from the reference\n";
+		failures++;
+	}
+	if(fusedError > kFusedPreprocessTolerance)
+	{
+		std::cout << "error: fused preprocess is outside of tolerance\n";
+		failures++;
+	}
+	return failures;
+}
+
+}
+
+// with --check, only the checks are run. The build runs them this way after linking.
+int main(int argc, const char* argv[])
+{
+	const bool checkOnly = (argc > 1) && (std::strcmp(argv[1], "--check") == 0);
+	
+	std::mt19937 gen(1);
+	std::array<SensorFrame, kTestFrames> inputs;
+	for(auto& f : inputs)
+	{
+		f = makeTestFrame(gen);
+	}
+	const SensorFrame meanInv = divide(fill(1.f), makeTestFrame(gen));
+	const SmoothingWeights weights = makeTestWeights(gen);
+	
+	if(!checkOnly)
+	{
+		benchmark(gen, inputs.data(), meanInv, weights);
+	}
+	return (check(gen, inputs.data(), meanInv, weights) == 0) ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+// TransferConfigBenchmark.cpp
+//
+// Walks the space of LibusbTransferConfig settings, feeding synthetic streams of transfers
+// for each one through an Unpacker set up as the libusb driver sets it up. Transfer buffers
+// are reused in the driver's order, each one overwritten when it would be resubmitted to the
+// USB stack. For each setting, prints the time per frame, and the most transfers one
+// endpoint can get ahead of the other without losing frames, which is how long a stall of
+// the other endpoint's completions the setting rides out. Fails if any setting loses frames
+// with the endpoints in step, or tolerates less skew than its stored transfers promise.
+// With --check, checks the settings without timing them.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "LibusbSoundplaneDriver.h"
+#include "Unpacker.h"
+
+using namespace std::chrono;
+
+namespace
+{
+
+// frames sent on each endpoint when timing each setting.
+constexpr int kFramesPerConfig = 1 << 14;
+
+// frames per millisecond, one isochronous packet per USB frame.
+constexpr int kFramesPerMilli = 1;
+
+struct Result
+{
+	uint64_t framesMatched;
+	uint64_t sequenceMismatches;
+	double nanosPerFrame;
+};
+
+// send the given number of transfers on each endpoint, with endpoint 0 lead transfers ahead.
+Result run(const LibusbTransferConfig& config, int transfers, int lead)
+{
+	const int packets = config.packetsPerTransfer;
+	const int buffers = config.getBuffersPerEndpoint();
+
+	// the transfer buffers of each endpoint, used in turn.
+	std::vector<SoundplaneADataPacket> pool[kSoundplaneANumEndpoints];
+	for(auto& p : pool)
+	{
+		p.assign(buffers*packets, SoundplaneADataPacket{});
+	}
+
+	DriverMetrics metrics;
+	float sink = 0.f;
+	Unpacker<kSoundplaneANumEndpoints> unpacker(config.getUnpackerWindow(),
+		[&](const SensorFrame& f, uint16_t) { sink += f[0]; });
+	unpacker.setMetrics(&metrics);
+
+	// the USB stack writes transfer t into buffer t % buffers while the transfers before
+	// it are handed to the Unpacker, so it fills the buffer it will hand over
+	// buffersInFlight transfers from now.
+	auto fill = [&](int endpoint, int t)
+	{
+		if(t >= transfers) return;
+		SoundplaneADataPacket* p = &pool[endpoint][(t % buffers)*packets];
+		for(int k=0; k<packets; ++k)
+		{
+			p[k].seqNum = static_cast<uint16_t>(t*packets + k);
+		}
+	};
+	auto deliver = [&](int endpoint, int t)
+	{
+		fill(endpoint, t + config.buffersInFlight);
+		unpacker.gotTransfer(endpoint, &pool[endpoint][(t % buffers)*packets], packets);
+	};
+
+	for(int endpoint=0; endpoint<kSoundplaneANumEndpoints; ++endpoint)
+	{
+		for(int t=0; t<config.buffersInFlight; ++t)
+		{
+			fill(endpoint, t);
+		}
+	}
+
+	const auto start = steady_clock::now();
+	for(int t=0; t<transfers + lead; ++t)
+	{
+		if(t < transfers) deliver(0, t);
+		if(t >= lead) deliver(1, t - lead);
+	}
+	const double nanos = duration<double, std::nano>(steady_clock::now() - start).count();
+
+	volatile float keep = sink;
+	(void)keep;
+	return Result{metrics.framesReceived.get(), metrics.sequenceMismatches.get(), nanos/(transfers*packets)};
+}
+
+bool isLossless(const LibusbTransferConfig& config, int transfers, int lead)
+{
+	const Result r = run(config, transfers, lead);
+	return (r.framesMatched == static_cast<uint64_t>(transfers*config.packetsPerTransfer)) && !r.sequenceMismatches;
+}
+
+// the largest lead with no lost frames, found by bisection since a lead that loses frames
+// is followed by larger ones that do too. -1 if frames are lost even in step.
+int getMaxLead(const LibusbTransferConfig& config)
+{
+	// enough transfers to cycle through the buffers a few times after the lead.
+	const int maxLead = config.getBuffersPerEndpoint();
+	const int transfers = maxLead + 4*config.getBuffersPerEndpoint();
+	if(!isLossless(config, transfers, 0)) return -1;
+	int lo = 0;
+	int hi = maxLead;
+	while(lo < hi)
+	{
+		const int mid = (lo + hi + 1)/2;
+		if(isLossless(config, transfers, mid)) lo = mid;
+		else hi = mid - 1;
+	}
+	return lo;
+}
+
+}
+
+// with --check, only the checks are run. The build runs them this way after linking.
+int main(int argc, const char* argv[])
+{
+	const bool checkOnly = (argc > 1) && (std::strcmp(argv[1], "--check") == 0);
+
+	const int packetCounts[] = {1, 2, 4, 8, 16, 32, 64};
+	const int inFlightCounts[] = {1, 2, 4, 8, 16, 32};
+	const int multipliers[] = {2, 3, 4, 8};
+
+	printf("%8s %10s %11s %10s %18s\n", "packets", "in flight", "multiplier", "ns/frame", "max lead");
+	int failures = 0;
+	for(int packets : packetCounts)
+	{
+		for(int inFlight : inFlightCounts)
+		{
+			for(int multiplier : multipliers)
+			{
+				LibusbTransferConfig config;
+				config.packetsPerTransfer = packets;
+				config.buffersInFlight = inFlight;
+				config.inFlightMultiplier = multiplier;
+				if(!config.isValid()) continue;
+
+				const int maxLead = getMaxLead(config);
+				const bool ok = (maxLead >= config.getStoredTransfersPerEndpoint() - 1);
+				char time[32] = "-";
+				if(!checkOnly)
+				{
+					snprintf(time, sizeof(time), "%.1f", run(config, kFramesPerConfig/packets, 0).nanosPerFrame);
+				}
+				char lead[32];
+				snprintf(lead, sizeof(lead), "%d (%d ms)", maxLead, maxLead*packets/kFramesPerMilli);
+				printf("%8d %10d %11d %10s %18s%s\n", packets, inFlight, multiplier, time,
+					lead, ok ? "" : "  FAILED");
+				failures += !ok;
+			}
+		}
+	}
+	if(failures)
+	{
+		fprintf(stderr, "%d settings lost frames\n", failures);
+		return 1;
+	}
+	return 0;
+}
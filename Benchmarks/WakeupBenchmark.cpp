@@ -0,0 +1,108 @@
+// WakeupBenchmark.cpp
+//
+// Measures the latency from a producer thread queueing a frame to a consumer thread
+// starting to process it, when the consumer polls with a 500 µs sleep as the model's
+// process thread used to, and when it waits on a WakeupEvent.
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "LatencyHistogram.h"
+#include "WakeupEvent.h"
+
+using namespace std::chrono;
+
+namespace
+{
+
+constexpr int kFrames = 2000;
+constexpr auto kFramePeriod = microseconds(1000);
+
+// a one-slot mailbox standing in for the frame queue: the producer stores the time it
+// queued each frame, and the consumer takes it.
+class Mailbox
+{
+public:
+	void put(steady_clock::time_point t)
+	{
+		mTime.store(t.time_since_epoch().count());
+		mFrames.fetch_add(1);
+	}
+
+	bool take(steady_clock::time_point& t)
+	{
+		if(mTaken == mFrames.load()) return false;
+		mTaken++;
+		t = steady_clock::time_point(steady_clock::duration(mTime.load()));
+		return true;
+	}
+
+	int taken() const { return mTaken; }
+
+private:
+	std::atomic<steady_clock::rep> mTime{0};
+	std::atomic<int> mFrames{0};
+	int mTaken{0};
+};
+
+template<typename Wait>
+LatencyHistogram run(Wait wait, WakeupEvent* event)
+{
+	Mailbox mailbox;
+	LatencyHistogram latency;
+
+	std::thread producer([&]()
+	{
+		auto next = steady_clock::now();
+		for(int i=0; i<kFrames; ++i)
+		{
+			next += kFramePeriod;
+			std::this_thread::sleep_until(next);
+			mailbox.put(steady_clock::now());
+			if(event) event->notify();
+		}
+	});
+
+	while(mailbox.taken() < kFrames)
+	{
+		wait();
+		steady_clock::time_point t;
+		while(mailbox.take(t))
+		{
+			latency.add(duration_cast<microseconds>(steady_clock::now() - t).count());
+		}
+	}
+
+	producer.join();
+	return latency;
+}
+
+}
+
+int main(int argc, const char* argv[])
+{
+	LatencyHistogram polling = run([]()
+	{
+		std::this_thread::sleep_for(microseconds(500));
+	}, nullptr);
+
+	WakeupEvent event;
+	LatencyHistogram wakeup = run([&]()
+	{
+		event.waitUntil(steady_clock::now() + seconds(1));
+	}, &event);
+
+	std::cout << "sleep polling: ";
+	polling.dump(std::cout);
+	std::cout << "\n";
+	polling.dumpBuckets(std::cout);
+
+	std::cout << "wakeup event: ";
+	wakeup.dump(std::cout);
+	std::cout << "\n";
+	wakeup.dumpBuckets(std::cout);
+
+	return 0;
+}
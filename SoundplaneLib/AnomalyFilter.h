@@ -0,0 +1,99 @@
+// Driver for Soundplane Model A.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#ifndef __ANOMALY_FILTER__
+#define __ANOMALY_FILTER__
+
+#include <utility>
+
+#include "Metrics.h"
+#include "SoundplaneModelA.h"
+
+/**
+ * Sits between an Unpacker and the rest of a driver and drops frames that
+ * look like sensor glitches. After a startup period, each frame is compared
+ * with the previous one. If they differ by kMaxFrameDiff or more, the glitch
+ * callback is called instead of the success callback and the startup period
+ * begins again. Changing carriers also causes large differences, so drivers
+ * should call reset() when they do that.
+ *
+ * The callbacks have the signatures
+ *
+ *   void glitchCallback(int startupCtr, float df, const SensorFrame& previousFrame, const SensorFrame& frame);
+ *   void successCallback(const SensorFrame& frame);
+ */
+template<typename GlitchCallback, typename SuccessCallback>
+class AnomalyFilter
+{
+public:
+	AnomalyFilter(GlitchCallback glitchCallback, SuccessCallback successCallback) :
+		mGlitchCallback(std::move(glitchCallback)),
+		mSuccessCallback(std::move(successCallback)) {}
+
+	void operator()(const SensorFrame& frame)
+	{
+		if (mStartupCtr > kSoundplaneStartupFrames)
+		{
+			float df = frameDiff(mPreviousFrame, frame);
+			if (df < kMaxFrameDiff)
+			{
+				// We are OK, the data gets out normally
+				mSuccessCallback(frame);
+			}
+			else
+			{
+				// Possible sensor glitch.  also occurs when changing carriers.
+				mGlitchCallback(mStartupCtr, df, mPreviousFrame, frame);
+				reset();
+				countDroppedFrame();
+			}
+		}
+		else
+		{
+			// Wait for initialization
+			mStartupCtr++;
+			countDroppedFrame();
+		}
+
+		mPreviousFrame = frame;
+	}
+
+	void reset()
+	{
+		mStartupCtr = 0;
+	}
+
+	/**
+	 * Count the frames that are not passed on in metrics.
+	 */
+	void setMetrics(DriverMetrics* metrics)
+	{
+		mMetrics = metrics;
+	}
+
+private:
+	void countDroppedFrame()
+	{
+		if (mMetrics)
+		{
+			mMetrics->framesDropped.add();
+		}
+	}
+
+	SensorFrame mPreviousFrame{};
+	int mStartupCtr = 0;
+	GlitchCallback mGlitchCallback;
+	SuccessCallback mSuccessCallback;
+	DriverMetrics* mMetrics = nullptr;
+};
+
+template<typename GlitchCallback, typename SuccessCallback>
+AnomalyFilter<GlitchCallback, SuccessCallback> makeAnomalyFilter(
+	GlitchCallback glitchCallback, SuccessCallback successCallback)
+{
+	return AnomalyFilter<GlitchCallback, SuccessCallback>(
+		std::move(glitchCallback), std::move(successCallback));
+}
+
+#endif // __ANOMALY_FILTER__
@@ -0,0 +1,67 @@
+// CaptureFile.cpp
+//
+// Maps capture files written by CaptureRecorder for reading.
+
+#include "CaptureFile.h"
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+CaptureFile::~CaptureFile()
+{
+	close();
+}
+
+bool CaptureFile::open(const std::string& path)
+{
+	close();
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if(fd < 0) return false;
+
+	struct stat st;
+	if((fstat(fd, &st) != 0) || (static_cast<size_t>(st.st_size) < sizeof(CaptureFileHeader)))
+	{
+		::close(fd);
+		return false;
+	}
+
+	const size_t size = st.st_size;
+	void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(p == MAP_FAILED) return false;
+
+	const CaptureFileHeader* pHeader = static_cast<const CaptureFileHeader*>(p);
+	const bool valid = std::equal(kCaptureMagic, kCaptureMagic + sizeof(kCaptureMagic), pHeader->magic) &&
+		(pHeader->version == kCaptureVersion) &&
+		(pHeader->headerSize == sizeof(CaptureFileHeader)) &&
+		(pHeader->recordSize == sizeof(CaptureRecord));
+	if(!valid)
+	{
+		munmap(p, size);
+		return false;
+	}
+
+	// records are read in order.
+	madvise(p, size, MADV_SEQUENTIAL);
+
+	mData = static_cast<const unsigned char*>(p);
+	mSize = size;
+	mNumRecords = (size - sizeof(CaptureFileHeader))/sizeof(CaptureRecord);
+	return true;
+}
+
+void CaptureFile::close()
+{
+	if(mData)
+	{
+		munmap(const_cast<unsigned char*>(mData), mSize);
+	}
+	mData = nullptr;
+	mSize = 0;
+	mNumRecords = 0;
+}
@@ -0,0 +1,54 @@
+// Driver for Soundplane Model A.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#ifndef __CAPTURE_FILE__
+#define __CAPTURE_FILE__
+
+#include <cstddef>
+#include <string>
+
+#include "CaptureFormat.h"
+
+/**
+ * A read-only view of a capture file written by CaptureRecorder. The file is
+ * memory-mapped, so opening it is fast regardless of its size and records
+ * are read in place.
+ */
+class CaptureFile
+{
+public:
+	CaptureFile() = default;
+	~CaptureFile();
+
+	CaptureFile(const CaptureFile &) = delete;
+	CaptureFile &operator=(const CaptureFile &) = delete;
+
+	/**
+	 * Returns false if the file can't be mapped or is not a capture file of a
+	 * version we can read. A trailing partial record is ignored.
+	 */
+	bool open(const std::string& path);
+	void close();
+
+	bool isOpen() const { return mData != nullptr; }
+
+	const CaptureFileHeader& getHeader() const
+	{
+		return *reinterpret_cast<const CaptureFileHeader*>(mData);
+	}
+
+	size_t getNumRecords() const { return mNumRecords; }
+
+	const CaptureRecord& getRecord(size_t i) const
+	{
+		return reinterpret_cast<const CaptureRecord*>(mData + sizeof(CaptureFileHeader))[i];
+	}
+
+private:
+	const unsigned char* mData{nullptr};
+	size_t mSize{0};
+	size_t mNumRecords{0};
+};
+
+#endif // __CAPTURE_FILE__
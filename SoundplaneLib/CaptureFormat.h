@@ -0,0 +1,83 @@
+// Driver for Soundplane Model A.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#ifndef __CAPTURE_FORMAT__
+#define __CAPTURE_FORMAT__
+
+#include <cstdint>
+
+#include "SoundplaneModelA.h"
+
+// Soundplane capture files hold the packets a device sent, so that a session can be
+// replayed or analyzed later.
+//
+// A capture file is a CaptureFileHeader followed by any number of CaptureRecords, all
+// little-endian. Records have a fixed size, so a file can be memory-mapped and record i
+// read at sizeof(CaptureFileHeader) + i*sizeof(CaptureRecord). Files are only ever
+// appended to and the number of records follows from the file size, so a capture that
+// was cut short is readable up to its last whole record.
+//
+// Each packet is stored as sent, with its 12-bit taxels still packed. At the full frame
+// rate two endpoints make about 780 KB/s.
+
+const char kCaptureMagic[8] = { 'S', 'P', 'C', 'A', 'P', 'T', 'U', 'R' };
+const uint32_t kCaptureVersion = 1;
+
+struct CaptureFileHeader
+{
+	char magic[8];
+	uint32_t version;
+
+	// sizeof(CaptureFileHeader) and sizeof(CaptureRecord) when the file was written.
+	uint32_t headerSize;
+	uint32_t recordSize;
+
+	uint16_t firmwareVersion;
+	uint16_t reserved;
+
+	// system clock time when the capture started, in nanoseconds since 1970.
+	int64_t startTime;
+
+	// null-terminated.
+	char serialNumber[64];
+
+	// the carriers when the capture started.
+	unsigned char carriers[kSoundplaneNumCarriers];
+}; // 128 bytes
+
+enum CaptureRecordType : uint8_t
+{
+	// one packet from one endpoint. data holds the packed taxels.
+	kCapturePacket = 0,
+
+	// new carriers were sent to the device. data holds kSoundplaneNumCarriers carriers.
+	kCaptureCarriers = 1,
+
+	// a new carrier mask was sent to the device. data holds it as a uint32_t.
+	kCaptureCarrierMask = 2
+};
+
+struct CaptureRecord
+{
+	uint8_t type;
+
+	// for packets, the endpoint index and the sequence number.
+	uint8_t endpoint;
+	uint16_t seqNum;
+
+	// for packets, the number of bytes the device sent, normally 386, or 0 if the packet
+	// was lost. For other records the size of the data.
+	uint32_t size;
+
+	// steady clock time since the start of the capture, in nanoseconds. For packets, the
+	// time the transfer holding them arrived, so all packets of a transfer share it.
+	int64_t time;
+
+	unsigned char data[kSoundplaneAPackedDataSize];
+}; // 400 bytes
+
+static_assert(sizeof(CaptureFileHeader) == 128, "unexpected CaptureFileHeader size");
+static_assert(sizeof(CaptureRecord) == 400, "unexpected CaptureRecord size");
+
+#endif // __CAPTURE_FORMAT__
@@ -0,0 +1,138 @@
+// CaptureRecorder.cpp
+//
+// Records what a Soundplane sends to a capture file. The driver thread copies records
+// into a ring and a writer thread appends them to the file.
+
+#include "CaptureRecorder.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std::chrono;
+
+namespace
+{
+	// file buffer for the writer thread, so that records go to the OS in large writes.
+	constexpr size_t kFileBufferSize = 1 << 18;
+}
+
+CaptureRecorder::CaptureRecorder(const std::string& path, const std::string& serialNumber,
+	uint16_t firmwareVersion, const unsigned char* carriers) :
+	mStartTime(steady_clock::now())
+{
+	mFile = fopen(path.c_str(), "wb");
+	if(!mFile) return;
+	setvbuf(mFile, nullptr, _IOFBF, kFileBufferSize);
+
+	CaptureFileHeader header{};
+	std::copy(kCaptureMagic, kCaptureMagic + sizeof(kCaptureMagic), header.magic);
+	header.version = kCaptureVersion;
+	header.headerSize = sizeof(CaptureFileHeader);
+	header.recordSize = sizeof(CaptureRecord);
+	header.firmwareVersion = firmwareVersion;
+	header.startTime = duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+	strncpy(header.serialNumber, serialNumber.c_str(), sizeof(header.serialNumber) - 1);
+	std::copy(carriers, carriers + kSoundplaneNumCarriers, header.carriers);
+
+	if(fwrite(&header, sizeof(header), 1, mFile) != 1)
+	{
+		fclose(mFile);
+		mFile = nullptr;
+		return;
+	}
+	fflush(mFile);
+
+	mWriteThread = std::thread(&CaptureRecorder::writeThread, this);
+}
+
+CaptureRecorder::~CaptureRecorder()
+{
+	if(mWriteThread.joinable())
+	{
+		mQuitting.store(true);
+		mQuitEvent.notify();
+		mWriteThread.join();
+	}
+	if(mFile)
+	{
+		fclose(mFile);
+	}
+}
+
+CaptureRecord* CaptureRecorder::beginRecord(CaptureRecordType type, steady_clock::time_point time)
+{
+	if(!mFile) return nullptr;
+	CaptureRecord* pRecord = mRing.reserve();
+	if(pRecord)
+	{
+		pRecord->type = type;
+		pRecord->endpoint = 0;
+		pRecord->seqNum = 0;
+		pRecord->time = duration_cast<nanoseconds>(time - mStartTime).count();
+	}
+	return pRecord;
+}
+
+void CaptureRecorder::recordPacket(int endpoint, const SoundplaneADataPacket& packet, uint32_t size,
+	steady_clock::time_point arrival)
+{
+	if(CaptureRecord* pRecord = beginRecord(kCapturePacket, arrival))
+	{
+		pRecord->endpoint = static_cast<uint8_t>(endpoint);
+		pRecord->seqNum = packet.seqNum;
+		pRecord->size = size;
+		std::copy(packet.packedData, packet.packedData + kSoundplaneAPackedDataSize, pRecord->data);
+		mRing.commit();
+	}
+}
+
+void CaptureRecorder::recordCarriers(const unsigned char* carriers, steady_clock::time_point time)
+{
+	if(CaptureRecord* pRecord = beginRecord(kCaptureCarriers, time))
+	{
+		pRecord->size = kSoundplaneNumCarriers;
+		std::fill(pRecord->data, pRecord->data + kSoundplaneAPackedDataSize, 0);
+		std::copy(carriers, carriers + kSoundplaneNumCarriers, pRecord->data);
+		mRing.commit();
+	}
+}
+
+void CaptureRecorder::recordCarrierMask(unsigned long mask, steady_clock::time_point time)
+{
+	if(CaptureRecord* pRecord = beginRecord(kCaptureCarrierMask, time))
+	{
+		const uint32_t mask32 = static_cast<uint32_t>(mask);
+		pRecord->size = sizeof(mask32);
+		std::fill(pRecord->data, pRecord->data + kSoundplaneAPackedDataSize, 0);
+		memcpy(pRecord->data, &mask32, sizeof(mask32));
+		mRing.commit();
+	}
+}
+
+void CaptureRecorder::writeThread()
+{
+	while(!mQuitting.load())
+	{
+		mQuitEvent.waitUntil(steady_clock::now() + milliseconds(kWriteIntervalMillis));
+		writeRecords();
+	}
+	writeRecords();
+}
+
+void CaptureRecorder::writeRecords()
+{
+	uint64_t written = 0;
+	while(const CaptureRecord* pRecord = mRing.acquire())
+	{
+		if(fwrite(pRecord, sizeof(CaptureRecord), 1, mFile) == 1)
+		{
+			written++;
+		}
+		mRing.release();
+	}
+	if(written)
+	{
+		fflush(mFile);
+		mRecordsWritten.fetch_add(written, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,86 @@
+// Driver for Soundplane Model A.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#ifndef __CAPTURE_RECORDER__
+#define __CAPTURE_RECORDER__
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "CaptureFormat.h"
+#include "SoundplaneModelA.h"
+#include "SPSCRing.h"
+#include "WakeupEvent.h"
+
+/**
+ * Writes a capture file (see CaptureFormat.h) from the packets and carrier
+ * changes a driver reports. The driver thread only copies each record into a
+ * preallocated ring, so recording never blocks it or allocates. A writer
+ * thread empties the ring to the file in the background. If the writer falls
+ * behind by more than the ring holds, new records are dropped and counted.
+ *
+ * The record functions must all be called from one thread, the driver's.
+ */
+class CaptureRecorder
+{
+public:
+	/**
+	 * Creates the file and writes its header. Check isOpen() for success.
+	 * carriers has kSoundplaneNumCarriers elements.
+	 */
+	CaptureRecorder(const std::string& path, const std::string& serialNumber,
+		uint16_t firmwareVersion, const unsigned char* carriers);
+
+	/**
+	 * Writes the records that are still in the ring and closes the file.
+	 */
+	~CaptureRecorder();
+
+	CaptureRecorder(const CaptureRecorder &) = delete;
+	CaptureRecorder &operator=(const CaptureRecorder &) = delete;
+
+	bool isOpen() const { return mFile != nullptr; }
+
+	// driver thread
+
+	/**
+	 * size is the number of bytes the device sent for the packet, or 0 if it
+	 * was lost. arrival is the time the transfer holding the packet completed.
+	 */
+	void recordPacket(int endpoint, const SoundplaneADataPacket& packet, uint32_t size,
+		std::chrono::steady_clock::time_point arrival);
+	void recordCarriers(const unsigned char* carriers, std::chrono::steady_clock::time_point time);
+	void recordCarrierMask(unsigned long mask, std::chrono::steady_clock::time_point time);
+
+	// any thread
+
+	uint64_t getRecordsWritten() const { return mRecordsWritten.load(std::memory_order_relaxed); }
+	uint64_t getRecordsDropped() const { return mRing.getOverflowCount(); }
+
+private:
+	// about four seconds of packets.
+	static constexpr size_t kRingSize = 8192;
+
+	// how often the writer thread empties the ring.
+	static constexpr int kWriteIntervalMillis = 20;
+
+	CaptureRecord* beginRecord(CaptureRecordType type, std::chrono::steady_clock::time_point time);
+	void writeThread();
+	void writeRecords();
+
+	FILE* mFile{nullptr};
+	const std::chrono::steady_clock::time_point mStartTime;
+
+	SPSCRing<CaptureRecord> mRing{kRingSize};
+	std::atomic<uint64_t> mRecordsWritten{0};
+
+	std::atomic<bool> mQuitting{false};
+	WakeupEvent mQuitEvent;
+	std::thread mWriteThread;
+};
+
+#endif // __CAPTURE_RECORDER__
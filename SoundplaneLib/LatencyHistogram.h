@@ -0,0 +1,97 @@
+// Driver for Soundplane Model A.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#ifndef __LATENCY_HISTOGRAM__
+#define __LATENCY_HISTOGRAM__
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+// A histogram of latencies in microseconds with power of two buckets. Bucket 0 counts
+// latencies under 1 µs and bucket i counts latencies in [2^(i-1), 2^i) µs. The last
+// bucket also counts anything longer. Adding a value never allocates, so it can be
+// done on the processing thread.
+class LatencyHistogram
+{
+public:
+	static constexpr int kBuckets = 24;
+
+	void clear()
+	{
+		mCounts.fill(0);
+		mCount = 0;
+		mMax = 0;
+	}
+
+	void add(int64_t micros)
+	{
+		micros = std::max(micros, int64_t(0));
+		int bucket = 0;
+		while((bucket < kBuckets - 1) && (micros >= (int64_t(1) << bucket)))
+		{
+			bucket++;
+		}
+		mCounts[bucket]++;
+		mCount++;
+		mMax = std::max(mMax, micros);
+	}
+
+	uint64_t getCount() const { return mCount; }
+	int64_t getMax() const { return mMax; }
+	uint64_t getBucketCount(int bucket) const { return mCounts[bucket]; }
+
+	// the upper bound in µs of bucket i.
+	static int64_t getBucketLimit(int bucket) { return int64_t(1) << bucket; }
+
+	// an upper bound in µs for the given fraction of latencies, for example 0.99 for the
+	// 99th percentile. Accurate to within a factor of two.
+	int64_t getPercentile(double p) const
+	{
+		if(!mCount) return 0;
+		const double target = p*mCount;
+		uint64_t sum = 0;
+		for(int i=0; i<kBuckets - 1; ++i)
+		{
+			sum += mCounts[i];
+			if(sum >= target)
+			{
+				return std::min(getBucketLimit(i), mMax);
+			}
+		}
+		return mMax;
+	}
+
+	// one line summary.
+	void dump(std::ostream& s) const
+	{
+		s << "n: " << mCount << " p50: " << getPercentile(0.5) << "us p99: " << getPercentile(0.99)
+			<< "us max: " << mMax << "us";
+	}
+
+	// one line per nonempty bucket.
+	void dumpBuckets(std::ostream& s) const
+	{
+		for(int i=0; i<kBuckets; ++i)
+		{
+			if(!mCounts[i]) continue;
+			if(i < kBuckets - 1)
+			{
+				s << "  < " << getBucketLimit(i) << "us: " << mCounts[i] << "\n";
+			}
+			else
+			{
+				s << "  >= " << getBucketLimit(i - 1) << "us: " << mCounts[i] << "\n";
+			}
+		}
+	}
+
+private:
+	std::array<uint64_t, kBuckets> mCounts{};
+	uint64_t mCount{0};
+	int64_t mMax{0};
+};
+
+#endif // __LATENCY_HISTOGRAM__
@@ -0,0 +1,194 @@
+// LatencyTrace.cpp
+//
+// Process-wide switch for latency tracing, and the writers for collected frame traces.
+
+#include "LatencyTrace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+constexpr size_t LatencyTrace::kDefaultCapacity;
+constexpr size_t LatencyTraceLog::kDefaultMaxFrames;
+
+std::atomic<bool> LatencyTrace::sEnabled{false};
+std::atomic<int64_t> LatencyTrace::sEnableTime{0};
+
+namespace
+{
+
+const char* kTracePointNames[kTracePoints] =
+{
+	"transfer",
+	"unpacker match",
+	"queue push",
+	"queue pop",
+	"tracker done",
+	"zones done",
+	"output send"
+};
+
+// the stage ending at each point, and the thread it runs on, for the Chrome trace.
+const char* kStageNames[kTracePoints] =
+{
+	"",
+	"unpack",
+	"filter and commit",
+	"queue",
+	"track",
+	"zones",
+	"output"
+};
+
+enum
+{
+	kDriverThread = 1,
+	kQueue = 2,
+	kProcessThread = 3
+};
+
+const int kStageThreads[kTracePoints] =
+{
+	kDriverThread,
+	kDriverThread,
+	kDriverThread,
+	kQueue,
+	kProcessThread,
+	kProcessThread,
+	kProcessThread
+};
+
+// the pth percentile of sorted values, by the nearest rank.
+int64_t percentile(const std::vector<int64_t>& sorted, double p)
+{
+	if(sorted.empty()) return 0;
+	size_t rank = static_cast<size_t>(p*sorted.size() + 0.999999);
+	rank = std::min(std::max(rank, size_t(1)), sorted.size());
+	return sorted[rank - 1];
+}
+
+void writeStageSummary(std::ostream& s, const char* name, std::vector<int64_t>& nanos)
+{
+	std::sort(nanos.begin(), nanos.end());
+	char line[160];
+	snprintf(line, sizeof(line), "%-36s %8zu %9.1f %9.1f %9.1f %9.1f\n", name, nanos.size(),
+		percentile(nanos, 0.5)/1000., percentile(nanos, 0.99)/1000., percentile(nanos, 0.999)/1000.,
+		(nanos.empty() ? 0 : nanos.back())/1000.);
+	s << line;
+}
+
+}
+
+const char* getTracePointName(int point)
+{
+	return ((point >= 0) && (point < kTracePoints)) ? kTracePointNames[point] : "";
+}
+
+void LatencyTrace::setEnabled(bool b)
+{
+	if(b && !isEnabled())
+	{
+		sEnableTime.store(now(), std::memory_order_relaxed);
+	}
+	sEnabled.store(b, std::memory_order_relaxed);
+}
+
+void LatencyTraceLog::clear()
+{
+	mFrames.clear();
+	mDropped = 0;
+}
+
+void LatencyTraceLog::add(const FrameTrace& trace)
+{
+	if(mFrames.size() >= mMaxFrames)
+	{
+		mDropped++;
+		return;
+	}
+	mFrames.push_back(trace);
+	const int64_t start = LatencyTrace::getEnableTime();
+	for(auto& t : mFrames.back().times)
+	{
+		if(t < start)
+		{
+			t = 0;
+		}
+	}
+}
+
+void LatencyTraceLog::writeChromeTrace(std::ostream& s) const
+{
+	// timestamps in the file are in microseconds from the first one.
+	int64_t origin = 0;
+	for(const auto& f : mFrames)
+	{
+		for(int64_t t : f.times)
+		{
+			if(t && (!origin || t < origin))
+			{
+				origin = t;
+			}
+		}
+	}
+
+	s << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+	const char* threadNames[] = {"", "driver thread", "frame ring", "processing thread"};
+	for(int tid = kDriverThread; tid <= kProcessThread; ++tid)
+	{
+		s << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+			<< ",\"args\":{\"name\":\"" << threadNames[tid] << "\"}},\n";
+	}
+
+	char event[256];
+	bool first = true;
+	for(size_t frame = 0; frame < mFrames.size(); ++frame)
+	{
+		const auto& times = mFrames[frame].times;
+		for(int p=1; p<kTracePoints; ++p)
+		{
+			if(!times[p] || !times[p - 1]) continue;
+			snprintf(event, sizeof(event),
+				"%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%zu}}",
+				first ? "" : ",\n", kStageNames[p], kStageThreads[p], (times[p - 1] - origin)/1000.,
+				(times[p] - times[p - 1])/1000., frame);
+			s << event;
+			first = false;
+		}
+	}
+	s << "\n]}\n";
+}
+
+void LatencyTraceLog::writeSummary(std::ostream& s) const
+{
+	std::vector<int64_t> stages[kTracePoints];
+	std::vector<int64_t> toOutput;
+	for(const auto& f : mFrames)
+	{
+		for(int p=1; p<kTracePoints; ++p)
+		{
+			if(f.times[p] && f.times[p - 1])
+			{
+				stages[p].push_back(f.times[p] - f.times[p - 1]);
+			}
+		}
+		if(f.times[kTraceTransfer] && f.times[kTraceOutputSend])
+		{
+			toOutput.push_back(f.times[kTraceOutputSend] - f.times[kTraceTransfer]);
+		}
+	}
+
+	char header[160];
+	snprintf(header, sizeof(header), "%-36s %8s %9s %9s %9s %9s\n", "latency (us)", "frames", "p50", "p99", "p99.9", "max");
+	s << header;
+	for(int p=1; p<kTracePoints; ++p)
+	{
+		std::string name = std::string(kTracePointNames[p - 1]) + " -> " + kTracePointNames[p];
+		writeStageSummary(s, name.c_str(), stages[p]);
+	}
+	writeStageSummary(s, "transfer -> output send", toOutput);
+	if(mDropped)
+	{
+		s << mDropped << " frames not kept\n";
+	}
+}
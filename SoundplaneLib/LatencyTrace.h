@@ -0,0 +1,158 @@
+// Driver for Soundplane Model A.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#ifndef __LATENCY_TRACE__
+#define __LATENCY_TRACE__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "SPSCRing.h"
+
+// the points in the path of a frame from the USB stack to the outputs where it is
+// timestamped, in order.
+enum TracePoint
+{
+	kTraceTransfer = 0,   // transfer callback, for the transfer that completed the frame
+	kTraceUnpackerMatch,  // the Unpacker matched the packets of both endpoints
+	kTraceQueuePush,      // the driver committed the frame to its frame ring
+	kTraceQueuePop,       // the processing thread acquired the frame
+	kTraceTrackerDone,    // touches tracked
+	kTraceZonesDone,      // touches sent to the zones
+	kTraceOutputSend,     // outputs sent. Frames are not sent when nothing has changed
+	                      // since the last one sent within the data rate.
+	kTracePoints
+};
+
+const char* getTracePointName(int point);
+
+/**
+ * The timestamps of one frame, in nanoseconds on the steady clock. Points the
+ * frame did not reach, or that were not marked while tracing was enabled, are 0.
+ */
+struct FrameTrace
+{
+	std::array<int64_t, kTracePoints> times{};
+
+	/**
+	 * Timestamp the point if tracing is enabled. When it is not, this costs one
+	 * relaxed atomic load and a branch.
+	 */
+	void mark(TracePoint p);
+};
+
+/**
+ * A lock-free ring of frame traces. The processing thread pushes the trace of
+ * each frame it finishes, and another thread drains them, for example into a
+ * LatencyTraceLog. If the ring is full the newest trace is dropped, so the
+ * processing thread never waits.
+ *
+ * Tracing is enabled for the whole process with setEnabled(). While it is
+ * disabled, FrameTrace::mark() does not read the clock and nothing should be
+ * pushed. The cost of the enabled path is measured by the LatencyTrace
+ * benchmarks in micro_benchmark.
+ */
+class LatencyTrace
+{
+public:
+	static constexpr size_t kDefaultCapacity = 4096;
+
+	explicit LatencyTrace(size_t capacity = kDefaultCapacity) : mRing(capacity) {}
+
+	static void setEnabled(bool b);
+	static bool isEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+
+	// the time tracing was last enabled. Timestamps before this are left over from
+	// an earlier trace.
+	static int64_t getEnableTime() { return sEnableTime.load(std::memory_order_relaxed); }
+
+	static int64_t now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// producer
+	void push(const FrameTrace& trace)
+	{
+		if(FrameTrace* pSlot = mRing.reserve())
+		{
+			*pSlot = trace;
+			mRing.commit();
+		}
+	}
+
+	// consumer: call fn(const FrameTrace&) for each trace pushed since the last drain().
+	// Returns the number of traces.
+	template<typename Fn>
+	size_t drain(Fn fn)
+	{
+		size_t n = 0;
+		while(const FrameTrace* pTrace = mRing.acquire())
+		{
+			fn(*pTrace);
+			mRing.release();
+			n++;
+		}
+		return n;
+	}
+
+	// the number of traces dropped because the ring was full.
+	uint64_t getDroppedCount() const { return mRing.getOverflowCount(); }
+
+private:
+	static std::atomic<bool> sEnabled;
+	static std::atomic<int64_t> sEnableTime;
+
+	SPSCRing<FrameTrace> mRing;
+};
+
+inline void FrameTrace::mark(TracePoint p)
+{
+	if(LatencyTrace::isEnabled())
+	{
+		times[p] = LatencyTrace::now();
+	}
+}
+
+/**
+ * Frame traces collected from a LatencyTrace, with writers for the Chrome
+ * trace event format (load the file in chrome://tracing or Perfetto) and for a
+ * summary of the latency of each stage. Not for the processing thread: adding
+ * may allocate.
+ */
+class LatencyTraceLog
+{
+public:
+	// keep up to maxFrames traces. Later ones are counted but not kept.
+	explicit LatencyTraceLog(size_t maxFrames = kDefaultMaxFrames) : mMaxFrames(maxFrames) {}
+
+	static constexpr size_t kDefaultMaxFrames = 1 << 20;
+
+	void clear();
+
+	// add a trace, dropping any timestamps from before tracing was enabled.
+	void add(const FrameTrace& trace);
+
+	size_t size() const { return mFrames.size(); }
+	uint64_t getDroppedCount() const { return mDropped; }
+
+	// one complete event per stage of each frame, on a track for each thread.
+	void writeChromeTrace(std::ostream& s) const;
+
+	// p50, p99, p99.9 and max in microseconds for each stage, and from the
+	// transfer to the output.
+	void writeSummary(std::ostream& s) const;
+
+private:
+	size_t mMaxFrames;
+	std::vector<FrameTrace> mFrames;
+	uint64_t mDropped{0};
+};
+
+#endif // __LATENCY_TRACE__
@@ -1,7 +1,7 @@
 // SoundplaneDriver.cpp
 //
-// Returns raw data frames from the Soundplane.  The frames are reclocked if needed (TODO)
-// to reconstruct a steady sample rate.
+// Returns raw data frames from the Soundplane.  The frames are reclocked, and short gaps
+// filled in, to reconstruct a steady sample rate.
 //
 // Two threads are used to do this work.  A grab thread maintains a stream of
 // low-latency isochronous transfers. A process thread looks through the buffers
@@ -12,68 +12,20 @@
 #include "LibusbSoundplaneDriver.h"
 
 #include <assert.h>
+#include <functional>
 #include <string.h>
 #include <unistd.h>
 
+#include "AnomalyFilter.h"
+#include "CaptureRecorder.h"
+#include "Reclocker.h"
+#include "ThreadUtility.h"
+
 namespace
 {
 
 constexpr int kInterfaceNumber = 0;
 
-template<typename GlitchCallback, typename SuccessCallback>
-class AnomalyFilter
-{
-public:
-	AnomalyFilter(GlitchCallback glitchCallback, SuccessCallback successCallback) :
-		mGlitchCallback(std::move(glitchCallback)),
-		mSuccessCallback(std::move(successCallback)) {}
-
-	void operator()(const SoundplaneOutputFrame& frame)
-	{
-		if (mStartupCtr > kSoundplaneStartupFrames)
-		{
-			float df = frameDiff(mPreviousFrame, frame);
-			if (df < kMaxFrameDiff)
-			{
-				// We are OK, the data gets out normally
-				mSuccessCallback(frame);
-			}
-			else
-			{
-				// Possible sensor glitch.  also occurs when changing carriers.
-				mGlitchCallback(mStartupCtr, df, mPreviousFrame, frame);
-				reset();
-			}
-		}
-		else
-		{
-			// Wait for initialization
-			mStartupCtr++;
-		}
-
-		mPreviousFrame = frame;
-	}
-
-	void reset()
-	{
-		mStartupCtr = 0;
-	}
-
-private:
-	SoundplaneOutputFrame mPreviousFrame;
-	int mStartupCtr = 0;
-	GlitchCallback mGlitchCallback;
-	SuccessCallback mSuccessCallback;
-};
-
-template<typename GlitchCallback, typename SuccessCallback>
-AnomalyFilter<GlitchCallback, SuccessCallback> makeAnomalyFilter(
-	GlitchCallback glitchCallback, SuccessCallback successCallback)
-{
-	return AnomalyFilter<GlitchCallback, SuccessCallback>(
-		std::move(glitchCallback), std::move(successCallback));
-}
-
 bool libusbTransferStatusIsFatal(libusb_transfer_status error)
 {
 	return
@@ -84,30 +36,36 @@ bool libusbTransferStatusIsFatal(libusb_transfer_status error)
 
 }
 
-std::unique_ptr<SoundplaneDriver> SoundplaneDriver::create(SoundplaneDriverListener *listener)
+constexpr int LibusbTransferConfig::kMaxPacketsPerTransfer;
+constexpr int LibusbTransferConfig::kMaxBuffersInFlight;
+constexpr int LibusbTransferConfig::kMaxInFlightMultiplier;
+
+std::unique_ptr<SoundplaneDriver> SoundplaneDriver::create(SoundplaneDriverListener& listener)
 {
-	auto *driver = new LibusbSoundplaneDriver(listener);
-	driver->init();
-	return std::unique_ptr<LibusbSoundplaneDriver>(driver);
+	return std::unique_ptr<LibusbSoundplaneDriver>(new LibusbSoundplaneDriver(listener));
 }
 
 
-LibusbSoundplaneDriver::LibusbSoundplaneDriver(SoundplaneDriverListener* listener) :
+LibusbSoundplaneDriver::LibusbSoundplaneDriver(SoundplaneDriverListener& listener, const LibusbTransferConfig& config) :
 	mState(kNoDevice),
 	mQuitting(false),
 	mListener(listener),
+	mTransferConfig(config.isValid() ? config : LibusbTransferConfig()),
 	mSetCarriersRequest(nullptr),
 	mEnableCarriersRequest(nullptr)
 {
-	assert(listener);
+	std::copy(kDefaultCarriers, kDefaultCarriers + kSoundplaneNumCarriers, mCurrentCarriers.begin());
 }
 
 LibusbSoundplaneDriver::~LibusbSoundplaneDriver()
 {
-	// This causes getDeviceState to return kDeviceIsTerminating
+	// This causes getDeviceState to return kDeviceClosing
 	mQuitting.store(true, std::memory_order_release);
 	mCondition.notify_one();
-	mProcessThread.join();
+	if (mProcessThread.joinable())
+	{
+		mProcessThread.join();
+	}
 
 	delete mEnableCarriersRequest.load(std::memory_order_acquire);
 	delete mSetCarriersRequest.load(std::memory_order_acquire);
@@ -115,7 +73,7 @@ LibusbSoundplaneDriver::~LibusbSoundplaneDriver()
 	libusb_exit(mLibusbContext);
 }
 
-void LibusbSoundplaneDriver::init()
+void LibusbSoundplaneDriver::start()
 {
 	if (libusb_init(&mLibusbContext) < 0) {
 		throw new std::runtime_error("Failed to initialize libusb");
@@ -123,12 +81,13 @@ void LibusbSoundplaneDriver::init()
 
 	// create device grab thread
 	mProcessThread = std::thread(&LibusbSoundplaneDriver::processThread, this);
+	setThreadRealtime(mProcessThread.native_handle(), kRealtimeDriverThread);
 }
 
-MLSoundplaneState LibusbSoundplaneDriver::getDeviceState() const
+int LibusbSoundplaneDriver::getDeviceState() const
 {
 	return mQuitting.load(std::memory_order_acquire) ?
-		kDeviceIsTerminating :
+		kDeviceClosing :
 		mState.load(std::memory_order_acquire);
 }
 
@@ -162,6 +121,23 @@ void LibusbSoundplaneDriver::enableCarriers(unsigned long mask)
 		new unsigned long(mask), std::memory_order_release);
 }
 
+int LibusbSoundplaneDriver::getSerialNumber() const
+{
+	const auto state = getDeviceState();
+	if (state == kDeviceConnected || state == kDeviceHasIsochSync)
+	{
+		try
+		{
+			return std::stoi(getSerialNumberString());
+		}
+		catch (...)
+		{
+			return 0;
+		}
+	}
+	return 0;
+}
+
 void LibusbSoundplaneDriver::processThreadControlTransferCallback(struct libusb_transfer *xfr) {
 	LibusbSoundplaneDriver* driver = static_cast<LibusbSoundplaneDriver*>(xfr->user_data);
 	driver->mOutstandingTransfers--;
@@ -260,6 +236,24 @@ bool LibusbSoundplaneDriver::processThreadGetDeviceInfo(libusb_device_handle *de
 	return true;
 }
 
+bool LibusbSoundplaneDriver::processThreadAllocateTransfers(Transfers &transfers) const
+{
+	for (auto &transfersForEndpoint : transfers)
+	{
+		transfersForEndpoint.clear();
+		for (int j = 0; j < mTransferConfig.getBuffersPerEndpoint(); j++)
+		{
+			transfersForEndpoint.emplace_back(new Transfer(mTransferConfig.packetsPerTransfer));
+			if (!transfersForEndpoint.back()->transfer)
+			{
+				fprintf(stderr, "Failed to allocate USB transfers\n");
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
 bool LibusbSoundplaneDriver::processThreadFillTransferInformation(
 	Transfers &transfers,
 	LibusbUnpacker *unpacker,
@@ -297,30 +291,38 @@ bool LibusbSoundplaneDriver::processThreadFillTransferInformation(
 		auto &transfersForEndpoint = transfers[i];
 		for (int j = 0; j < transfersForEndpoint.size(); j++)
 		{
-			auto &transfer = transfersForEndpoint[j];
+			auto &transfer = *transfersForEndpoint[j];
 			transfer.endpointId = i;
 			transfer.endpointAddress = endpoint.bEndpointAddress;
 			transfer.device = device;
 			transfer.parent = this;
 			transfer.unpacker = unpacker;
-			// Divide the transfers into groups of kInFlightMultiplier. Within
+			// Divide the transfers into groups of inFlightMultiplier. Within
 			// each group, each transfer points to the previous one, except for
 			// the first, which points to the last one. With this scheme, the
-			// nextTransfer pointers form cycles of length kInFlightMultiplier.
+			// nextTransfer pointers form cycles of length inFlightMultiplier.
 			//
 			// @see The nextTransfer member declaration
-			const bool isAtStartOfCycle = j % kInFlightMultiplier == 0;
-			transfer.nextTransfer = &transfersForEndpoint[j + (isAtStartOfCycle ? kInFlightMultiplier - 1 : -1)];
+			const int multiplier = mTransferConfig.inFlightMultiplier;
+			const bool isAtStartOfCycle = j % multiplier == 0;
+			transfer.nextTransfer = transfersForEndpoint[j + (isAtStartOfCycle ? multiplier - 1 : -1)].get();
 		}
 	}
 
 	return true;
 }
 
-bool LibusbSoundplaneDriver::processThreadSetDeviceState(MLSoundplaneState newState)
+bool LibusbSoundplaneDriver::processThreadSetDeviceState(int newState)
 {
-	mState.store(newState, std::memory_order_release);
-	mListener->deviceStateChanged(*this, newState);
+	const int previousState = mState.exchange(newState, std::memory_order_acq_rel);
+	if (newState == kDeviceConnected)
+	{
+		mListener.onStartup();
+	}
+	else if (newState == kNoDevice && previousState != kNoDevice)
+	{
+		mListener.onClose();
+	}
 	return !mQuitting.load(std::memory_order_acquire);
 }
 
@@ -349,15 +351,15 @@ bool LibusbSoundplaneDriver::processThreadScheduleTransfer(Transfer &transfer)
 		transfer.transfer,
 		transfer.device,
 		transfer.endpointAddress,
-		reinterpret_cast<unsigned char *>(transfer.packets),
-		sizeof(transfer.packets),
+		reinterpret_cast<unsigned char *>(transfer.packets.data()),
+		transfer.numPackets() * sizeof(SoundplaneADataPacket),
 		transfer.numPackets(),
 		processThreadTransferCallbackStatic,
 		&transfer,
 		1000);
 	libusb_set_iso_packet_lengths(
 		transfer.transfer,
-		sizeof(transfer.packets) / transfer.numPackets());
+		sizeof(SoundplaneADataPacket));
 
 	const auto result = libusb_submit_transfer(transfer.transfer);
 	if (result < 0)
@@ -377,9 +379,9 @@ bool LibusbSoundplaneDriver::processThreadScheduleInitialTransfers(
 {
 	for (int endpoint = 0; endpoint < kSoundplaneANumEndpoints; endpoint++)
 	{
-		for (int buffer = 0; buffer < kSoundplaneABuffersInFlight; buffer++)
+		for (int buffer = 0; buffer < mTransferConfig.buffersInFlight; buffer++)
 		{
-			auto &transfer = transfers[endpoint][buffer * kInFlightMultiplier];
+			auto &transfer = *transfers[endpoint][buffer * mTransferConfig.inFlightMultiplier];
 			if (!processThreadScheduleTransfer(transfer)) {
 				return false;
 			}
@@ -397,6 +399,9 @@ void LibusbSoundplaneDriver::processThreadTransferCallbackStatic(struct libusb_t
 
 void LibusbSoundplaneDriver::processThreadTransferCallback(Transfer &transfer)
 {
+	mTransferTime = std::chrono::steady_clock::now();
+	getPendingTrace().mark(kTraceTransfer);
+
 	// Check if the transfer was successful
 	const auto status = transfer.transfer->status;
 	if (status != LIBUSB_TRANSFER_COMPLETED)
@@ -416,9 +421,24 @@ void LibusbSoundplaneDriver::processThreadTransferCallback(Transfer &transfer)
 		processThreadSetDeviceState(kDeviceHasIsochSync);
 	}
 
+	{
+		CaptureRecorderUse recorder(*this);
+		if (recorder)
+		{
+			for (int i = 0; i < transfer.transfer->num_iso_packets; i++)
+			{
+				recorder->recordPacket(
+					transfer.endpointId,
+					transfer.packets[i],
+					transfer.transfer->iso_packet_desc[i].actual_length,
+					mTransferTime);
+			}
+		}
+	}
+
 	transfer.unpacker->gotTransfer(
 		transfer.endpointId,
-		transfer.packets,
+		transfer.packets.data(),
 		transfer.transfer->num_iso_packets);
 
 	// Schedule another transfer
@@ -444,10 +464,19 @@ libusb_error LibusbSoundplaneDriver::processThreadSetCarriers(
 
 bool LibusbSoundplaneDriver::processThreadHandleRequests(libusb_device_handle *device)
 {
+	// the recorder is only held while recording, not during the control transfers,
+	// which can block.
 	const auto carrierMask = mEnableCarriersRequest.exchange(nullptr, std::memory_order_acquire);
 	if (carrierMask)
 	{
 		unsigned long mask = *carrierMask;
+		{
+			CaptureRecorderUse recorder(*this);
+			if (recorder)
+			{
+				recorder->recordCarrierMask(mask, std::chrono::steady_clock::now());
+			}
+		}
 		processThreadSendControl(
 			device,
 			kRequestMask,
@@ -460,6 +489,13 @@ bool LibusbSoundplaneDriver::processThreadHandleRequests(libusb_device_handle *d
 	const auto carriers = mSetCarriersRequest.exchange(nullptr, std::memory_order_acquire);
 	if (carriers)
 	{
+		{
+			CaptureRecorderUse recorder(*this);
+			if (recorder)
+			{
+				recorder->recordCarriers(carriers->data(), std::chrono::steady_clock::now());
+			}
+		}
 		processThreadSetCarriers(device, carriers->data(), carriers->size());
 		delete carriers;
 	}
@@ -477,23 +513,41 @@ void LibusbSoundplaneDriver::processThread()
 
 		Transfers transfers;
 		LibusbClaimedDevice handle;
+		char errorBuf[256];
 		auto anomalyFilter = makeAnomalyFilter(
-			[this](int startupCtr, float df, const SoundplaneOutputFrame& previousFrame, const SoundplaneOutputFrame& frame)
+			[&](int startupCtr, float df, const SensorFrame& previousFrame, const SensorFrame& frame)
 			{
-				mListener->handleDeviceError(kDevDataDiffTooLarge, startupCtr, 0, df, 0.);
-				mListener->handleDeviceDataDump(previousFrame.data(), previousFrame.size());
-				mListener->handleDeviceDataDump(frame.data(), frame.size());
+				snprintf(errorBuf, sizeof(errorBuf), "(%f)", df);
+				mListener.onError(kDevDataDiffTooLarge, errorBuf);
 			},
-			[this](const SoundplaneOutputFrame& frame)
+			[this](const SensorFrame& frame)
 			{
-				mListener->receivedFrame(*this, frame.data(), frame.size());
+				if (commitFrame(frame))
+				{
+					mListener.onFrameReady();
+				}
 			});
-		LibusbUnpacker unpacker(anomalyFilter);
+		// the Reclocker calls the filter by reference, so that resetting it below works.
+		auto reclocker = makeReclocker(
+			[&](uint16_t previousSeqNum, uint16_t seqNum, int missingFrames)
+			{
+				snprintf(errorBuf, sizeof(errorBuf), "%d -> %d (%d)", previousSeqNum, seqNum, missingFrames);
+				mListener.onError(kDevGapInSequence, errorBuf);
+			},
+			std::ref(anomalyFilter));
+		LibusbUnpacker unpacker(mTransferConfig.getUnpackerWindow(), std::ref(reclocker));
+		unpacker.setTrace(&getPendingTrace());
+		unpacker.setMetrics(&getMutableMetrics());
+		reclocker.setTransferTime(&mTransferTime);
+		reclocker.setFrameTime(&getPendingFrameTime());
+		reclocker.setMetrics(&getMutableMetrics());
+		anomalyFilter.setMetrics(&getMutableMetrics());
 
 		bool success =
 			processThreadOpenDevice(handle) &&
 			processThreadGetDeviceInfo(handle.get()) &&
 			processThreadSelectIsochronousInterface(handle.get()) &&
+			processThreadAllocateTransfers(transfers) &&
 			processThreadFillTransferInformation(transfers, &unpacker, handle.get()) &&
 			processThreadSetDeviceState(kDeviceConnected) &&
 			processThreadScheduleInitialTransfers(transfers);
@@ -520,5 +574,5 @@ void LibusbSoundplaneDriver::processThread()
 		if (!processThreadSetDeviceState(kNoDevice)) continue;
 	}
 
-	processThreadSetDeviceState(kDeviceIsTerminating);
+	processThreadSetDeviceState(kDeviceClosing);
 }
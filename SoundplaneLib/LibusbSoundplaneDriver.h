@@ -8,9 +8,12 @@
 
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 #include <libusb.h>
 
@@ -18,21 +21,89 @@
 #include "SoundplaneModelA.h"
 #include "Unpacker.h"
 
+// defaults for the settings that affect isochronous transfers
+const int kSoundplaneANumIsochFrames = 8;
+const int kSoundplaneABuffersInFlight = 4;
+
+/**
+ * The depth of the isochronous transfer queue. Fewer packets per transfer
+ * mean each frame is handed on sooner, and more transfers in flight mean a
+ * longer stall of the driver thread can pass without losing packets.
+ */
+struct LibusbTransferConfig
+{
+	static constexpr int kMaxPacketsPerTransfer = 64;
+	static constexpr int kMaxBuffersInFlight = 32;
+	static constexpr int kMaxInFlightMultiplier = 8;
+
+	// isochronous packets, one frame from each endpoint, per transfer.
+	int packetsPerTransfer{kSoundplaneANumIsochFrames};
+
+	// transfers submitted to the USB stack at once on each endpoint.
+	int buffersInFlight{kSoundplaneABuffersInFlight};
+
+	// transfers allocated on each endpoint, as a multiple >= 2 of the
+	// transfers in flight. See LibusbSoundplaneDriver::Transfer.
+	int inFlightMultiplier{2};
+
+	/**
+	 * Returns true if each setting is between 1 and its maximum, and the
+	 * multiplier is at least 2.
+	 */
+	bool isValid() const
+	{
+		return
+			packetsPerTransfer >= 1 && packetsPerTransfer <= kMaxPacketsPerTransfer &&
+			buffersInFlight >= 1 && buffersInFlight <= kMaxBuffersInFlight &&
+			inFlightMultiplier >= 2 && inFlightMultiplier <= kMaxInFlightMultiplier;
+	}
+
+	int getBuffersPerEndpoint() const
+	{
+		return inFlightMultiplier * buffersInFlight;
+	}
+
+	/**
+	 * The transfers on each endpoint that are out of the USB stack's hands.
+	 * The Unpacker's window holds this many transfers' worth of frames, so
+	 * this is how far one endpoint can get ahead of the other.
+	 */
+	int getStoredTransfersPerEndpoint() const
+	{
+		return getBuffersPerEndpoint() - buffersInFlight;
+	}
+
+	/**
+	 * The number of frames the Unpacker holds while it waits for the
+	 * other endpoint.
+	 */
+	int getUnpackerWindow() const
+	{
+		return getStoredTransfersPerEndpoint() * packetsPerTransfer;
+	}
+};
+
 class LibusbSoundplaneDriver : public SoundplaneDriver
 {
 public:
-	LibusbSoundplaneDriver(SoundplaneDriverListener* listener);
+	/**
+	 * An invalid config is replaced by the default one.
+	 */
+	LibusbSoundplaneDriver(SoundplaneDriverListener& listener,
+		const LibusbTransferConfig& config = LibusbTransferConfig());
 	~LibusbSoundplaneDriver();
 
-	void init();
+	const LibusbTransferConfig& getTransferConfig() const { return mTransferConfig; }
 
-	virtual MLSoundplaneState getDeviceState() const override;
+	virtual void start() override;
+	virtual int getDeviceState() const override;
 	virtual uint16_t getFirmwareVersion() const override;
 	virtual std::string getSerialNumberString() const override;
 
 	virtual const unsigned char *getCarriers() const override;
 	virtual void setCarriers(const Carriers& carriers) override;
 	virtual void enableCarriers(unsigned long mask) override;
+	virtual int getSerialNumber() const override;
 
 private:
 	/**
@@ -146,16 +217,14 @@ private:
 
 	/**
 	 * LibusbSoundplaneDriver holds an integer multiple >= 2 of the buffers that
-	 * are in flight. This is because buffers that have been received might not
-	 * be immediately processable, since the separate Soundplane USB endpoints
-	 * can be slightly out of sync. The buffers that are not in flight are kept
-	 * so that when endpoint 1 is lagging behind endpoint 2, the full messages
-	 * can be reconstructed when the packets for endpoint 1 arrive.
+	 * are in flight, LibusbTransferConfig::inFlightMultiplier. This is because
+	 * buffers that have been received might not be immediately processable,
+	 * since the separate Soundplane USB endpoints can be slightly out of sync.
+	 * The buffers that are not in flight are kept so that when endpoint 1 is
+	 * lagging behind endpoint 2, the full messages can be reconstructed when
+	 * the packets for endpoint 1 arrive.
 	 */
-	static constexpr int kInFlightMultiplier = 2;
-	static constexpr int kBuffersPerEndpoint = kInFlightMultiplier * kSoundplaneABuffersInFlight;
-
-	using LibusbUnpacker = Unpacker<kBuffersPerEndpoint - kSoundplaneABuffersInFlight, kSoundplaneANumEndpoints>;
+	using LibusbUnpacker = Unpacker<kSoundplaneANumEndpoints>;
 
 	/**
 	 * An object that represents one USB transaction: It has a buffer and
@@ -164,8 +233,9 @@ private:
 	class Transfer
 	{
 	public:
-		Transfer() :
-			transfer(libusb_alloc_transfer(kSoundplaneANumIsochFrames)) {}
+		explicit Transfer(int numPackets) :
+			transfer(libusb_alloc_transfer(numPackets)),
+			packets(numPackets) {}
 
 		Transfer(const Transfer &) = delete;
 		Transfer& operator=(const Transfer &) = delete;
@@ -175,9 +245,9 @@ private:
 			libusb_free_transfer(transfer);
 		}
 
-		static constexpr int numPackets()
+		int numPackets() const
 		{
-			return kSoundplaneANumIsochFrames;
+			return static_cast<int>(packets.size());
 		}
 
 		/**
@@ -193,28 +263,28 @@ private:
 		LibusbSoundplaneDriver* parent = nullptr;
 		struct libusb_transfer* const transfer;
 		LibusbUnpacker* unpacker = nullptr;
-		SoundplaneADataPacket packets[kSoundplaneANumIsochFrames];
+		std::vector<SoundplaneADataPacket> packets;
 		/**
 		 * Only an integer fraction of the allocated buffers are ever being
-		 * processed by libusb. The other ones are kept in order to be able
-		 * to reconstruct messages even though the different Soundplane
-		 * endpoints can be out of sync.
+		 * processed by libusb. The Unpacker copies the packets it holds, so
+		 * the other ones are only a reserve of buffers out of the USB stack's
+		 * hands, whose number also sets the Unpacker's window.
 		 *
 		 * When a transfer is done, LibusbSoundplaneDriver needs to queue one
-		 * more transfer. Since the transfer that was just done has to be kept
-		 * for a while before being re-submitted, some other transfer has to be
+		 * more transfer. The transfer that was just done rests while the
+		 * others are re-submitted in turn, so some other transfer is
 		 * submitted instead. nextTransfer points to that packet.
 		 *
 		 * In practice, the nextTransfer pointers are set up on initialization
 		 * to point to each other in circular lists that have
-		 * kInFlightMultiplier elements per cycle.
+		 * inFlightMultiplier elements per cycle.
 		 *
-		 * @see kInFlightMultiplier
+		 * @see LibusbTransferConfig::inFlightMultiplier
 		 */
 		Transfer* nextTransfer;
 	};
 
-	using Transfers = std::array<std::array<Transfer, kBuffersPerEndpoint>, kSoundplaneANumEndpoints>;
+	using Transfers = std::array<std::vector<std::unique_ptr<Transfer>>, kSoundplaneANumEndpoints>;
 
 	static void processThreadControlTransferCallback(struct libusb_transfer *xfr);
 	libusb_error processThreadSendControl(
@@ -242,6 +312,13 @@ private:
 	 * Returns false if getting the device info failed.
 	 */
 	bool processThreadGetDeviceInfo(libusb_device_handle *device);
+	/**
+	 * Allocate the transfers for each endpoint, as many as the transfer
+	 * config asks for.
+	 *
+	 * Returns false if libusb could not allocate them.
+	 */
+	bool processThreadAllocateTransfers(Transfers &transfers) const;
 	/**
 	 * Get the endpoint addresses and fill them in into the Transfer objects
 	 * for later use. Also set the parent field of the Transfer objects.
@@ -253,11 +330,12 @@ private:
 		LibusbUnpacker *unpacker,
 		libusb_device_handle *device);
 	/**
-	 * Sets mState to a new value and notifies the listener.
+	 * Sets mState to a new value. When a device is connected, the listener's
+	 * onStartup() is called, and when it goes away, its onClose().
 	 *
 	 * Returns false if the process thread should quit.
 	 */
-	bool processThreadSetDeviceState(MLSoundplaneState newState);
+	bool processThreadSetDeviceState(int newState);
 	/**
 	 * Returns false if selecting the isochronous failed.
 	 */
@@ -284,9 +362,9 @@ private:
 	/**
 	 * mState is set only by the processThread. Because the processThread never
 	 * decides to quit, the outward facing state of the driver is
-	 * kDeviceIsTerminating if mQuitting is true.
+	 * kDeviceClosing if mQuitting is true.
 	 */
-	std::atomic<MLSoundplaneState> mState;
+	std::atomic<int> mState;
 	/**
 	 * mQuitting is set to true by the destructor, and is read by the processing
 	 * thread and getDeviceState in order to know if the driver is quitting.
@@ -319,7 +397,12 @@ private:
 	 * Written on object initialization and then never modified. Can be read
 	 * from any thread.
 	 */
-	SoundplaneDriverListener	* const mListener;
+	SoundplaneDriverListener	&mListener;
+	/**
+	 * Written on object initialization and then never modified. Can be read
+	 * from any thread.
+	 */
+	const LibusbTransferConfig	mTransferConfig;
 
 	std::thread					mProcessThread;
 
@@ -343,6 +426,12 @@ private:
 	 */
 	size_t						mOutstandingTransfers;
 
+	/**
+	 * The completion time of the transfer being processed, for recording
+	 * and for the Reclocker. Accessed only from the processing thread.
+	 */
+	std::chrono::steady_clock::time_point	mTransferTime;
+
 	/**
 	 * Set to a value (allocated with new) by setCarriers. Read (and deleted)
 	 * by the processing thread.
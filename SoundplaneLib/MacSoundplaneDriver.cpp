@@ -1355,7 +1355,9 @@ void MacSoundplaneDriver::process()
       }
     }
     
-    // make frame
+    // make frame. This driver matches sequences itself, on the process thread, so the
+    // trace starts here at kTraceUnpackerMatch with no transfer time.
+    getPendingTrace().mark(kTraceUnpackerMatch);
     std::array<unsigned char *, kSoundplaneANumEndpoints> payloads;
     bool payloadsOK = true;
     for(int i=0 ; i<kSoundplaneANumEndpoints; ++i)
@@ -1375,34 +1377,42 @@ void MacSoundplaneDriver::process()
     
     if (payloadsOK)
     {
+      getMutableMetrics().framesReceived.add();
       if(mStartupCtr >= kIsochStartupFrames)
       {
         // assemble endpoints into frame
         // for two endpoints only
-        K1_unpack_float2(payloads[0], payloads[1], mWorkingFrame);
-        K1_clear_edges(mWorkingFrame);
+        SensorFrame& rawFrame = mRawFrames[mCurrentRawFrame];
+        const SensorFrame& prevFrame = mRawFrames[1 - mCurrentRawFrame];
+        K1_unpack_frame(payloads[0], payloads[1], rawFrame);
         
         bool firstFrame = (mStartupCtr == kIsochStartupFrames);
-        float diff = frameDiff(mWorkingFrame, mPrevFrame);
+        float diff = frameDiff(rawFrame, prevFrame);
         if((diff < kMaxFrameDiff) || firstFrame)
         {
           // new frame is OK, add sequence # and call client callback
-          // TODO mWorkingFrame.seqNum = nextSeq;
+          // TODO seqNum = nextSeq;
           
-          mListener.onFrame(mWorkingFrame);
+          // calibrate or copy the frame into the next slot of the frame ring.
+          if(commitFrame(rawFrame))
+          {
+            mListener.onFrameReady();
+          }
         }
         else
         {
           // diff too large, alert client
+          getMutableMetrics().framesDropped.add();
           snprintf(mErrorBuf, kMaxErrorStringSize, "(%f)", diff);
           mListener.onError(kDevDataDiffTooLarge, mErrorBuf);
         }
-        mPrevFrame = mWorkingFrame;
+        mCurrentRawFrame = 1 - mCurrentRawFrame;
       }
       else
       {
         // wait for startup
         mStartupCtr++;
+        getMutableMetrics().framesDropped.add();
       }
     }
     
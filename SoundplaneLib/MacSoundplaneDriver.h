@@ -197,8 +197,10 @@ private:
 
 	SoundplaneDriverListener& mListener;
 	
-    SensorFrame                 mWorkingFrame{};
-    SensorFrame                 mPrevFrame{};
+	// raw frames for the frameDiff check. The current and previous frames swap places
+	// each frame instead of being copied.
+    SensorFrame                 mRawFrames[2]{};
+    int                         mCurrentRawFrame{0};
 	
 	// stats
     int mFrameCounter{0};
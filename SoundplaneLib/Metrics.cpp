@@ -0,0 +1,106 @@
+// Metrics.cpp
+//
+// Histogram buckets and the metrics registry.
+
+#include "Metrics.h"
+
+#include <algorithm>
+
+constexpr int MetricHistogram::kSubBuckets;
+constexpr int MetricHistogram::kBuckets;
+
+int MetricHistogram::getBucket(uint64_t v)
+{
+	if(v < kSubBuckets) return static_cast<int>(v);
+
+	// the octave of v and the quarter of it v is in.
+	int octave = 63;
+	while(!(v & (uint64_t(1) << octave))) octave--;
+	const int sub = static_cast<int>(v >> (octave - 2)) & (kSubBuckets - 1);
+	const int b = kSubBuckets*(octave - 1) + sub;
+	return std::min(b, kBuckets - 1);
+}
+
+uint64_t MetricHistogram::getBucketLimit(int b)
+{
+	if(b < kSubBuckets) return b + 1;
+	const int octave = b/kSubBuckets + 1;
+	const int sub = b % kSubBuckets;
+	return uint64_t(kSubBuckets + sub + 1) << (octave - 2);
+}
+
+uint64_t MetricHistogram::getPercentile(double p) const
+{
+	const uint64_t count = getCount();
+	if(!count) return 0;
+	const double target = p*count;
+	uint64_t sum = 0;
+	for(int i=0; i<kBuckets - 1; ++i)
+	{
+		sum += mCounts[i].load(std::memory_order_relaxed);
+		if(sum >= target)
+		{
+			return std::min(getBucketLimit(i), getMax());
+		}
+	}
+	return getMax();
+}
+
+void MetricsRegistry::addCounter(const std::string& name, const MetricCounter& c)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mEntries.push_back(Entry{name, kCounter, &c});
+}
+
+void MetricsRegistry::addGauge(const std::string& name, const MetricGauge& g)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mEntries.push_back(Entry{name, kGauge, &g});
+}
+
+void MetricsRegistry::addHistogram(const std::string& name, const MetricHistogram& h)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mEntries.push_back(Entry{name, kHistogram, &h});
+}
+
+void MetricsRegistry::clear()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mEntries.clear();
+}
+
+void MetricsRegistry::forEachValue(const std::function<void(const std::string&, int64_t)>& fn) const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	for(const Entry& e : mEntries)
+	{
+		switch(e.type)
+		{
+			case kCounter:
+				fn(e.name, static_cast<const MetricCounter*>(e.metric)->get());
+				break;
+			case kGauge:
+				fn(e.name, static_cast<const MetricGauge*>(e.metric)->get());
+				break;
+			case kHistogram:
+			{
+				const MetricHistogram* h = static_cast<const MetricHistogram*>(e.metric);
+				fn(e.name + ".count", h->getCount());
+				fn(e.name + ".p50", h->getPercentile(0.5));
+				fn(e.name + ".p99", h->getPercentile(0.99));
+				fn(e.name + ".p999", h->getPercentile(0.999));
+				fn(e.name + ".max", h->getMax());
+				break;
+			}
+		}
+	}
+}
+
+void MetricsRegistry::writeText(std::ostream& s) const
+{
+	forEachValue([&](const std::string& name, int64_t value)
+	{
+		s << name << " " << value << "\n";
+	});
+}
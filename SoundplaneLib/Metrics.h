@@ -0,0 +1,143 @@
+// Driver for Soundplane Model A.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#ifndef __METRICS__
+#define __METRICS__
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Runtime metrics for monitoring. Counters, gauges and histograms are updated with relaxed
+// atomic operations, so the driver and processing threads can update them without locking
+// while another thread reads them.
+
+// a count that only goes up.
+class MetricCounter
+{
+public:
+	void add(uint64_t n = 1) { mValue.fetch_add(n, std::memory_order_relaxed); }
+	uint64_t get() const { return mValue.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<uint64_t> mValue{0};
+};
+
+// a value that is set.
+class MetricGauge
+{
+public:
+	void set(int64_t v) { mValue.store(v, std::memory_order_relaxed); }
+	int64_t get() const { return mValue.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<int64_t> mValue{0};
+};
+
+/**
+ * Counts of values in buckets a quarter of a power of two wide, so percentiles
+ * are accurate to within 25%. Values from 2^33 up are counted in the last
+ * bucket. Updated by one thread at a time.
+ */
+class MetricHistogram
+{
+public:
+	static constexpr int kSubBuckets = 4;
+	static constexpr int kBuckets = kSubBuckets*32;
+
+	void add(uint64_t v)
+	{
+		mCounts[getBucket(v)].fetch_add(1, std::memory_order_relaxed);
+		mCount.fetch_add(1, std::memory_order_relaxed);
+		if(v > mMax.load(std::memory_order_relaxed))
+		{
+			mMax.store(v, std::memory_order_relaxed);
+		}
+	}
+
+	uint64_t getCount() const { return mCount.load(std::memory_order_relaxed); }
+	uint64_t getMax() const { return mMax.load(std::memory_order_relaxed); }
+
+	// an upper bound for the given fraction of values, for example 0.99 for the 99th percentile.
+	uint64_t getPercentile(double p) const;
+
+	static int getBucket(uint64_t v);
+
+	// the smallest value above bucket b.
+	static uint64_t getBucketLimit(int b);
+
+private:
+	std::array<std::atomic<uint64_t>, kBuckets> mCounts{};
+	std::atomic<uint64_t> mCount{0};
+	std::atomic<uint64_t> mMax{0};
+};
+
+// the metrics of a driver, updated by its driver thread.
+struct DriverMetrics
+{
+	// frames the Unpacker matched from the packets of both endpoints.
+	MetricCounter framesReceived;
+
+	// frames the AnomalyFilter did not pass on, while starting up or after a glitch.
+	MetricCounter framesDropped;
+
+	// packets the Unpacker discarded because the other endpoint's packet with the same
+	// sequence number was lost, or did not arrive within its window, or because they
+	// arrived after their frame had been passed on.
+	MetricCounter sequenceMismatches;
+
+	// the number of frames missing in each gap in the sequence the Reclocker was given.
+	MetricHistogram sequenceGaps;
+
+	// frames the Reclocker made up to fill short gaps.
+	MetricCounter framesInterpolated;
+};
+
+/**
+ * Named metrics, for publishing. Metrics are owned by the objects that update
+ * them and must outlive the registry, or be removed with clear(). Adding and
+ * reading take a lock, updating the metrics themselves does not.
+ */
+class MetricsRegistry
+{
+public:
+	void addCounter(const std::string& name, const MetricCounter& c);
+	void addGauge(const std::string& name, const MetricGauge& g);
+
+	// published as name.count, name.p50, name.p99, name.p999 and name.max.
+	void addHistogram(const std::string& name, const MetricHistogram& h);
+
+	void clear();
+
+	// call fn(name, value) for each value, in the order the metrics were added.
+	void forEachValue(const std::function<void(const std::string&, int64_t)>& fn) const;
+
+	// one "name value" line for each value.
+	void writeText(std::ostream& s) const;
+
+private:
+	enum MetricType
+	{
+		kCounter,
+		kGauge,
+		kHistogram
+	};
+
+	struct Entry
+	{
+		std::string name;
+		MetricType type;
+		const void* metric;
+	};
+
+	mutable std::mutex mMutex;
+	std::vector<Entry> mEntries;
+};
+
+#endif // __METRICS__
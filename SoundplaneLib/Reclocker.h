@@ -0,0 +1,239 @@
+// Driver for Soundplane Model A.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#ifndef __RECLOCKER__
+#define __RECLOCKER__
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+#include "Metrics.h"
+#include "SoundplaneModelA.h"
+
+// the longest run of missing frames the Reclocker fills in. Longer gaps are
+// passed over, and the frames after them start a new run.
+const int kMaxInterpolatedFrames = 8;
+
+// the Reclocker places its clock by the earliest transfer completion in each block
+// of this many frames, about a second.
+const int kReclockerBlockFrames = 1024;
+
+// the most the Reclocker moves its clock per frame to follow drift between the
+// device's frame clock and the computer's, so that frame times stay evenly spaced.
+const int kReclockerMaxSlewNanos = 1000;
+
+// the device's frame period, 1/kSoundplaneFrameRate, which is exactly 1.024 ms.
+const int64_t kReclockerFramePeriodNanos = 1024000;
+
+/**
+ * Sits between an Unpacker and the AnomalyFilter and keeps the frame rate
+ * steady for everything downstream, whose filters assume a fixed sample rate.
+ *
+ * Each frame gets a time on the device's frame clock: the frame's sequence
+ * number counts periods of 1/kSoundplaneFrameRate, and the clock is placed
+ * by the completion times of the transfers the frames arrive in, which are
+ * never earlier than the frames themselves. The clock follows the earliest
+ * completion in each block of kReclockerBlockFrames, so it is not moved by
+ * the USB stack's or the driver thread's delays, and it slews slowly towards
+ * it, so that drift between the two clocks does not make frame times jump.
+ *
+ * A gap of up to kMaxInterpolatedFrames missing sequence numbers is filled
+ * with frames interpolated between the frames on each side of it, each with
+ * its own time. Every gap is counted in the metrics and reported to the gap
+ * callback. The callbacks have the signatures
+ *
+ *   void gapCallback(uint16_t previousSeqNum, uint16_t seqNum, int missingFrames);
+ *   void frameCallback(const SensorFrame& frame);
+ *
+ * Before each call of the frame callback, the frame's time is written to the
+ * time given to setFrameTime(), usually the driver's pending frame time, see
+ * SoundplaneDriver::getPendingFrameTime().
+ *
+ * The Reclocker keeps a pointer to the previous frame for interpolation
+ * instead of a copy, so each frame given to it must stay valid and unchanged
+ * until the call with the next frame returns, as the Unpacker's frames do.
+ */
+template<typename GapCallback, typename FrameCallback>
+class Reclocker
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	Reclocker(GapCallback gapCallback, FrameCallback frameCallback) :
+		mGapCallback(std::move(gapCallback)),
+		mFrameCallback(std::move(frameCallback)) {}
+
+	/**
+	 * The completion time of the transfer being unpacked, which the driver
+	 * updates before it gives each transfer to the Unpacker. Without it,
+	 * frames are placed by the time they reach the Reclocker.
+	 */
+	void setTransferTime(const Clock::time_point* time)
+	{
+		mTransferTime = time;
+	}
+
+	void setFrameTime(Clock::time_point* time)
+	{
+		mFrameTime = time;
+	}
+
+	/**
+	 * Count gaps and interpolated frames in metrics.
+	 */
+	void setMetrics(DriverMetrics* metrics)
+	{
+		mMetrics = metrics;
+	}
+
+	// the Unpacker's callback.
+	void operator()(const SensorFrame& frame, uint16_t seqNum)
+	{
+		const Clock::time_point arrival = mTransferTime ? *mTransferTime : Clock::now();
+		if (!mStarted)
+		{
+			start(frame, seqNum, arrival);
+			return;
+		}
+
+		const uint16_t step = seqNum - mPreviousSeqNum;
+		if (!step || (step >= 0x8000))
+		{
+			// The sequence went back, so the device started counting again.
+			start(frame, seqNum, arrival);
+			return;
+		}
+
+		const int missing = step - 1;
+		if (missing)
+		{
+			gotGap(frame, seqNum, missing);
+		}
+		mFrameIndex += step;
+		updateClock(arrival);
+		passOn(frame, mFrameIndex);
+		mPreviousFrame = &frame;
+		mPreviousSeqNum = seqNum;
+	}
+
+private:
+	void start(const SensorFrame& frame, uint16_t seqNum, Clock::time_point arrival)
+	{
+		mStarted = true;
+		mFrameIndex = 0;
+		mOffset = arrival.time_since_epoch();
+		mBlockOffset = Clock::duration::max();
+		mBlockFrames = 0;
+		mHasTarget = false;
+		passOn(frame, 0);
+		mPreviousFrame = &frame;
+		mPreviousSeqNum = seqNum;
+	}
+
+	void gotGap(const SensorFrame& frame, uint16_t seqNum, int missing)
+	{
+		if (mMetrics)
+		{
+			mMetrics->sequenceGaps.add(missing);
+		}
+		mGapCallback(mPreviousSeqNum, seqNum, missing);
+		if (missing > kMaxInterpolatedFrames) return;
+
+		// fill the gap on a straight line from the previous frame to this one.
+		subtract(mStep, frame, *mPreviousFrame);
+		multiply(mStep, mStep, 1.f/(missing + 1));
+		mInterpolated = *mPreviousFrame;
+		for (int i = 1; i <= missing; i++)
+		{
+			add(mInterpolated, mInterpolated, mStep);
+			passOn(mInterpolated, mFrameIndex + i);
+		}
+		if (mMetrics)
+		{
+			mMetrics->framesInterpolated.add(missing);
+		}
+	}
+
+	/**
+	 * Place the clock by the arrival of the current frame. Until the first
+	 * block is done, the clock's offset follows the earliest placement so
+	 * far. After that, it slews towards the earliest of the last block.
+	 */
+	void updateClock(Clock::time_point arrival)
+	{
+		const Clock::duration observed = arrival.time_since_epoch() - getFrameOffset(mFrameIndex);
+		mBlockOffset = std::min(mBlockOffset, observed);
+		if (++mBlockFrames >= kReclockerBlockFrames)
+		{
+			mTargetOffset = mBlockOffset;
+			mHasTarget = true;
+			mBlockOffset = Clock::duration::max();
+			mBlockFrames = 0;
+		}
+
+		if (!mHasTarget)
+		{
+			mOffset = std::min(mOffset, observed);
+			return;
+		}
+		const Clock::duration maxSlew = std::chrono::nanoseconds(kReclockerMaxSlewNanos);
+		mOffset += std::min(std::max(mTargetOffset - mOffset, -maxSlew), maxSlew);
+	}
+
+	// the time from the clock's offset to the frame at the given index. This is
+	// computed in integer nanoseconds, so it stays exact however long we run.
+	static Clock::duration getFrameOffset(int64_t frameIndex)
+	{
+		using namespace std::chrono;
+		return duration_cast<Clock::duration>(nanoseconds(frameIndex*kReclockerFramePeriodNanos));
+	}
+
+	void passOn(const SensorFrame& frame, int64_t frameIndex)
+	{
+		Clock::time_point time(mOffset + getFrameOffset(frameIndex));
+
+		// frame times never go back, even when the offset does.
+		if (time <= mPreviousTime)
+		{
+			time = mPreviousTime + Clock::duration(1);
+		}
+		mPreviousTime = time;
+		if (mFrameTime)
+		{
+			*mFrameTime = time;
+		}
+		mFrameCallback(frame);
+	}
+
+	GapCallback mGapCallback;
+	FrameCallback mFrameCallback;
+	const Clock::time_point* mTransferTime = nullptr;
+	Clock::time_point* mFrameTime = nullptr;
+	DriverMetrics* mMetrics = nullptr;
+
+	bool mStarted = false;
+	uint16_t mPreviousSeqNum = 0;
+	int64_t mFrameIndex = 0;
+	Clock::duration mOffset{};
+	Clock::duration mBlockOffset{};
+	Clock::duration mTargetOffset{};
+	int mBlockFrames = 0;
+	bool mHasTarget = false;
+	Clock::time_point mPreviousTime{};
+	const SensorFrame* mPreviousFrame = nullptr;
+	SensorFrame mStep{};
+	SensorFrame mInterpolated{};
+};
+
+template<typename GapCallback, typename FrameCallback>
+Reclocker<GapCallback, FrameCallback> makeReclocker(
+	GapCallback gapCallback, FrameCallback frameCallback)
+{
+	return Reclocker<GapCallback, FrameCallback>(
+		std::move(gapCallback), std::move(frameCallback));
+}
+
+#endif // __RECLOCKER__
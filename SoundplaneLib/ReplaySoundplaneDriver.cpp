@@ -0,0 +1,237 @@
+// ReplaySoundplaneDriver.cpp
+//
+// Replays capture files through an Unpacker, a Reclocker and an AnomalyFilter, in real time, faster
+// than real time, or one transfer at a time as fast as the client can process them.
+
+#include "ReplaySoundplaneDriver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdio.h>
+
+using namespace std::chrono;
+
+namespace
+{
+
+// the longest the replay thread sleeps before checking whether it should quit.
+constexpr auto kMaxSleep = milliseconds(100);
+
+}
+
+ReplaySoundplaneDriver::ReplaySoundplaneDriver(SoundplaneDriverListener& listener, const std::string& path, const ReplayConfig& config) :
+	mListener(listener),
+	mConfig(config),
+	mAnomalyFilter(
+		[this](int startupCtr, float df, const SensorFrame& previousFrame, const SensorFrame& frame)
+		{
+			snprintf(mErrorBuf, sizeof(mErrorBuf), "(%f)", df);
+			mListener.onError(kDevDataDiffTooLarge, mErrorBuf);
+		},
+		[this](const SensorFrame& frame)
+		{
+			if(commitFrame(frame))
+			{
+				mListener.onFrameReady();
+			}
+		}),
+	mReclocker(
+		[this](uint16_t previousSeqNum, uint16_t seqNum, int missingFrames)
+		{
+			snprintf(mErrorBuf, sizeof(mErrorBuf), "%d -> %d (%d)", previousSeqNum, seqNum, missingFrames);
+			mListener.onError(kDevGapInSequence, mErrorBuf);
+		},
+		std::ref(mAnomalyFilter)),
+	mUnpacker(kUnpackerWindow, std::ref(mReclocker))
+{
+	// frames are placed on the clock by when they were recorded.
+	mReclocker.setTransferTime(&mTransferTime);
+	mReclocker.setFrameTime(&getPendingFrameTime());
+	mReclocker.setMetrics(&getMutableMetrics());
+	mUnpacker.setTrace(&getPendingTrace());
+	mUnpacker.setMetrics(&getMutableMetrics());
+	mAnomalyFilter.setMetrics(&getMutableMetrics());
+	std::copy(kDefaultCarriers, kDefaultCarriers + kSoundplaneNumCarriers, mCurrentCarriers.begin());
+	if(mFile.open(path))
+	{
+		const unsigned char* carriers = mFile.getHeader().carriers;
+		std::copy(carriers, carriers + kSoundplaneNumCarriers, mCurrentCarriers.begin());
+	}
+
+	for(auto& b : mBuffers)
+	{
+		b.resize(kMaxPacketsPerTransfer);
+	}
+}
+
+ReplaySoundplaneDriver::~ReplaySoundplaneDriver()
+{
+	mQuitting.store(true, std::memory_order_release);
+	if(mProcessThread.joinable())
+	{
+		mProcessThread.join();
+	}
+}
+
+void ReplaySoundplaneDriver::start()
+{
+	if(!mFile.isOpen()) return;
+
+	mReplayStart = steady_clock::now();
+	mState.store(kDeviceConnected, std::memory_order_release);
+	mListener.onStartup();
+
+	if(mConfig.mode != ReplayMode::kAsFastAsPossible)
+	{
+		mProcessThread = std::thread(&ReplaySoundplaneDriver::processThread, this);
+	}
+}
+
+int ReplaySoundplaneDriver::getDeviceState() const
+{
+	return mState.load(std::memory_order_acquire);
+}
+
+uint16_t ReplaySoundplaneDriver::getFirmwareVersion() const
+{
+	return mFile.isOpen() ? mFile.getHeader().firmwareVersion : 0;
+}
+
+std::string ReplaySoundplaneDriver::getSerialNumberString() const
+{
+	if(!mFile.isOpen()) return std::string();
+	const char* serialNumber = mFile.getHeader().serialNumber;
+	return std::string(serialNumber, strnlen(serialNumber, sizeof(CaptureFileHeader::serialNumber)));
+}
+
+const unsigned char *ReplaySoundplaneDriver::getCarriers() const
+{
+	return mCurrentCarriers.data();
+}
+
+void ReplaySoundplaneDriver::setCarriers(const Carriers& carriers)
+{
+	mCurrentCarriers = carriers;
+}
+
+void ReplaySoundplaneDriver::enableCarriers(unsigned long mask)
+{
+}
+
+int ReplaySoundplaneDriver::getSerialNumber() const
+{
+	try
+	{
+		return std::stoi(getSerialNumberString());
+	}
+	catch (...)
+	{
+		return 0;
+	}
+}
+
+bool ReplaySoundplaneDriver::step()
+{
+	const size_t numRecords = mFile.getNumRecords();
+	if((mNextRecord >= numRecords) && mConfig.loop && numRecords)
+	{
+		// move the start past the end of the capture, so times keep going forward.
+		mNextRecord = 0;
+		mReplayStart += nanoseconds(mFile.getRecord(numRecords - 1).time + kReclockerFramePeriodNanos);
+	}
+
+	// handle any carrier changes before the next transfer. Packets from other endpoints
+	// than ours would be from some other device, so skip them.
+	while(mNextRecord < numRecords)
+	{
+		const CaptureRecord& record = mFile.getRecord(mNextRecord);
+		if((record.type == kCapturePacket) && (record.endpoint < kSoundplaneANumEndpoints)) break;
+		if((record.type == kCaptureCarriers) || (record.type == kCaptureCarrierMask))
+		{
+			// wait for data to settle after setting carriers
+			mAnomalyFilter.reset();
+		}
+		mNextRecord++;
+	}
+
+	if(mNextRecord >= numRecords)
+	{
+		finish();
+		return false;
+	}
+
+	// a transfer is a run of packets from one endpoint that arrived at the same time.
+	const CaptureRecord& first = mFile.getRecord(mNextRecord);
+	const int endpoint = first.endpoint;
+	SoundplaneADataPacket* packets = mBuffers[endpoint].data();
+	int numPackets = 0;
+	while((mNextRecord < numRecords) && (numPackets < kMaxPacketsPerTransfer))
+	{
+		const CaptureRecord& record = mFile.getRecord(mNextRecord);
+		if((record.type != kCapturePacket) || (record.endpoint != endpoint) || (record.time != first.time)) break;
+
+		SoundplaneADataPacket& packet = packets[numPackets++];
+		std::copy(record.data, record.data + kSoundplaneAPackedDataSize, packet.packedData);
+		packet.seqNum = record.seqNum;
+		packet.padding = 0;
+		mNextRecord++;
+	}
+
+	if(mState.load(std::memory_order_acquire) == kDeviceConnected)
+	{
+		mState.store(kDeviceHasIsochSync, std::memory_order_release);
+	}
+
+	mTransferTime = mReplayStart + duration_cast<steady_clock::duration>(nanoseconds(first.time));
+	getPendingTrace().mark(kTraceTransfer);
+	mUnpacker.gotTransfer(endpoint, packets, numPackets);
+	mTransfersReplayed.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+void ReplaySoundplaneDriver::finish()
+{
+	if(mState.exchange(kNoDevice, std::memory_order_acq_rel) == kNoDevice) return;
+	if(!mQuitting.load(std::memory_order_acquire))
+	{
+		mListener.onClose();
+	}
+}
+
+void ReplaySoundplaneDriver::processThread()
+{
+	const double speed = (mConfig.mode == ReplayMode::kAccelerated) ? std::max(mConfig.speed, 0.001f) : 1.0;
+	const size_t numRecords = mFile.getNumRecords();
+
+	// replay each transfer at its recorded time relative to the first one.
+	auto startTime = steady_clock::now();
+	int64_t firstRecordTime = numRecords ? mFile.getRecord(0).time : 0;
+	int64_t previousRecordTime = firstRecordTime;
+
+	while(!mQuitting.load(std::memory_order_acquire))
+	{
+		const size_t next = ((mNextRecord >= numRecords) && mConfig.loop) ? 0 : mNextRecord;
+		if(next < numRecords)
+		{
+			const int64_t recordTime = mFile.getRecord(next).time;
+			if(recordTime < previousRecordTime)
+			{
+				// looped back to the start.
+				startTime = steady_clock::now();
+				firstRecordTime = recordTime;
+			}
+			previousRecordTime = recordTime;
+
+			const auto due = startTime + duration_cast<steady_clock::duration>(
+				duration<double, std::nano>((recordTime - firstRecordTime)/speed));
+			for(auto now = steady_clock::now(); (now < due) && !mQuitting.load(std::memory_order_acquire);
+				now = steady_clock::now())
+			{
+				std::this_thread::sleep_until(std::min(due, now + kMaxSleep));
+			}
+		}
+
+		if(!step()) break;
+	}
+}
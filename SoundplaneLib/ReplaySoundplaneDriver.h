@@ -0,0 +1,137 @@
+// Driver for Soundplane Model A.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#ifndef __REPLAY_SOUNDPLANE_DRIVER__
+#define __REPLAY_SOUNDPLANE_DRIVER__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AnomalyFilter.h"
+#include "CaptureFile.h"
+#include "Reclocker.h"
+#include "SoundplaneDriver.h"
+#include "SoundplaneModelA.h"
+#include "Unpacker.h"
+
+enum class ReplayMode
+{
+	// transfers are replayed at the times they were recorded.
+	kRealTime,
+
+	// the same, but ReplayConfig::speed times faster.
+	kAccelerated,
+
+	// no driver thread. The client calls step() to replay each transfer.
+	kAsFastAsPossible
+};
+
+struct ReplayConfig
+{
+	ReplayMode mode = ReplayMode::kRealTime;
+
+	// for kAccelerated, how many times faster than real time to replay.
+	float speed = 4.f;
+
+	// start again from the beginning at the end of the capture.
+	bool loop = false;
+};
+
+/**
+ * A SoundplaneDriver that replays a capture file written by CaptureRecorder.
+ * The recorded transfers go through an Unpacker, a Reclocker and an
+ * AnomalyFilter as they did when they were captured, so a capture gives the same frames, at
+ * the same times after start(), each time it is replayed. Recorded carrier changes reset the AnomalyFilter as
+ * they did in the driver that recorded them. Carriers set by the client
+ * don't affect the data.
+ *
+ * start() simulates plugging in the device that made the capture. At the
+ * end of the capture the device is unplugged and the listener's onClose() is
+ * called.
+ */
+class ReplaySoundplaneDriver : public SoundplaneDriver
+{
+public:
+	ReplaySoundplaneDriver(SoundplaneDriverListener& listener, const std::string& path, const ReplayConfig& config);
+	~ReplaySoundplaneDriver();
+
+	/**
+	 * Returns false if the capture file could not be read, in which case the
+	 * driver behaves as if no device was ever connected.
+	 */
+	bool isOpen() const { return mFile.isOpen(); }
+
+	// SoundplaneDriver
+	void start() override;
+	int getDeviceState() const override;
+	uint16_t getFirmwareVersion() const override;
+	std::string getSerialNumberString() const override;
+	const unsigned char *getCarriers() const override;
+	void setCarriers(const Carriers& carriers) override;
+	void enableCarriers(unsigned long mask) override;
+	int getSerialNumber() const override;
+
+	/**
+	 * Replay the next transfer on the calling thread, committing any frames
+	 * it completes to the frame ring. With kAsFastAsPossible the client
+	 * calls this after start() and processes the frames in the ring after
+	 * each call, so the whole pipeline runs on one thread without waiting.
+	 * Longer transfers are replayed a few packets at a time, so that their
+	 * frames and the frames the Reclocker fills in for one gap fit in the
+	 * ring. Returns false at the end of the capture.
+	 */
+	bool step();
+
+	/**
+	 * The number of transfers replayed so far.
+	 */
+	uint64_t getTransfersReplayed() const { return mTransfersReplayed.load(std::memory_order_relaxed); }
+
+private:
+	// frames the Unpacker holds while it waits for the other endpoint.
+	static constexpr int kUnpackerWindow = 64;
+	static constexpr int kMaxPacketsPerTransfer = kSensorFrameRingSize - kMaxInterpolatedFrames;
+
+	using GlitchCallback = std::function<void(int, float, const SensorFrame&, const SensorFrame&)>;
+	using SuccessCallback = std::function<void(const SensorFrame&)>;
+	using GapCallback = std::function<void(uint16_t, uint16_t, int)>;
+	using ReplayAnomalyFilter = AnomalyFilter<GlitchCallback, SuccessCallback>;
+	using ReplayReclocker = Reclocker<GapCallback, SuccessCallback>;
+	using ReplayUnpacker = Unpacker<kSoundplaneANumEndpoints>;
+
+	void processThread();
+	void finish();
+
+	SoundplaneDriverListener& mListener;
+	const ReplayConfig mConfig;
+	CaptureFile mFile;
+	Carriers mCurrentCarriers;
+
+	std::atomic<int> mState{kNoDevice};
+	std::atomic<bool> mQuitting{false};
+	std::atomic<uint64_t> mTransfersReplayed{0};
+
+	// replay state, used only by the thread that calls step().
+	size_t mNextRecord{0};
+	std::vector<SoundplaneADataPacket> mBuffers[kSoundplaneANumEndpoints];
+
+	// the replay's start, and the recorded arrival time of the transfer being replayed
+	// measured from it, so the Reclocker places frames the same way however fast the
+	// capture is replayed.
+	std::chrono::steady_clock::time_point mReplayStart{};
+	std::chrono::steady_clock::time_point mTransferTime{};
+	char mErrorBuf[256];
+	ReplayAnomalyFilter mAnomalyFilter;
+	ReplayReclocker mReclocker;
+	ReplayUnpacker mUnpacker;
+
+	std::thread mProcessThread;
+};
+
+#endif // __REPLAY_SOUNDPLANE_DRIVER__
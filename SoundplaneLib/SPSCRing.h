@@ -0,0 +1,194 @@
+// Driver for Soundplane Model A.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#ifndef __SPSC_RING__
+#define __SPSC_RING__
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+/**
+ * A lock-free ring of preallocated elements for one producer thread and one
+ * consumer thread. Elements are never copied in or out. The producer
+ * reserves the next free slot, writes to it in place and commits it. The
+ * consumer acquires the oldest committed slot, reads it in place and
+ * releases it.
+ *
+ * When the ring is full, reserve() either returns nullptr, dropping the new
+ * element (kDropNewest), or discards the oldest committed element to make
+ * room (kDropOldest). A slot the consumer has acquired is never discarded.
+ * If that slot is the oldest, the new element is dropped instead. Either way
+ * the overflow count goes up by one.
+ *
+ * The capacity is rounded up to a power of two. Slots are aligned for T,
+ * so over-aligned types can be used.
+ */
+template<typename T>
+class SPSCRing
+{
+public:
+	enum class OverflowMode
+	{
+		kDropNewest,
+		kDropOldest
+	};
+
+	explicit SPSCRing(size_t capacity, OverflowMode mode = OverflowMode::kDropNewest) :
+		mCapacity(roundUpToPowerOfTwo(capacity)),
+		mMask(mCapacity - 1),
+		mMode(mode)
+	{
+		mStorage.reset(new unsigned char[mCapacity*sizeof(T) + alignof(T)]);
+		uintptr_t p = reinterpret_cast<uintptr_t>(mStorage.get());
+		p = (p + alignof(T) - 1) & ~(uintptr_t(alignof(T)) - 1);
+		mSlots = reinterpret_cast<T*>(p);
+		for(size_t i=0; i<mCapacity; ++i)
+		{
+			new(mSlots + i) T();
+		}
+	}
+
+	~SPSCRing()
+	{
+		for(size_t i=0; i<mCapacity; ++i)
+		{
+			mSlots[i].~T();
+		}
+	}
+
+	SPSCRing(const SPSCRing &) = delete;
+	SPSCRing &operator=(const SPSCRing &) = delete;
+
+	// producer
+
+	/**
+	 * Returns the slot to write the next element to, or nullptr if the ring
+	 * is full and the element must be dropped. Calling reserve() again
+	 * without committing returns the same slot.
+	 */
+	T* reserve()
+	{
+		const size_t w = mWrite.load(std::memory_order_relaxed);
+		uint64_t r = mRead.load(std::memory_order_acquire);
+		if(w - readIndex(r) < mCapacity)
+		{
+			return mSlots + (w & mMask);
+		}
+
+		// full.
+		if(mMode == OverflowMode::kDropOldest && !isHeld(r))
+		{
+			// discard the oldest element. This fails only if the consumer has just
+			// acquired it.
+			if(mRead.compare_exchange_strong(r, r + kReadIncrement, std::memory_order_acq_rel))
+			{
+				mOverflows.fetch_add(1, std::memory_order_relaxed);
+				return mSlots + (w & mMask);
+			}
+		}
+		mOverflows.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	/**
+	 * Make the slot returned by the last reserve() available to the consumer.
+	 */
+	void commit()
+	{
+		const size_t w = mWrite.load(std::memory_order_relaxed) + 1;
+		mWrite.store(w, std::memory_order_release);
+
+		const size_t fill = w - readIndex(mRead.load(std::memory_order_relaxed));
+		if(fill > mMaxFill.load(std::memory_order_relaxed))
+		{
+			mMaxFill.store(fill, std::memory_order_relaxed);
+		}
+	}
+
+	// consumer
+
+	/**
+	 * Returns the oldest committed element, or nullptr if there are none. The
+	 * element stays valid until release() is called.
+	 */
+	const T* acquire()
+	{
+		uint64_t r = mRead.load(std::memory_order_acquire);
+		while(readIndex(r) != mWrite.load(std::memory_order_acquire))
+		{
+			// mark the slot as held so that the producer won't discard it. If the producer
+			// has just discarded it, try again with the next one.
+			if(mRead.compare_exchange_weak(r, r | kHeld, std::memory_order_acq_rel))
+			{
+				return mSlots + (readIndex(r) & mMask);
+			}
+		}
+		return nullptr;
+	}
+
+	/**
+	 * Give the element returned by acquire() back to the producer.
+	 */
+	void release()
+	{
+		// the producer never changes mRead while a slot is held.
+		const uint64_t r = mRead.load(std::memory_order_relaxed);
+		mRead.store((r & ~kHeld) + kReadIncrement, std::memory_order_release);
+	}
+
+	// either thread
+
+	void setOverflowMode(OverflowMode mode) { mMode = mode; }
+	OverflowMode getOverflowMode() const { return mMode; }
+
+	size_t getCapacity() const { return mCapacity; }
+
+	// the number of committed elements not yet released.
+	size_t getFillLevel() const
+	{
+		return mWrite.load(std::memory_order_acquire) - readIndex(mRead.load(std::memory_order_acquire));
+	}
+
+	// the highest fill level since the last resetMaxFillLevel(). Approximate, since the
+	// two threads update it without synchronizing.
+	size_t getMaxFillLevel() const { return mMaxFill.load(std::memory_order_relaxed); }
+	void resetMaxFillLevel() { mMaxFill.store(0, std::memory_order_relaxed); }
+
+	// the number of elements dropped because the ring was full.
+	uint64_t getOverflowCount() const { return mOverflows.load(std::memory_order_relaxed); }
+
+private:
+	// mRead holds the read index shifted left by one, and a flag in the low bit that is set
+	// while the consumer holds the slot at the read index.
+	static constexpr uint64_t kHeld = 1;
+	static constexpr uint64_t kReadIncrement = 2;
+
+	static size_t readIndex(uint64_t r) { return static_cast<size_t>(r >> 1); }
+	static bool isHeld(uint64_t r) { return r & kHeld; }
+
+	static size_t roundUpToPowerOfTwo(size_t n)
+	{
+		size_t p = 1;
+		while(p < n) p <<= 1;
+		return p;
+	}
+
+	const size_t mCapacity;
+	const size_t mMask;
+	std::atomic<OverflowMode> mMode;
+
+	std::unique_ptr<unsigned char[]> mStorage;
+	T* mSlots;
+
+	std::atomic<size_t> mWrite{0};
+	std::atomic<uint64_t> mRead{0};
+	std::atomic<size_t> mMaxFill{0};
+	std::atomic<uint64_t> mOverflows{0};
+};
+
+#endif // __SPSC_RING__
@@ -0,0 +1,341 @@
+// SimulatedSoundplaneDriver.cpp
+//
+// Generates the isochronous packet streams of a Soundplane Model A from synthetic
+// touches, and processes them like a USB driver would: an Unpacker matches the
+// packets of the two endpoints, a Reclocker times the frames and fills short gaps,
+// an AnomalyFilter checks the frames, and good frames go to the driver's frame ring.
+
+#include "SimulatedSoundplaneDriver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <functional>
+#include <stdio.h>
+
+#include "AnomalyFilter.h"
+#include "CaptureRecorder.h"
+#include "Reclocker.h"
+#include "Unpacker.h"
+
+using namespace std::chrono;
+
+namespace
+{
+
+// transfers' worth of frames the Unpacker holds while it waits for the other endpoint.
+constexpr int kUnpackerWindowTransfers = 8;
+
+constexpr uint16_t kSimulatedFirmwareVersion = 0;
+const char* kSimulatedSerialNumber = "0";
+
+using SimulatedUnpacker = Unpacker<kSoundplaneANumEndpoints>;
+
+// a small and fast generator for noise and gaps, so that making a frame costs much
+// less than processing it.
+class Xorshift
+{
+public:
+	explicit Xorshift(unsigned int seed) : mState(seed ? seed : 1) {}
+
+	// uniform in [0, 1).
+	float next()
+	{
+		mState ^= mState << 13;
+		mState ^= mState >> 17;
+		mState ^= mState << 5;
+		return (mState >> 8)*(1.f/16777216.f);
+	}
+
+private:
+	uint32_t mState;
+};
+
+// triangle wave with period 1, going from 0 to 1 and back.
+float triangle(float t)
+{
+	const float p = t - std::floor(t);
+	return (p < 0.5f) ? 2.f*p : 2.f - 2.f*p;
+}
+
+void makeFrame(SensorFrame& frame, const SimulatedSoundplaneConfig& config, float t, Xorshift& rng)
+{
+	const float noiseScale = 2.f*config.noise;
+	for(auto& z : frame)
+	{
+		z = config.baseline + (rng.next() - 0.5f)*noiseScale;
+	}
+
+	for(const SimulatedTouch& touch : config.touches)
+	{
+		const float tt = t + touch.phase;
+		const float u = (touch.movePeriod > 0.f) ? triangle(tt/touch.movePeriod) : 0.f;
+		const float x = touch.x0 + (touch.x1 - touch.x0)*u;
+		const float y = touch.y0 + (touch.y1 - touch.y0)*u;
+
+		float z = touch.pressure;
+		if(touch.pressurePeriod > 0.f)
+		{
+			const float p = tt/touch.pressurePeriod;
+			z *= 0.5f*(1.f - std::cos(6.2831853f*(p - std::floor(p))));
+		}
+		if(z <= 0.f) continue;
+
+		// the blob is separable, so compute it along each axis.
+		const float k = -0.5f/(touch.radius*touch.radius);
+		std::array<float, SensorGeometry::width> gx;
+		std::array<float, SensorGeometry::height> gy;
+		for(int i=0; i<SensorGeometry::width; ++i)
+		{
+			gx[i] = std::exp(k*(i - x)*(i - x));
+		}
+		for(int j=0; j<SensorGeometry::height; ++j)
+		{
+			gy[j] = z*std::exp(k*(j - y)*(j - y));
+		}
+		for(int j=0; j<SensorGeometry::height; ++j)
+		{
+			float* pRow = frame.data() + j*SensorGeometry::width;
+			for(int i=0; i<SensorGeometry::width; ++i)
+			{
+				pRow[i] += gx[i]*gy[j];
+			}
+		}
+	}
+}
+
+}
+
+SimulatedSoundplaneDriver::SimulatedSoundplaneDriver(SoundplaneDriverListener& listener, const SimulatedSoundplaneConfig& config) :
+	mListener(listener),
+	mConfig(config)
+{
+	std::copy(kDefaultCarriers, kDefaultCarriers + kSoundplaneNumCarriers, mCurrentCarriers.begin());
+}
+
+SimulatedSoundplaneDriver::~SimulatedSoundplaneDriver()
+{
+	mQuitting.store(true, std::memory_order_release);
+	if(mProcessThread.joinable())
+	{
+		mProcessThread.join();
+	}
+}
+
+void SimulatedSoundplaneDriver::start()
+{
+	mProcessThread = std::thread(&SimulatedSoundplaneDriver::processThread, this);
+}
+
+int SimulatedSoundplaneDriver::getDeviceState() const
+{
+	return mState.load(std::memory_order_acquire);
+}
+
+uint16_t SimulatedSoundplaneDriver::getFirmwareVersion() const
+{
+	return kSimulatedFirmwareVersion;
+}
+
+std::string SimulatedSoundplaneDriver::getSerialNumberString() const
+{
+	return kSimulatedSerialNumber;
+}
+
+const unsigned char *SimulatedSoundplaneDriver::getCarriers() const
+{
+	return mCurrentCarriers.data();
+}
+
+void SimulatedSoundplaneDriver::setCarriers(const Carriers& carriers)
+{
+	mCurrentCarriers = carriers;
+	mCarriersChanged.store(true, std::memory_order_release);
+}
+
+void SimulatedSoundplaneDriver::enableCarriers(unsigned long mask)
+{
+	mCarriersChanged.store(true, std::memory_order_release);
+}
+
+int SimulatedSoundplaneDriver::getSerialNumber() const
+{
+	return std::stoi(kSimulatedSerialNumber);
+}
+
+void SimulatedSoundplaneDriver::processThread()
+{
+	const int packetsPerTransfer = std::max(mConfig.packetsPerTransfer, 1);
+	const int skew = std::max(mConfig.endpointSkew, 0);
+
+	// the transfers of endpoint 1 wait skew more transfers before they are given to the
+	// Unpacker, so keep enough buffers that they are not overwritten.
+	const int buffersPerEndpoint = skew + 1;
+	std::vector<SoundplaneADataPacket> buffers[kSoundplaneANumEndpoints];
+	for(auto& b : buffers)
+	{
+		b.resize(buffersPerEndpoint*packetsPerTransfer);
+	}
+	int bufferIndex[kSoundplaneANumEndpoints] {};
+	int packetCount[kSoundplaneANumEndpoints] {};
+
+	struct PendingTransfer
+	{
+		SoundplaneADataPacket* packets;
+		int numPackets;
+	};
+	std::deque<PendingTransfer> skewedTransfers;
+
+	char errorBuf[256];
+	auto anomalyFilter = makeAnomalyFilter(
+		[&](int startupCtr, float df, const SensorFrame& previousFrame, const SensorFrame& frame)
+		{
+			snprintf(errorBuf, sizeof(errorBuf), "(%f)", df);
+			mListener.onError(kDevDataDiffTooLarge, errorBuf);
+		},
+		[this](const SensorFrame& frame)
+		{
+			if(commitFrame(frame))
+			{
+				mListener.onFrameReady();
+			}
+		});
+	auto reclocker = makeReclocker(
+		[&](uint16_t previousSeqNum, uint16_t seqNum, int missingFrames)
+		{
+			snprintf(errorBuf, sizeof(errorBuf), "%d -> %d (%d)", previousSeqNum, seqNum, missingFrames);
+			mListener.onError(kDevGapInSequence, errorBuf);
+		},
+		std::ref(anomalyFilter));
+	SimulatedUnpacker unpacker(kUnpackerWindowTransfers*packetsPerTransfer, std::ref(reclocker));
+	unpacker.setTrace(&getPendingTrace());
+	unpacker.setMetrics(&getMutableMetrics());
+	steady_clock::time_point transferTime;
+	reclocker.setTransferTime(&transferTime);
+	reclocker.setFrameTime(&getPendingFrameTime());
+	reclocker.setMetrics(&getMutableMetrics());
+	anomalyFilter.setMetrics(&getMutableMetrics());
+
+	mState.store(kDeviceConnected, std::memory_order_release);
+	mListener.onStartup();
+
+	auto deliver = [&](int endpoint, SoundplaneADataPacket* packets, int numPackets)
+	{
+		transferTime = steady_clock::now();
+		getPendingTrace().mark(kTraceTransfer);
+		{
+			CaptureRecorderUse recorder(*this);
+			if(recorder)
+			{
+				for(int i=0; i<numPackets; ++i)
+				{
+					recorder->recordPacket(endpoint, packets[i], sizeof(SoundplaneADataPacket) - sizeof(packets[i].padding), transferTime);
+				}
+			}
+		}
+		if(numPackets > 0)
+		{
+			unpacker.gotTransfer(endpoint, packets, numPackets);
+		}
+	};
+
+	// as fast as the listener takes frames: wait for room for the frames of a transfer and
+	// those the Reclocker fills in for a gap.
+	auto waitForRoom = [&]()
+	{
+		SensorFrameRing& ring = getFrameRing();
+		const size_t room = std::min(static_cast<size_t>(packetsPerTransfer + kMaxInterpolatedFrames), ring.getCapacity());
+		while((ring.getCapacity() - ring.getFillLevel() < room) &&
+			!mQuitting.load(std::memory_order_acquire))
+		{
+			std::this_thread::yield();
+		}
+	};
+
+	Xorshift rng(mConfig.seed);
+	SensorFrame frame{};
+	SoundplaneADataPacket lostPacket;
+	const auto startTime = steady_clock::now();
+	const duration<double> framePeriod(1.0/kSoundplaneFrameRate);
+
+	for(uint64_t n = 0; !mQuitting.load(std::memory_order_acquire); ++n)
+	{
+		if(mCarriersChanged.exchange(false, std::memory_order_acquire))
+		{
+			// wait for data to settle after setting carriers
+			anomalyFilter.reset();
+		}
+
+		if(!mConfig.realTime && (n % packetsPerTransfer == 0))
+		{
+			waitForRoom();
+		}
+
+		makeFrame(frame, mConfig, static_cast<float>(n/kSoundplaneFrameRate), rng);
+
+		// pack the frame into the next packet of each endpoint, or throw away the
+		// packets that are lost.
+		SoundplaneADataPacket* packets[kSoundplaneANumEndpoints];
+		for(int e=0; e<kSoundplaneANumEndpoints; ++e)
+		{
+			const bool lost = (mConfig.gapProbability > 0.f) && (rng.next() < mConfig.gapProbability);
+			packets[e] = lost ? &lostPacket :
+				&buffers[e][bufferIndex[e]*packetsPerTransfer + packetCount[e]++];
+			packets[e]->seqNum = static_cast<uint16_t>(n);
+			packets[e]->padding = 0;
+		}
+		K1_pack_frame(frame, packets[0]->packedData, packets[1]->packedData);
+		mFramesGenerated.store(n + 1, std::memory_order_relaxed);
+
+		const bool lastFrame = mConfig.frames && (n + 1 >= mConfig.frames);
+		if(((n + 1) % packetsPerTransfer != 0) && !lastFrame) continue;
+
+		// both endpoints complete a transfer.
+		SoundplaneADataPacket* p0 = &buffers[0][bufferIndex[0]*packetsPerTransfer];
+		SoundplaneADataPacket* p1 = &buffers[1][bufferIndex[1]*packetsPerTransfer];
+		deliver(0, p0, packetCount[0]);
+		skewedTransfers.push_back(PendingTransfer{p1, packetCount[1]});
+		if(static_cast<int>(skewedTransfers.size()) > skew)
+		{
+			deliver(1, skewedTransfers.front().packets, skewedTransfers.front().numPackets);
+			skewedTransfers.pop_front();
+		}
+		for(int e=0; e<kSoundplaneANumEndpoints; ++e)
+		{
+			bufferIndex[e] = (bufferIndex[e] + 1) % buffersPerEndpoint;
+			packetCount[e] = 0;
+		}
+
+		if(mState.load(std::memory_order_acquire) == kDeviceConnected)
+		{
+			mState.store(kDeviceHasIsochSync, std::memory_order_release);
+		}
+
+		if(lastFrame)
+		{
+			// give the Unpacker the transfers of endpoint 1 still held back by the skew.
+			while(!skewedTransfers.empty())
+			{
+				if(!mConfig.realTime)
+				{
+					waitForRoom();
+				}
+				deliver(1, skewedTransfers.front().packets, skewedTransfers.front().numPackets);
+				skewedTransfers.pop_front();
+			}
+			break;
+		}
+
+		if(mConfig.realTime)
+		{
+			std::this_thread::sleep_until(startTime + duration_cast<steady_clock::duration>(framePeriod*(n + 1)));
+		}
+	}
+
+	mState.store(kNoDevice, std::memory_order_release);
+	if(!mQuitting.load(std::memory_order_acquire))
+	{
+		mListener.onClose();
+	}
+}
@@ -0,0 +1,129 @@
+// Driver for Soundplane Model A.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#ifndef __SIMULATED_SOUNDPLANE_DRIVER__
+#define __SIMULATED_SOUNDPLANE_DRIVER__
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "SoundplaneDriver.h"
+#include "SoundplaneModelA.h"
+
+/**
+ * One synthetic touch: a round blob that moves back and forth between two
+ * points while its pressure ramps up and down.
+ */
+struct SimulatedTouch
+{
+	// start and end positions in taxels. x is in [0, 64) and y in [0, 8).
+	float x0 = 16.f;
+	float y0 = 3.5f;
+	float x1 = 48.f;
+	float y1 = 3.5f;
+
+	// seconds to move from start to end and back, or 0 to stay at the start.
+	float movePeriod = 2.f;
+
+	// peak pressure, added to the baseline of the raw taxels at the center.
+	float pressure = 0.1f;
+
+	// seconds for the pressure to ramp from zero up to the peak and back down,
+	// or 0 for a constant pressure.
+	float pressurePeriod = 1.f;
+
+	// offset in seconds into both periods, to keep touches from moving together.
+	float phase = 0.f;
+
+	// standard deviation of the blob in taxels.
+	float radius = 1.f;
+};
+
+struct SimulatedSoundplaneConfig
+{
+	std::vector<SimulatedTouch> touches{SimulatedTouch()};
+
+	// raw taxel level with no touches, and the amplitude of the uniform noise
+	// added to each taxel. Raw taxels are in [0, 1).
+	float baseline = 0.25f;
+	float noise = 0.0005f;
+
+	// chance that the packet of one endpoint is lost, leaving a gap in its
+	// sequence numbers.
+	float gapProbability = 0.f;
+
+	// number of transfers that endpoint 1 lags behind endpoint 0.
+	int endpointSkew = 0;
+
+	// packets per endpoint in each isochronous transfer.
+	int packetsPerTransfer = 8;
+
+	// if true, frames are generated at kSoundplaneFrameRate. Otherwise, as fast
+	// as possible: the driver waits for room in its frame ring instead of
+	// dropping frames, so the listener sets the pace.
+	bool realTime = true;
+
+	// number of frames to generate before closing the device, or 0 to run
+	// until the driver is deleted.
+	uint64_t frames = 0;
+
+	unsigned int seed = 1;
+};
+
+/**
+ * A SoundplaneDriver for testing and benchmarking without a device. It
+ * generates the isochronous packet streams of both endpoints from the
+ * configured touches and feeds them through an Unpacker, a Reclocker and
+ * an AnomalyFilter, as a USB driver would, so everything downstream of the
+ * USB stack runs as it does with hardware.
+ *
+ * start() simulates plugging in a device. If config.frames is nonzero, the
+ * device is unplugged after that many frames and the listener's onClose()
+ * is called.
+ */
+class SimulatedSoundplaneDriver : public SoundplaneDriver
+{
+public:
+	SimulatedSoundplaneDriver(SoundplaneDriverListener& listener, const SimulatedSoundplaneConfig& config);
+	~SimulatedSoundplaneDriver();
+
+	// SoundplaneDriver
+	void start() override;
+	int getDeviceState() const override;
+	uint16_t getFirmwareVersion() const override;
+	std::string getSerialNumberString() const override;
+	const unsigned char *getCarriers() const override;
+	void setCarriers(const Carriers& carriers) override;
+	void enableCarriers(unsigned long mask) override;
+	int getSerialNumber() const override;
+
+	/**
+	 * The number of frames generated so far, including frames that were
+	 * lost to gaps or dropped by the AnomalyFilter.
+	 */
+	uint64_t getFramesGenerated() const { return mFramesGenerated.load(std::memory_order_relaxed); }
+
+private:
+	void processThread();
+
+	SoundplaneDriverListener& mListener;
+	const SimulatedSoundplaneConfig mConfig;
+
+	std::atomic<int> mState{kNoDevice};
+	std::atomic<bool> mQuitting{false};
+	std::atomic<uint64_t> mFramesGenerated{0};
+
+	/**
+	 * Set by setCarriers and enableCarriers and cleared by the process thread,
+	 * which then resets the AnomalyFilter as the USB drivers do.
+	 */
+	std::atomic<bool> mCarriersChanged{false};
+	Carriers mCurrentCarriers;
+
+	std::thread mProcessThread;
+};
+
+#endif // __SIMULATED_SOUNDPLANE_DRIVER__
@@ -5,6 +5,86 @@
 #include "SoundplaneDriver.h"
 
 #include <string>
+#include <thread>
 
 #include "SoundplaneModelA.h"
 
+void SoundplaneDriver::setCalibration(const SensorFrame& calibrateMeanInv)
+{
+	std::lock_guard<std::mutex> lock(mCalibrationMutex);
+	Calibration& calibration = mCalibration.getWriteBuffer();
+	calibration.enabled = true;
+	calibration.meanInv = calibrateMeanInv;
+	mCalibration.publish();
+}
+
+void SoundplaneDriver::clearCalibration()
+{
+	// meanInv is not used while the calibration is not enabled.
+	std::lock_guard<std::mutex> lock(mCalibrationMutex);
+	mCalibration.getWriteBuffer().enabled = false;
+	mCalibration.publish();
+}
+
+// the uses count and the recorder are sequentially consistent. If the count we read is even,
+// any use that starts later reads the recorder after our store. If it is odd, the use in
+// progress may have the previous recorder, and has let go of it once the count changes.
+void SoundplaneDriver::setCaptureRecorder(CaptureRecorder* recorder)
+{
+	mCaptureRecorder.store(recorder);
+	const uint32_t uses = mCaptureRecorderUses.load();
+	if(uses & 1)
+	{
+		while(mCaptureRecorderUses.load() == uses)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+// while not recording, which is almost always, a use is a single relaxed load. A recorder
+// seen that way is never used, so it can't be one setCaptureRecorder() has handed back.
+SoundplaneDriver::CaptureRecorderUse::CaptureRecorderUse(SoundplaneDriver& driver) :
+	mDriver(driver),
+	mRecorder(nullptr),
+	mCounted(driver.mCaptureRecorder.load(std::memory_order_relaxed) != nullptr)
+{
+	if(mCounted)
+	{
+		mDriver.mCaptureRecorderUses.fetch_add(1);
+		mRecorder = mDriver.mCaptureRecorder.load();
+	}
+}
+
+SoundplaneDriver::CaptureRecorderUse::~CaptureRecorderUse()
+{
+	if(mCounted)
+	{
+		mDriver.mCaptureRecorderUses.fetch_add(1, std::memory_order_release);
+	}
+}
+
+bool SoundplaneDriver::commitFrame(const SensorFrame& rawFrame)
+{
+	const Calibration& calibration = mCalibration.acquire();
+	DriverFrame* pSlot = mFrameRing.reserve();
+	if(!pSlot)
+	{
+		return false;
+	}
+	if(calibration.enabled)
+	{
+		scaleOffset(pSlot->frame, rawFrame, calibration.meanInv, -1.0f);
+	}
+	else
+	{
+		pSlot->frame = rawFrame;
+	}
+	pSlot->calibrated = calibration.enabled;
+	pSlot->time = std::chrono::steady_clock::now();
+	pSlot->frameTime = (mPendingFrameTime != std::chrono::steady_clock::time_point()) ? mPendingFrameTime : pSlot->time;
+	pSlot->trace = mPendingTrace;
+	pSlot->trace.mark(kTraceQueuePush);
+	mFrameRing.commit();
+	return true;
+}
@@ -7,10 +7,20 @@
 #define __SOUNDPLANE_DRIVER__
 
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <memory>
+#include <mutex>
 #include <string>
 
+#include "LatencyTrace.h"
+#include "Metrics.h"
 #include "SoundplaneModelA.h"
+#include "SPSCRing.h"
+#include "TripleBuffer.h"
+
+class CaptureRecorder;
 
 // device states
 //
@@ -35,12 +45,38 @@ enum
     kDevPayloadFailed = 5
 };
 
+// a frame in the driver's frame ring.
+struct DriverFrame
+{
+	SensorFrame frame;
+	
+	// true if the driver has calibrated the frame. See SoundplaneDriver::setCalibration().
+	bool calibrated;
+	
+	// the time the driver committed the frame.
+	std::chrono::steady_clock::time_point time;
+	
+	// the time the device made the frame, on the same clock, from the driver's
+	// Reclocker. Drivers without one use the commit time.
+	std::chrono::steady_clock::time_point frameTime;
+	
+	// timestamps of the frame in the driver, while latency tracing is enabled.
+	FrameTrace trace;
+};
+
+using SensorFrameRing = SPSCRing<DriverFrame>;
+
+const int kSensorFrameRingSize = 16;
+
 class SoundplaneDriverListener
 {
 public:
 	virtual ~SoundplaneDriverListener() = default;
     virtual void onStartup(void) = 0;
-	virtual void onFrame(const SensorFrame& frame) = 0;
+	
+	// called from the driver thread after a frame has been committed to the driver's
+	// frame ring. See SoundplaneDriver::getFrameRing().
+	virtual void onFrameReady() = 0;
     virtual void onError(int err, const char* errStr) = 0;
     virtual void onClose(void) = 0;
 };
@@ -97,6 +133,132 @@ public:
 	 */
 	static std::unique_ptr<SoundplaneDriver> create(SoundplaneDriverListener& listener);
 
+	/**
+	 * The driver unpacks each frame into a frame of its own and checks it,
+	 * then calibrates it into a slot of this ring, or copies it there while
+	 * frames are raw, see commitFrame(). That one pass is the only time the
+	 * frame is written to the ring. Then the driver calls
+	 * SoundplaneDriverListener::onFrameReady(). The listener
+	 * reads frames in place from its own thread and releases them. The
+	 * listener may set the overflow mode and read the fill and overflow
+	 * counters.
+	 */
+	SensorFrameRing& getFrameRing() { return mFrameRing; }
+
+	/**
+	 * Calibrate frames in the driver. Each taxel of a calibrated frame is
+	 * raw*calibrateMeanInv - 1. Drivers calibrate each frame as they commit
+	 * it to the ring, see commitFrame(), and mark the frames in the ring as
+	 * calibrated. May be called from any thread, and never blocks the driver
+	 * thread.
+	 */
+	void setCalibration(const SensorFrame& calibrateMeanInv);
+
+	/**
+	 * Go back to sending raw frames, for calibrating or for viewing the raw
+	 * data. May be called from any thread.
+	 */
+	void clearCalibration();
+
+	/**
+	 * Record the packets and carrier changes the device sends to recorder
+	 * from now on, or stop recording if recorder is null. Drivers that don't
+	 * support recording ignore this. The caller keeps ownership of recorder.
+	 * When this returns, the driver thread is done with the previous
+	 * recorder, so the caller may destroy it on its own thread. This waits
+	 * at most for the driver thread to finish recording one transfer. May
+	 * be called from any thread, but from one at a time.
+	 */
+	void setCaptureRecorder(CaptureRecorder* recorder);
+
+	/**
+	 * Counts of the frames and packets the driver has received and dropped.
+	 * May be read from any thread.
+	 */
+	const DriverMetrics& getMetrics() const { return mMetrics; }
+
+protected:
+	/**
+	 * Calibrate the raw frame into the next slot of the ring if there is a
+	 * calibration, or else copy it there, and commit the slot.
+	 * Returns false if the ring was full and the frame was dropped. The
+	 * driver should call SoundplaneDriverListener::onFrameReady() if this
+	 * returns true.
+	 */
+	bool commitFrame(const SensorFrame& rawFrame);
+
+	/**
+	 * The current recorder, or nullptr if not recording, for the driver
+	 * thread to use for as long as this exists. setCaptureRecorder() waits
+	 * until it is destroyed before it hands the previous recorder back. The
+	 * driver thread should make one per transfer and use it for all of the
+	 * transfer's packets. Never blocks or allocates.
+	 */
+	class CaptureRecorderUse
+	{
+	public:
+		explicit CaptureRecorderUse(SoundplaneDriver& driver);
+		~CaptureRecorderUse();
+
+		CaptureRecorderUse(const CaptureRecorderUse &) = delete;
+		CaptureRecorderUse &operator=(const CaptureRecorderUse &) = delete;
+
+		CaptureRecorder* get() const { return mRecorder; }
+		explicit operator bool() const { return mRecorder != nullptr; }
+		CaptureRecorder* operator->() const { return mRecorder; }
+
+	private:
+		SoundplaneDriver& mDriver;
+		CaptureRecorder* mRecorder;
+		const bool mCounted;
+	};
+
+	/**
+	 * The latency trace of the frame the driver thread is working on. Drivers
+	 * mark kTraceTransfer in it when a transfer completes and give it to their
+	 * Unpacker to mark kTraceUnpackerMatch. commitFrame() copies it to the
+	 * frame's slot and marks kTraceQueuePush. Driver thread only.
+	 */
+	FrameTrace& getPendingTrace() { return mPendingTrace; }
+
+	/**
+	 * The device time of the frame the driver thread is working on, set by
+	 * the driver's Reclocker. commitFrame() copies it to the frame's slot.
+	 * Driver thread only.
+	 */
+	std::chrono::steady_clock::time_point& getPendingFrameTime() { return mPendingFrameTime; }
+
+	/**
+	 * For the driver thread to update, usually by giving it to the Unpacker
+	 * and AnomalyFilter.
+	 */
+	DriverMetrics& getMutableMetrics() { return mMetrics; }
+
+private:
+	// the calibration commitFrame() applies, or raw frames if not enabled.
+	struct Calibration
+	{
+		bool enabled;
+		SensorFrame meanInv;
+	};
+	
+	// drivers are made with operator new, which ignores over-alignment in C++11.
+	static_assert(alignof(TripleBuffer<Calibration>) <= alignof(std::max_align_t), "calibration must not over-align the driver");
+
+	SensorFrameRing mFrameRing{kSensorFrameRingSize};
+	
+	// the driver thread acquires the latest calibration for each frame without
+	// locking or freeing anything. The TripleBuffer has one producer, so the
+	// threads that set the calibration take turns with mCalibrationMutex.
+	TripleBuffer<Calibration> mCalibration;
+	std::mutex mCalibrationMutex;
+	
+	// the recorder, and a count that is odd while the driver thread is using it.
+	std::atomic<CaptureRecorder*> mCaptureRecorder{nullptr};
+	std::atomic<uint32_t> mCaptureRecorderUses{0};
+	FrameTrace mPendingTrace;
+	std::chrono::steady_clock::time_point mPendingFrameTime{};
+	DriverMetrics mMetrics;
 };
 
 #endif // __SOUNDPLANE_DRIVER__
@@ -4,7 +4,17 @@
 
 #include "SoundplaneModelA.h"
 
+#include <algorithm>
 #include <math.h>
+#include <stdio.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SP_UNPACK_SSSE3 1
+#include <tmmintrin.h>
+#elif defined(__aarch64__)
+#define SP_UNPACK_NEON 1
+#include <arm_neon.h>
+#endif
 
 const char* kSoundplaneAName = ("Soundplane Model A");
 
@@ -68,6 +78,43 @@ void K1_unpack_float2(unsigned char *pSrc0, unsigned char *pSrc1, SensorFrame& d
 	}
 }
 
+static unsigned short K1_pack_taxel(float x)
+{
+	const float v = std::min(std::max(x*4096.f + 0.5f, 0.f), 4095.f);
+	return static_cast<unsigned short>(v);
+}
+
+void K1_pack_frame(const SensorFrame& src, unsigned char *pDest0, unsigned char *pDest1)
+{
+	const float *pSrc = src.data();
+	unsigned short a0, a1, b0, b1;
+	const float *pSrcRow0, *pSrcRow1;
+
+	// the same layout as K1_unpack_float2(), with surface 2 flipped.
+	int c = 0;
+	for(int i=0; i<kSoundplaneAPickupsPerBoard; ++i)
+	{
+		pSrcRow0 = pSrc + kSoundplaneANumCarriers*2*i;
+		pSrcRow1 = pSrcRow0 + kSoundplaneANumCarriers;
+		for (int j = 0; j < kSoundplaneANumCarriers; j += 2)
+		{
+			a0 = K1_pack_taxel(pSrcRow0[j]);
+			a1 = K1_pack_taxel(pSrcRow0[j + 1]);
+			pDest0[c] = a0 & 0xFF;
+			pDest0[c+1] = ((a0 >> 8) & 0x0F) | ((a1 & 0x0F) << 4);
+			pDest0[c+2] = (a1 >> 4) & 0xFF;
+
+			b0 = K1_pack_taxel(pSrcRow1[kSoundplaneANumCarriers - 1 - j]);
+			b1 = K1_pack_taxel(pSrcRow1[kSoundplaneANumCarriers - 2 - j]);
+			pDest1[c] = b0 & 0xFF;
+			pDest1[c+1] = ((b0 >> 8) & 0x0F) | ((b1 & 0x0F) << 4);
+			pDest1[c+2] = (b1 >> 4) & 0xFF;
+
+			c += 3;
+		}
+	}
+}
+
 // set data from edge carriers, unused on Soundplane A, to duplicate
 // actual data nearby.
 void K1_clear_edges(SensorFrame& dest)
@@ -86,6 +133,191 @@ void K1_clear_edges(SensorFrame& dest)
 	}
 }
 
+// set the edge carriers of one row as in K1_clear_edges().
+static inline void clearRowEdges(float* pDestRow)
+{
+	const float zl = pDestRow[2];
+	pDestRow[1] = zl;
+	pDestRow[0] = 0;
+	const float zr = pDestRow[kSoundplaneANumCarriers*2 - 3];
+	pDestRow[kSoundplaneANumCarriers*2 - 2] = zr;
+	pDestRow[kSoundplaneANumCarriers*2 - 1] = 0;
+}
+
+static const float kTaxelScale = 1.f/4096.f;
+
+void K1_unpack_frame_scalar(const unsigned char *pSrc0, const unsigned char *pSrc1, SensorFrame& dest)
+{
+	float *pDest = dest.data();
+	int c = 0;
+	for(int i=0; i<kSoundplaneAPickupsPerBoard; ++i)
+	{
+		float* pDestRow0 = pDest + kSoundplaneANumCarriers*2*i;
+		float* pDestRow1 = pDestRow0 + kSoundplaneANumCarriers;
+		for (int j = 0; j < kSoundplaneANumCarriers; j += 2)
+		{
+			pDestRow0[j] = ((pSrc0[c+1] & 0x0F) << 8 | pSrc0[c])*kTaxelScale;
+			pDestRow0[j + 1] = (pSrc0[c+2] << 4 | pSrc0[c+1] >> 4)*kTaxelScale;
+
+			// flip surface 2
+			pDestRow1[kSoundplaneANumCarriers - 1 - j] = ((pSrc1[c+1] & 0x0F) << 8 | pSrc1[c])*kTaxelScale;
+			pDestRow1[kSoundplaneANumCarriers - 2 - j] = (pSrc1[c+2] << 4 | pSrc1[c+1] >> 4)*kTaxelScale;
+			c += 3;
+		}
+		clearRowEdges(pDestRow0);
+	}
+}
+
+// SIMD unpacking. Each 12 bytes of payload hold 8 taxels. A byte shuffle puts the two bytes
+// containing each taxel into its own 16-bit lane: bytes (3k, 3k+1) for taxel 2k and (3k+1, 3k+2)
+// for taxel 2k+1. Even taxels are then the low 12 bits of their lane and odd taxels the high
+// 12 bits. The shuffles for surface 2 also reverse the order of the lanes.
+//
+// Each row of 32 taxels is 48 bytes, read as 16-byte loads at offsets 0, 12, 24 and 32. The last
+// load is shifted back by 4 bytes so that we never read past the end of the payload.
+
+#if SP_UNPACK_SSSE3 || SP_UNPACK_NEON
+
+// byte indices for taxels 0-7 of a 12-byte group, in lane order, starting at byte 0 or byte 4.
+#define SP_FORWARD_SHUFFLE(o) { o+0, o+1, o+1, o+2, o+3, o+4, o+4, o+5, o+6, o+7, o+7, o+8, o+9, o+10, o+10, o+11 }
+#define SP_REVERSE_SHUFFLE(o) { o+10, o+11, o+9, o+10, o+7, o+8, o+6, o+7, o+4, o+5, o+3, o+4, o+1, o+2, o+0, o+1 }
+
+alignas(16) static const unsigned char kForwardShuffle[2][16] = { SP_FORWARD_SHUFFLE(0), SP_FORWARD_SHUFFLE(4) };
+alignas(16) static const unsigned char kReverseShuffle[2][16] = { SP_REVERSE_SHUFFLE(0), SP_REVERSE_SHUFFLE(4) };
+
+#undef SP_FORWARD_SHUFFLE
+#undef SP_REVERSE_SHUFFLE
+
+// lanes holding even taxels, which take the low 12 bits, in forward and reversed order.
+alignas(16) static const uint16_t kForwardEvenLanes[8] = { 0xFFFF, 0, 0xFFFF, 0, 0xFFFF, 0, 0xFFFF, 0 };
+alignas(16) static const uint16_t kReverseEvenLanes[8] = { 0, 0xFFFF, 0, 0xFFFF, 0, 0xFFFF, 0, 0xFFFF };
+
+#endif
+
+#if SP_UNPACK_SSSE3
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("ssse3"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("ssse3")
+#endif
+
+static inline void unpackGroupSSSE3(const unsigned char* pSrc, const __m128i shuffle, const __m128i evenLanes, float* pDest)
+{
+	const __m128i x = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc)), shuffle);
+	const __m128i low = _mm_and_si128(x, _mm_set1_epi16(0x0FFF));
+	const __m128i high = _mm_srli_epi16(x, 4);
+	const __m128i taxels = _mm_or_si128(_mm_and_si128(evenLanes, low), _mm_andnot_si128(evenLanes, high));
+	const __m128 scale = _mm_set1_ps(kTaxelScale);
+	const __m128i zero = _mm_setzero_si128();
+	_mm_storeu_ps(pDest, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(taxels, zero)), scale));
+	_mm_storeu_ps(pDest + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(taxels, zero)), scale));
+}
+
+static void K1_unpack_frame_SSSE3(const unsigned char *pSrc0, const unsigned char *pSrc1, SensorFrame& dest)
+{
+	const __m128i forward0 = _mm_load_si128(reinterpret_cast<const __m128i*>(kForwardShuffle[0]));
+	const __m128i forward4 = _mm_load_si128(reinterpret_cast<const __m128i*>(kForwardShuffle[1]));
+	const __m128i reverse0 = _mm_load_si128(reinterpret_cast<const __m128i*>(kReverseShuffle[0]));
+	const __m128i reverse4 = _mm_load_si128(reinterpret_cast<const __m128i*>(kReverseShuffle[1]));
+	const __m128i forwardEven = _mm_load_si128(reinterpret_cast<const __m128i*>(kForwardEvenLanes));
+	const __m128i reverseEven = _mm_load_si128(reinterpret_cast<const __m128i*>(kReverseEvenLanes));
+
+	for(int i=0; i<kSoundplaneAPickupsPerBoard; ++i)
+	{
+		const unsigned char* pRow0 = pSrc0 + 48*i;
+		const unsigned char* pRow1 = pSrc1 + 48*i;
+		float* pDestRow0 = dest.data() + kSoundplaneANumCarriers*2*i;
+		float* pDestRow1 = pDestRow0 + kSoundplaneANumCarriers;
+
+		unpackGroupSSSE3(pRow0, forward0, forwardEven, pDestRow0);
+		unpackGroupSSSE3(pRow0 + 12, forward0, forwardEven, pDestRow0 + 8);
+		unpackGroupSSSE3(pRow0 + 24, forward0, forwardEven, pDestRow0 + 16);
+		unpackGroupSSSE3(pRow0 + 32, forward4, forwardEven, pDestRow0 + 24);
+
+		// flip surface 2
+		unpackGroupSSSE3(pRow1, reverse0, reverseEven, pDestRow1 + 24);
+		unpackGroupSSSE3(pRow1 + 12, reverse0, reverseEven, pDestRow1 + 16);
+		unpackGroupSSSE3(pRow1 + 24, reverse0, reverseEven, pDestRow1 + 8);
+		unpackGroupSSSE3(pRow1 + 32, reverse4, reverseEven, pDestRow1);
+
+		clearRowEdges(pDestRow0);
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif // SP_UNPACK_SSSE3
+
+#if SP_UNPACK_NEON
+
+static inline void unpackGroupNEON(const unsigned char* pSrc, const uint8x16_t shuffle, const uint16x8_t evenLanes, float* pDest)
+{
+	const uint16x8_t x = vreinterpretq_u16_u8(vqtbl1q_u8(vld1q_u8(pSrc), shuffle));
+	const uint16x8_t taxels = vbslq_u16(evenLanes, vandq_u16(x, vdupq_n_u16(0x0FFF)), vshrq_n_u16(x, 4));
+	vst1q_f32(pDest, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(taxels))), kTaxelScale));
+	vst1q_f32(pDest + 4, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(taxels))), kTaxelScale));
+}
+
+static void K1_unpack_frame_NEON(const unsigned char *pSrc0, const unsigned char *pSrc1, SensorFrame& dest)
+{
+	const uint8x16_t forward0 = vld1q_u8(kForwardShuffle[0]);
+	const uint8x16_t forward4 = vld1q_u8(kForwardShuffle[1]);
+	const uint8x16_t reverse0 = vld1q_u8(kReverseShuffle[0]);
+	const uint8x16_t reverse4 = vld1q_u8(kReverseShuffle[1]);
+	const uint16x8_t forwardEven = vld1q_u16(kForwardEvenLanes);
+	const uint16x8_t reverseEven = vld1q_u16(kReverseEvenLanes);
+
+	for(int i=0; i<kSoundplaneAPickupsPerBoard; ++i)
+	{
+		const unsigned char* pRow0 = pSrc0 + 48*i;
+		const unsigned char* pRow1 = pSrc1 + 48*i;
+		float* pDestRow0 = dest.data() + kSoundplaneANumCarriers*2*i;
+		float* pDestRow1 = pDestRow0 + kSoundplaneANumCarriers;
+
+		unpackGroupNEON(pRow0, forward0, forwardEven, pDestRow0);
+		unpackGroupNEON(pRow0 + 12, forward0, forwardEven, pDestRow0 + 8);
+		unpackGroupNEON(pRow0 + 24, forward0, forwardEven, pDestRow0 + 16);
+		unpackGroupNEON(pRow0 + 32, forward4, forwardEven, pDestRow0 + 24);
+
+		// flip surface 2
+		unpackGroupNEON(pRow1, reverse0, reverseEven, pDestRow1 + 24);
+		unpackGroupNEON(pRow1 + 12, reverse0, reverseEven, pDestRow1 + 16);
+		unpackGroupNEON(pRow1 + 24, reverse0, reverseEven, pDestRow1 + 8);
+		unpackGroupNEON(pRow1 + 32, reverse4, reverseEven, pDestRow1);
+
+		clearRowEdges(pDestRow0);
+	}
+}
+
+#endif // SP_UNPACK_NEON
+
+typedef void (*UnpackFn)(const unsigned char *pSrc0, const unsigned char *pSrc1, SensorFrame& dest);
+
+static UnpackFn chooseUnpackFn()
+{
+#if SP_UNPACK_SSSE3
+	if(__builtin_cpu_supports("ssse3"))
+	{
+		return K1_unpack_frame_SSSE3;
+	}
+#elif SP_UNPACK_NEON
+	return K1_unpack_frame_NEON;
+#endif
+	return K1_unpack_frame_scalar;
+}
+
+void K1_unpack_frame(const unsigned char *pSrc0, const unsigned char *pSrc1, SensorFrame& dest)
+{
+	static const UnpackFn unpack = chooseUnpackFn();
+	unpack(pSrc0, pSrc1, dest);
+}
+
 // return difference between the sums of first rows of each frame.
 float frameDiff(const SensorFrame& p0, const SensorFrame& p1)
 {
@@ -6,6 +6,7 @@
 #define __SOUNDPLANE_MODEL_A__
 
 #include <array>
+#include <cstdint>
 #include "SensorFrame.h"
 
 // Soundplane data format:
@@ -33,14 +34,9 @@
 const int kSoundplaneTouchWidth = 8;
 const int kSoundplaneCalibrateSize = 1024;
 const int kSoundplaneHistorySize = 2048;
-const float kSoundplaneFrameRate = 976.5625f;
 const int kSoundplaneFrameIntervalMicros = 1000.f*1000.f/kSoundplaneFrameRate;
 const float kZeroFilterFrequency = 10.f;
 
-const int kSoundplaneAKeyWidth = 30;
-const int kSoundplaneAKeyHeight = 5;
-const int kSoundplaneAMaxZones = 150;
-
 // Soundplane A hardware
 const uint16_t kSoundplaneUSBVendor = 0x0451;
 const uint16_t kSoundplaneUSBProduct = 0x5100;
@@ -54,6 +50,9 @@ const int kSoundplaneNumCarriers = 32;
 const int kSoundplanePossibleCarriers = 64;
 const float kMaxFrameDiff = 1.0f;
 
+// frames to skip after connecting or changing carriers before checking frame differences.
+const int kSoundplaneStartupFrames = 250;
+
 // Soundplane A USB firmware
 const int kSoundplaneANumEndpoints = 2;
 const int kSoundplaneAEndpointStartIdx = 1;
@@ -91,6 +90,19 @@ typedef enum
 
 void K1_unpack_float2(unsigned char *pSrc0, unsigned char *pSrc1, SensorFrame& dest);
 void K1_clear_edges(SensorFrame& dest);
+
+// unpack both surface payloads and clear the edges in one pass, using SIMD instructions where
+// available. The result is the same as K1_unpack_float2() followed by K1_clear_edges().
+// Reads exactly kSoundplaneAPackedDataSize bytes from each source.
+void K1_unpack_frame(const unsigned char *pSrc0, const unsigned char *pSrc1, SensorFrame& dest);
+
+// K1_unpack_frame() without SIMD instructions, to check the SIMD versions against.
+void K1_unpack_frame_scalar(const unsigned char *pSrc0, const unsigned char *pSrc1, SensorFrame& dest);
+
+// pack a frame into the two surface payloads, the inverse of K1_unpack_float2(). Values are
+// clamped to the 12-bit range. Used to make synthetic data for simulated devices.
+void K1_pack_frame(const SensorFrame& src, unsigned char *pDest0, unsigned char *pDest1);
+
 float frameDiff(const SensorFrame& p0, const SensorFrame& p1);
 void dumpFrame(float* frame);
 
@@ -0,0 +1,114 @@
+// StatsServer.cpp
+//
+// Serves metrics as text on a UNIX domain socket, one snapshot per connection.
+
+#include "StatsServer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+
+// how often the server thread checks whether it should stop.
+const int kPollMillis = 100;
+
+// a client that hangs up early must not raise SIGPIPE.
+#ifdef MSG_NOSIGNAL
+const int kSendFlags = MSG_NOSIGNAL;
+#else
+const int kSendFlags = 0;
+#endif
+
+}
+
+StatsServer::~StatsServer()
+{
+	stop();
+}
+
+bool StatsServer::start(const std::string& path)
+{
+	stop();
+
+	sockaddr_un addr{};
+	if(path.empty() || (path.size() >= sizeof(addr.sun_path)))
+	{
+		fprintf(stderr, "StatsServer: bad socket path %s\n", path.c_str());
+		return false;
+	}
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+	int s = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(s < 0)
+	{
+		perror("StatsServer: socket");
+		return false;
+	}
+
+	// a socket file left by an earlier run would make bind() fail.
+	unlink(path.c_str());
+	if((bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) || (listen(s, 8) < 0))
+	{
+		perror("StatsServer: bind");
+		close(s);
+		return false;
+	}
+
+	mPath = path;
+	mListenSocket = s;
+	mQuitting.store(false, std::memory_order_release);
+	mThread = std::thread(&StatsServer::serverThread, this);
+	return true;
+}
+
+void StatsServer::stop()
+{
+	if(!mThread.joinable()) return;
+
+	mQuitting.store(true, std::memory_order_release);
+	mThread.join();
+	close(mListenSocket);
+	mListenSocket = -1;
+	unlink(mPath.c_str());
+	mPath.clear();
+}
+
+void StatsServer::serverThread()
+{
+	while(!mQuitting.load(std::memory_order_acquire))
+	{
+		pollfd pfd{mListenSocket, POLLIN, 0};
+		if(poll(&pfd, 1, kPollMillis) <= 0) continue;
+
+		int client = accept(mListenSocket, nullptr, nullptr);
+		if(client < 0) continue;
+#ifdef SO_NOSIGPIPE
+		int one = 1;
+		setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+		std::ostringstream text;
+		mRegistry.writeText(text);
+		const std::string str = text.str();
+
+		// write the snapshot and hang up. A client that stops reading is dropped.
+		size_t sent = 0;
+		while(sent < str.size())
+		{
+			pollfd out{client, POLLOUT, 0};
+			if(poll(&out, 1, kPollMillis) <= 0) break;
+			ssize_t n = send(client, str.data() + sent, str.size() - sent, kSendFlags);
+			if(n <= 0) break;
+			sent += n;
+		}
+		close(client);
+	}
+}
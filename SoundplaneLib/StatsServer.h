@@ -0,0 +1,55 @@
+// Driver for Soundplane Model A.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#ifndef __STATS_SERVER__
+#define __STATS_SERVER__
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "Metrics.h"
+
+/**
+ * Serves the metrics in a registry as text on a local UNIX domain socket.
+ * Each connection gets the current values as "name value" lines and is then
+ * closed, so any number of monitors can poll it, for example with
+ *
+ *   socat - UNIX-CONNECT:/tmp/soundplane.stats
+ *
+ * The server runs on its own thread, and never blocks the threads updating
+ * the metrics.
+ */
+class StatsServer
+{
+public:
+	explicit StatsServer(const MetricsRegistry& registry) : mRegistry(registry) {}
+	~StatsServer();
+
+	StatsServer(const StatsServer&) = delete;
+	StatsServer& operator=(const StatsServer&) = delete;
+
+	/**
+	 * Listen on the socket at path, replacing any socket file already there,
+	 * and stop listening on any previous path. Returns false if the socket
+	 * could not be made.
+	 */
+	bool start(const std::string& path);
+
+	// stop listening and remove the socket file.
+	void stop();
+
+	bool isRunning() const { return mThread.joinable(); }
+
+private:
+	void serverThread();
+
+	const MetricsRegistry& mRegistry;
+	std::string mPath;
+	int mListenSocket{-1};
+	std::atomic<bool> mQuitting{false};
+	std::thread mThread;
+};
+
+#endif // __STATS_SERVER__
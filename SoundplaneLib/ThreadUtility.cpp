@@ -2,6 +2,28 @@
 
 #include "ThreadUtility.h"
 
+#include <mutex>
+
+namespace
+{
+
+std::mutex gRealtimeOptionsMutex;
+RealtimeOptions gRealtimeOptions;
+
+}
+
+void setRealtimeOptions(const RealtimeOptions& options)
+{
+	std::lock_guard<std::mutex> lock(gRealtimeOptionsMutex);
+	gRealtimeOptions = options;
+}
+
+RealtimeOptions getRealtimeOptions()
+{
+	std::lock_guard<std::mutex> lock(gRealtimeOptionsMutex);
+	return gRealtimeOptions;
+}
+
 #ifdef __APPLE__
 #include <mach/mach.h>
 #include <mach/mach_init.h>
@@ -157,18 +179,171 @@ void SetPriorityRealtimeAudio(pthread_t inThread)
     
 }
 
-    
+// the time-constraint policy is the nearest thing to SCHED_FIFO here. There is no way
+// to pin threads to CPUs.
+RealtimeStatus setThreadRealtime(pthread_t inThread, RealtimeThreadRole role)
+{
+	RealtimeStatus status;
+	if(getRealtimeOptions().policy != SCHED_OTHER)
+	{
+		SetPriorityRealtimeAudio(inThread);
+		status.policy = SCHED_FIFO;
+	}
+	return status;
+}
 
 #else
 
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+
+namespace
+{
+
+const char* getPolicyName(int policy)
+{
+	switch(policy)
+	{
+		case SCHED_FIFO: return "SCHED_FIFO";
+		case SCHED_RR: return "SCHED_RR";
+		default: return "SCHED_OTHER";
+	}
+}
+
+int setPolicy(pthread_t thread, int policy, int priority)
+{
+	sched_param param{};
+	param.sched_priority = priority;
+	return pthread_setschedparam(thread, policy, &param);
+}
+
+// lock the pages we have and the pages we map from now on. Where the kernel allows,
+// pages are locked as they are first touched, so only the working set is locked.
+int lockMemory()
+{
+#ifdef MCL_ONFAULT
+	if(mlockall(MCL_CURRENT | MCL_FUTURE | MCL_ONFAULT) == 0) return 0;
+#endif
+	return (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) ? 0 : errno;
+}
+
+}
+
 void setThreadPriority(pthread_t inThread, uint32_t inPriority, bool inIsFixed)
 {
-    int policy;
-    struct sched_param param;
+	// on null thread argument, set the priority of the current thread
+	pthread_t threadToAffect = inThread ? inThread : pthread_self();
+	
+	// fixed priorities in the Mach range 0-127 map onto the real-time policy's range.
+	// Others are left time-shared.
+	const int policy = getRealtimeOptions().policy;
+	if(!inIsFixed || (policy == SCHED_OTHER)) return;
+	const int minPriority = sched_get_priority_min(policy);
+	const int maxPriority = sched_get_priority_max(policy);
+	const int priority = minPriority + (maxPriority - minPriority)*std::min(inPriority, 127u)/127;
+	setPolicy(threadToAffect, policy, priority);
+}
+
+void SetPriorityRealtimeAudio(pthread_t inThread)
+{
+	setThreadRealtime(inThread, kRealtimeProcessThread);
+}
 
-    pthread_getschedparam(inThread, &policy, &param);
-    param.sched_priority = sched_get_priority_max(policy);
-    pthread_setschedparam(inThread, policy, &param);
+RealtimeStatus setThreadRealtime(pthread_t inThread, RealtimeThreadRole role)
+{
+	const RealtimeOptions options = getRealtimeOptions();
+	const bool isDriver = (role == kRealtimeDriverThread);
+	std::string notes;
+	
+	// scheduling. Without CAP_SYS_NICE, the priority may not be above RLIMIT_RTPRIO.
+	if((options.policy == SCHED_FIFO) || (options.policy == SCHED_RR))
+	{
+		const int minPriority = sched_get_priority_min(options.policy);
+		const int maxPriority = sched_get_priority_max(options.policy);
+		int priority = options.priority - (isDriver ? 0 : 1);
+		priority = std::max(minPriority, std::min(priority, maxPriority));
+		int err = setPolicy(inThread, options.policy, priority);
+		if(err == EPERM)
+		{
+			rlimit limit{};
+			getrlimit(RLIMIT_RTPRIO, &limit);
+			const int limitPriority = static_cast<int>(std::min<rlim_t>(limit.rlim_cur, maxPriority));
+			notes += ", RLIMIT_RTPRIO is " + std::to_string(limitPriority);
+			if(limitPriority >= minPriority)
+			{
+				err = setPolicy(inThread, options.policy, std::min(priority, limitPriority));
+			}
+		}
+		if(err)
+		{
+			notes += std::string(", couldn't set ") + getPolicyName(options.policy) + ": " + strerror(err);
+		}
+	}
+	
+	// affinity.
+	const int cpu = isDriver ? options.driverCPU : options.processCPU;
+	if((cpu >= 0) && (cpu < CPU_SETSIZE))
+	{
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(cpu, &cpus);
+		int err = pthread_setaffinity_np(inThread, sizeof(cpus), &cpus);
+		if(err)
+		{
+			notes += ", couldn't pin to CPU " + std::to_string(cpu) + ": " + strerror(err);
+		}
+	}
+	
+	// memory, once for the process.
+	static std::once_flag lockOnce;
+	static std::atomic<bool> memoryLocked{false};
+	if(options.lockMemory)
+	{
+		std::call_once(lockOnce, [&]()
+		{
+			int err = lockMemory();
+			memoryLocked.store(!err);
+			if(err)
+			{
+				notes += std::string(", couldn't lock memory: ") + strerror(err);
+			}
+		});
+	}
+	
+	// report what took effect, as the kernel sees it.
+	RealtimeStatus status;
+	sched_param param{};
+	if(pthread_getschedparam(inThread, &status.policy, &param) == 0)
+	{
+		status.priority = param.sched_priority;
+	}
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	if((pthread_getaffinity_np(inThread, sizeof(cpus), &cpus) == 0) && (CPU_COUNT(&cpus) == 1))
+	{
+		for(int i=0; i<CPU_SETSIZE; ++i)
+		{
+			if(CPU_ISSET(i, &cpus))
+			{
+				status.cpu = i;
+				break;
+			}
+		}
+	}
+	status.memoryLocked = memoryLocked.load();
+	
+	const std::string cpuName = (status.cpu >= 0) ? "CPU " + std::to_string(status.cpu) : "any CPU";
+	printf("%s thread: %s priority %d, %s%s%s\n", isDriver ? "driver" : "process",
+		getPolicyName(status.policy), status.priority, cpuName.c_str(),
+		status.memoryLocked ? ", memory locked" : "", notes.c_str());
+	return status;
 }
 
 #endif
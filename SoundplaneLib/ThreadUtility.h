@@ -7,8 +7,55 @@
 #define __THREAD_UTILITY__
 
 #include <pthread.h>
+#include <sched.h>
 #include <stdint.h>
 
+// the real-time threads of the client.
+enum RealtimeThreadRole
+{
+	kRealtimeDriverThread,
+	kRealtimeProcessThread
+};
+
+// How the real-time threads are scheduled. Set these before the driver and
+// model are made. On Linux, a priority above RLIMIT_RTPRIO is lowered to the
+// limit, and if the limit is 0 the threads stay time-shared. CPU pinning and
+// memory locking are only done on Linux.
+struct RealtimeOptions
+{
+	// SCHED_FIFO, SCHED_RR, or SCHED_OTHER to leave the threads time-shared.
+	int policy{SCHED_FIFO};
+
+	// the priority of the driver thread. The process thread gets one less, so
+	// that USB transfers are always resubmitted first.
+	int priority{70};
+
+	// CPUs to pin each thread to, or -1 to let it run on any CPU.
+	int driverCPU{-1};
+	int processCPU{-1};
+
+	// lock the pages the process has and will touch into memory, so that the
+	// real-time threads never wait for a page fault.
+	bool lockMemory{false};
+};
+
+// what setThreadRealtime() managed to do for a thread.
+struct RealtimeStatus
+{
+	int policy{SCHED_OTHER};
+	int priority{0};
+	int cpu{-1};
+	bool memoryLocked{false};
+};
+
+void setRealtimeOptions(const RealtimeOptions& options);
+RealtimeOptions getRealtimeOptions();
+
+// schedule inThread as the options ask for its role, as far as the system
+// allows, print which settings took effect and return them. The first call
+// also locks memory if the options ask for it.
+RealtimeStatus setThreadRealtime(pthread_t inThread, RealtimeThreadRole role);
+
 void setThreadPriority(pthread_t inThread, uint32_t inPriority, bool inIsFixed);
 void SetPriorityRealtimeAudio(pthread_t inThread);
 
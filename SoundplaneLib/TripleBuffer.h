@@ -0,0 +1,88 @@
+// Driver for Soundplane Model A.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#ifndef __TRIPLE_BUFFER__
+#define __TRIPLE_BUFFER__
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Lock-free snapshots of a value from one producer thread to one consumer
+ * thread, for example from the processing thread to a view. The producer
+ * writes the next value into its own buffer and publishes it. The consumer
+ * acquires the most recently published value and reads it in place.
+ * Neither thread ever blocks or allocates, and values that the consumer
+ * doesn't get to in time are skipped.
+ *
+ * The three buffers swap roles through one atomic index, so the producer's
+ * buffer, the latest published buffer and the consumer's buffer are always
+ * different.
+ */
+template<typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() = default;
+
+	TripleBuffer(const TripleBuffer &) = delete;
+	TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+	// producer
+
+	/**
+	 * The buffer to write the next value to. It is not the most recently
+	 * published value, so it must be written completely.
+	 */
+	T& getWriteBuffer()
+	{
+		return mBuffers[mWrite];
+	}
+
+	/**
+	 * Make the write buffer the most recently published value.
+	 */
+	void publish()
+	{
+		const uint8_t previous = mLatest.exchange(mWrite | kNew, std::memory_order_acq_rel);
+		mWrite = previous & kIndexMask;
+	}
+
+	/**
+	 * Publish a copy of value.
+	 */
+	void publish(const T& value)
+	{
+		getWriteBuffer() = value;
+		publish();
+	}
+
+	// consumer
+
+	/**
+	 * Returns the most recently published value, or a value-initialized T
+	 * if nothing has been published yet. The reference stays valid and
+	 * unchanged until the next call to acquire().
+	 */
+	const T& acquire()
+	{
+		if(mLatest.load(std::memory_order_relaxed) & kNew)
+		{
+			const uint8_t latest = mLatest.exchange(mRead, std::memory_order_acq_rel);
+			mRead = latest & kIndexMask;
+		}
+		return mBuffers[mRead];
+	}
+
+private:
+	static constexpr uint8_t kIndexMask = 3;
+	static constexpr uint8_t kNew = 4;
+
+	T mBuffers[3]{};
+	uint8_t mWrite{0};
+	std::atomic<uint8_t> mLatest{1};
+	uint8_t mRead{2};
+};
+
+#endif // __TRIPLE_BUFFER__
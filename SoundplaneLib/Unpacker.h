@@ -5,8 +5,13 @@
 #ifndef __UNPACKER__
 #define __UNPACKER__
 
+#include <algorithm>
 #include <array>
+#include <functional>
+#include <vector>
 
+#include "LatencyTrace.h"
+#include "Metrics.h"
 #include "SoundplaneModelA.h"
 
 /**
@@ -17,190 +22,302 @@
  * Unpacker objects do this, so that the SoundplaneDriver objects can focus on
  * the actual USB stuff.
  */
-template<int StoredTransfersPerEndpoint, int Endpoints>
+template<int Endpoints>
 class Unpacker
 {
 	static_assert(Endpoints == 2, "Unpacker only supports 2 endpoints at the moment");
 
+	static bool lessThanHandleOverflow(uint16_t a, uint16_t b)
+	{
+		// This expression is equivalent to a < b, except that it gracefully
+		// handles serial number overflows.
+		return static_cast<uint16_t>(b - a) < (1 << (sizeof(a) * 8 - 1));
+	}
+
+	// the largest window for which every held sequence number is unambiguous.
+	static constexpr int kMaxWindow = 1 << (sizeof(uint16_t) * 8 - 1);
+
 	/**
-	 * A basic ring buffer
+	 * The packets held for one sequence number. A slot is in use for the
+	 * sequence numbers from mNextSeqNum up to the window size after it, and
+	 * is emptied when mNextSeqNum passes it.
 	 */
-	template<typename T, size_t Capacity>
-	class RingBuffer
+	struct Slot
 	{
-	public:
-		RingBuffer() = default;
-
-		RingBuffer(const RingBuffer &) = delete;
-		RingBuffer &operator=(const RingBuffer &) = delete;
+		std::array<bool, Endpoints> full{};
+		std::array<SoundplaneADataPacket, Endpoints> packets;
+	};
 
-		/**
-		 * If the buffer overflows, the oldest value is silently discarded.
-		 */
-		void push_back(T value)
+	/**
+	 * This method is called once the Unpacker has identified a matching set
+	 * of packets. It unpacks the data, performs a sanity check on it and
+	 * passes it to the delegate.
+	 */
+	void matchedPackets(const SoundplaneADataPacket& p0, const SoundplaneADataPacket& p1)
+	{
+		if (mTrace)
 		{
-			mData[mIdx] = value;
-			mSize = std::min(Capacity, mSize + 1);
-			mIdx = (mIdx + 1) % Capacity;
+			mTrace->mark(kTraceUnpackerMatch);
 		}
-
-		void pop_front()
+		if (mMetrics)
 		{
-			mSize--;
+			mMetrics->framesReceived.add();
 		}
+		SensorFrame& frame = mWorkingFrames[mCurrentWorkingFrame];
+		mCurrentWorkingFrame = 1 - mCurrentWorkingFrame;
+		K1_unpack_frame(p0.packedData, p1.packedData, frame);
+		mGotFrame(frame, p0.seqNum);
+	}
 
-		T &front()
-		{
-			// Add Capacity to ensure that the number that's %Capacity'd
-			// isn't negative.
-			return mData[(mIdx + Capacity - mSize) % Capacity];
-		}
+public:
+	/**
+	 * Called with each frame. The frame stays valid and unchanged until the
+	 * call with the next frame returns, so the callback may keep a pointer to
+	 * it instead of a copy.
+	 */
+	using GotFrameCallback = std::function<void (const SensorFrame& frame, uint16_t seqNum)>;
 
-		bool empty() const
+	/**
+	 * The Unpacker holds the packets of up to window consecutive sequence
+	 * numbers, rounded up to a power of 2, so this is how many frames one
+	 * endpoint can get ahead of the other. Drivers choose it when they open
+	 * a device, from the number of packets in their transfers.
+	 */
+	Unpacker(int window, GotFrameCallback gotFrame) :
+		mGotFrame(std::move(gotFrame))
+	{
+		int size = 1;
+		while (size < std::min(window, kMaxWindow))
 		{
-			return mSize == 0;
+			size *= 2;
 		}
-	private:
-		size_t mSize = 0;
-		size_t mIdx = 0;
-		T mData[Capacity];
-	};
+		mSlots.resize(size);
+		mMask = size - 1;
+	}
 
-	static bool lessThanHandleOverflow(uint16_t a, uint16_t b)
+	/**
+	 * Mark kTraceUnpackerMatch in trace when packets are matched, before the
+	 * frame is passed on. Usually the driver's pending trace, see
+	 * SoundplaneDriver::getPendingTrace().
+	 */
+	void setTrace(FrameTrace* trace)
 	{
-		// This expression is equivalent to a < b, except that it gracefully
-		// handles serial number overflows.
-		return static_cast<uint16_t>(b - a) < (1 << (sizeof(a) * 8 - 1));
+		mTrace = trace;
 	}
 
 	/**
-	 * This method is called once the Unpacker has identified a matching set
-	 * of packets. It unpacks the data, performs a sanity check on it and
-	 * passes it to the delegate.
+	 * Count matched frames and discarded packets in metrics.
 	 */
-	void matchedPackets(SoundplaneADataPacket& p0, SoundplaneADataPacket& p1)
+	void setMetrics(DriverMetrics* metrics)
 	{
-		std::array<float, kSoundplaneOutputFrameLength> workingFrame;
-		K1_unpack_float2(p0.packedData, p1.packedData, workingFrame);
-		K1_clear_edges(workingFrame);
-		mGotFrame(workingFrame);
+		mMetrics = metrics;
 	}
 
-public:
-	using GotFrameCallback = std::function<void (const SoundplaneOutputFrame& frame)>;
-
-	Unpacker(GotFrameCallback gotFrame) :
-		mGotFrame(std::move(gotFrame)) {}
+	/**
+	 * The number of sequence numbers the Unpacker holds packets for.
+	 */
+	int getWindow() const
+	{
+		return static_cast<int>(mSlots.size());
+	}
 
 	/**
-	 * Feed the Unpacker with a number of packets. The Unpacker tolerates packet
-	 * losses, but it does not tolerate packet reordering. If a packet arrives
-	 * too early, all subsequent packets with a lower sequence number are
-	 * dropped.
+	 * Feed the Unpacker with a number of packets from one endpoint. The
+	 * endpoints may run ahead of each other by up to the window: frames are
+	 * passed on in sequence order as soon as both of their packets are in.
 	 *
-	 * Caution: The Unpacker saves the packets pointer. It is expected to stay
-	 * valid for as long as the object is alive, or until
-	 * StoredTransfersPerEndpoint subsequent calls to gotTransfer have been
-	 * made (by that time, Unpacker will forget it).
+	 * Each endpoint's packets are expected in sequence order, so once an
+	 * endpoint has delivered a later packet, a frame still missing that
+	 * endpoint's packet is dropped without waiting for the window to pass
+	 * it. A lost packet therefore holds back no other frames. A frame is
+	 * also dropped when a packet arrives a window or more after it, and a
+	 * packet for a frame that was already passed on or dropped is
+	 * discarded. Each discarded packet is counted in sequenceMismatches.
 	 *
-	 * The expected way to deal with this constraint is for the driver to
-	 * allocate StoredTransfersPerEndpoint extra transfer buffers, so that
-	 * the transfer buffers that the Unpacker works with are never used by the
-	 * USB stack.
+	 * The Unpacker copies the packets it has to hold, so the packets only
+	 * need to stay valid for the duration of the call.
 	 */
-	void gotTransfer(int endpoint, SoundplaneADataPacket* packets, int numPackets)
+	void gotTransfer(int endpoint, const SoundplaneADataPacket* packets, int numPackets)
 	{
-		mTransfers[endpoint].push_back(Transfer(endpoint, packets, numPackets));
-
-		Transfer* ts[2] = { getOldestTransfer(0), getOldestTransfer(1) };
-		while (ts[0] && ts[1])
+		for (int i = 0; i < numPackets; i++)
 		{
-			SoundplaneADataPacket& p0 = ts[0]->currentPacket();
-			SoundplaneADataPacket& p1 = ts[1]->currentPacket();
-			if (p0.seqNum == p1.seqNum)
-			{
-				// The sequence numbers line up
-				matchedPackets(p0, p1);
-				popPacket(&ts[0]);
-				popPacket(&ts[1]);
-			}
-			else
-			{
-				// The oldest packet we have for one endpoint is older than
-				// the oldest for the other. In this case we discard the older
-				// packet.
-				int olderTransferEndpoint = lessThanHandleOverflow(p0.seqNum, p1.seqNum) ? 0 : 1;
-				popPacket(&ts[olderTransferEndpoint]);
-			}
+			gotPacket(endpoint, packets[i]);
 		}
 	}
 
 private:
-	struct Transfer
+	Slot& getSlot(uint16_t seqNum)
+	{
+		return mSlots[seqNum & mMask];
+	}
+
+	void countDiscarded(int packets)
 	{
-		Transfer() = default;
+		if (mMetrics && packets)
+		{
+			mMetrics->sequenceMismatches.add(packets);
+		}
+	}
 
-		Transfer(int endpoint, SoundplaneADataPacket* packets, int numPackets) :
-			mEndpoint(endpoint),
-			mPackets(packets),
-			mNumPackets(numPackets) {}
+	void gotPacket(int endpoint, const SoundplaneADataPacket& packet)
+	{
+		const uint16_t seqNum = packet.seqNum;
+		if (!mStarted)
+		{
+			mNextSeqNum = seqNum;
+			mStarted = true;
+		}
+		if (!mSeen[endpoint] || lessThanHandleOverflow(mNewest[endpoint], seqNum))
+		{
+			mNewest[endpoint] = seqNum;
+			mSeen[endpoint] = true;
+		}
 
-		SoundplaneADataPacket& currentPacket()
+		const uint16_t ahead = seqNum - mNextSeqNum;
+		if (ahead >= kMaxWindow)
+		{
+			// The frame was already passed on or dropped. A long run of
+			// these means the device started counting again, so start over.
+			countDiscarded(1);
+			if (++mLatePackets > Endpoints * mSlots.size())
+			{
+				restart();
+				gotPacket(endpoint, packet);
+			}
+			return;
+		}
+		mLatePackets = 0;
+		if (ahead >= mSlots.size())
 		{
-			return mPackets[mCurrentPacketIndex];
+			expireUntil(seqNum - mMask);
 		}
 
-		/**
-		 * Returns true if there are no packets left after the pop.
-		 */
-		bool popCurrentPacket()
+		Slot& slot = getSlot(seqNum);
+		if (slot.full[endpoint])
 		{
-			mCurrentPacketIndex++;
-			return mCurrentPacketIndex == mNumPackets;
+			// A repeated sequence number from the same endpoint.
+			countDiscarded(1);
+			return;
 		}
 
-		int endpoint() const
+		const int other = 1 - endpoint;
+		if ((seqNum == mNextSeqNum) && slot.full[other])
 		{
-			return mEndpoint;
+			// The common case: the other endpoint's packet is waiting, and no
+			// earlier frame is, so pass the frame on without copying.
+			if (endpoint == 0)
+			{
+				matchedPackets(packet, slot.packets[1]);
+			}
+			else
+			{
+				matchedPackets(slot.packets[0], packet);
+			}
+			slot.full[other] = false;
+			mNextSeqNum++;
 		}
-	private:
-		int mEndpoint;
-		/**
-		 * Index to the first packet that has not yet been processed.
-		 */
-		int mCurrentPacketIndex = 0;
-		SoundplaneADataPacket* mPackets = nullptr;
-		int mNumPackets = 0;
-	};
+		else
+		{
+			slot.packets[endpoint] = packet;
+			slot.full[endpoint] = true;
+		}
+		advance();
+	}
 
 	/**
-	 * May return nullptr
+	 * Pass on complete frames from mNextSeqNum, and drop the incomplete
+	 * frames that can no longer complete, until a frame that still can.
 	 */
-	Transfer* getOldestTransfer(int endpoint)
+	void advance()
 	{
-		if (mTransfers[endpoint].empty())
+		for (;;)
 		{
-			return nullptr;
+			Slot& slot = getSlot(mNextSeqNum);
+			if (slot.full[0] && slot.full[1])
+			{
+				matchedPackets(slot.packets[0], slot.packets[1]);
+			}
+			else if (isLost(slot))
+			{
+				countDiscarded(slot.full[0] + slot.full[1]);
+			}
+			else
+			{
+				return;
+			}
+			slot.full = {};
+			mNextSeqNum++;
 		}
-		return &mTransfers[endpoint].front();
 	}
 
 	/**
-	 * If popping the packet pops the last packet in the Transfer, it will
-	 * be updated to the next one (or nullptr).
+	 * Pass on or drop every frame before seqNum, to make room for a packet
+	 * a window or more ahead of mNextSeqNum.
 	 */
-	void popPacket(Transfer **transfer)
+	void expireUntil(uint16_t seqNum)
 	{
-        int endpoint = (*transfer)->endpoint();
-		if ((*transfer)->popCurrentPacket())
+		const int frames = std::min<int>(static_cast<uint16_t>(seqNum - mNextSeqNum), mSlots.size());
+		for (int i = 0; i < frames; i++)
 		{
-			mTransfers[endpoint].pop_front();
-			*transfer = getOldestTransfer(endpoint);
+			Slot& slot = getSlot(mNextSeqNum + i);
+			if (slot.full[0] && slot.full[1])
+			{
+				matchedPackets(slot.packets[0], slot.packets[1]);
+			}
+			else
+			{
+				countDiscarded(slot.full[0] + slot.full[1]);
+			}
+			slot.full = {};
 		}
+		mNextSeqNum = seqNum;
 	}
 
-	RingBuffer<Transfer, StoredTransfersPerEndpoint> mTransfers[Endpoints];
+	/**
+	 * Drop all held packets, and take the next packet as the first.
+	 */
+	void restart()
+	{
+		for (Slot& slot : mSlots)
+		{
+			countDiscarded(slot.full[0] + slot.full[1]);
+			slot.full = {};
+		}
+		mStarted = false;
+		mSeen = {};
+		mLatePackets = 0;
+	}
+
+	/**
+	 * True if every endpoint missing from the frame at mNextSeqNum has
+	 * since delivered a later packet.
+	 */
+	bool isLost(const Slot& slot) const
+	{
+		for (int e = 0; e < Endpoints; e++)
+		{
+			if (!slot.full[e] && !(mSeen[e] && lessThanHandleOverflow(mNextSeqNum, mNewest[e])))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::vector<Slot> mSlots;
+	uint16_t mMask = 0;
+	uint16_t mNextSeqNum = 0;
+	bool mStarted = false;
+	size_t mLatePackets = 0;
+	std::array<bool, Endpoints> mSeen{};
+	std::array<uint16_t, Endpoints> mNewest{};
 	const GotFrameCallback mGotFrame;
+	FrameTrace* mTrace = nullptr;
+	DriverMetrics* mMetrics = nullptr;
+
+	// the current and previous frames swap places each frame instead of being copied.
+	std::array<SensorFrame, 2> mWorkingFrames{};
+	int mCurrentWorkingFrame = 0;
 };
 
 #endif // __UNPACKER__
@@ -0,0 +1,87 @@
+// Driver for Soundplane Model A.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "WakeupEvent.h"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+using namespace std::chrono;
+
+// The waiting thread sets mWaiting before it checks mPending for the last time, and
+// notify() increments mPending before it checks mWaiting. Both are sequentially
+// consistent, so either the waiter sees the notification or notify() sees the waiter.
+
+#ifdef __linux__
+
+namespace
+{
+	int* futexAddress(std::atomic<int>& a)
+	{
+		return reinterpret_cast<int*>(&a);
+	}
+}
+
+void WakeupEvent::notify()
+{
+	// only the notification that makes mPending nonzero needs to wake the waiter.
+	if((mPending.fetch_add(1) == 0) && mWaiting.load())
+	{
+		syscall(SYS_futex, futexAddress(mPending), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+	}
+}
+
+int WakeupEvent::waitUntil(steady_clock::time_point deadline)
+{
+	int n = mPending.exchange(0);
+	if(n) return n;
+
+	mWaiting.store(true);
+	while(!(n = mPending.exchange(0)))
+	{
+		const auto remaining = deadline - steady_clock::now();
+		if(remaining <= steady_clock::duration::zero()) break;
+
+		const long long ns = duration_cast<nanoseconds>(remaining).count();
+		struct timespec timeout;
+		timeout.tv_sec = ns / 1000000000;
+		timeout.tv_nsec = ns % 1000000000;
+
+		// sleeps only if mPending is still 0. Spurious wakeups and EINTR just go around the loop.
+		syscall(SYS_futex, futexAddress(mPending), FUTEX_WAIT_PRIVATE, 0, &timeout, nullptr, 0);
+	}
+	mWaiting.store(false);
+	return n;
+}
+
+#else
+
+void WakeupEvent::notify()
+{
+	mPending.fetch_add(1);
+	if(mWaiting.load())
+	{
+		// taking the lock makes sure the waiter is either asleep or has not yet checked mPending.
+		std::lock_guard<std::mutex> lock(mMutex);
+		mCondition.notify_one();
+	}
+}
+
+int WakeupEvent::waitUntil(steady_clock::time_point deadline)
+{
+	int n = mPending.exchange(0);
+	if(n) return n;
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mWaiting.store(true);
+	mCondition.wait_until(lock, deadline, [&]{ return mPending.load() != 0; });
+	mWaiting.store(false);
+	return mPending.exchange(0);
+}
+
+#endif
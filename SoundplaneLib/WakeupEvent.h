@@ -0,0 +1,56 @@
+// Driver for Soundplane Model A.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#ifndef __WAKEUP_EVENT__
+#define __WAKEUP_EVENT__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+/**
+ * Lets one thread sleep until another thread has work for it, for example
+ * until the driver has pushed a new frame. Notifications are counted, so a
+ * notify() that happens while the waiting thread is busy is not lost.
+ *
+ * notify() does not make a system call or take a lock unless the waiting
+ * thread is actually asleep, so it is cheap enough to call from a driver
+ * callback for every frame. On Linux the waiting thread sleeps on a futex,
+ * elsewhere on a condition variable.
+ *
+ * Only one thread may wait at a time.
+ */
+class WakeupEvent
+{
+public:
+	WakeupEvent() = default;
+
+	WakeupEvent(const WakeupEvent &) = delete;
+	WakeupEvent &operator=(const WakeupEvent &) = delete;
+
+	/**
+	 * Wake the waiting thread, or make its next wait return immediately.
+	 * May be called from any thread.
+	 */
+	void notify();
+
+	/**
+	 * Sleep until notify() has been called or the deadline has passed. Returns
+	 * the number of notifications since the last wait, which is 0 if the
+	 * deadline passed first.
+	 */
+	int waitUntil(std::chrono::steady_clock::time_point deadline);
+
+private:
+	std::atomic<int> mPending{0};
+	std::atomic<bool> mWaiting{false};
+
+#ifndef __linux__
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+#endif
+};
+
+#endif // __WAKEUP_EVENT__
@@ -0,0 +1,610 @@
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// The Soundplane client without a user interface: reads touches from the device, or from
+// a simulated device or a capture file, and sends them to the zones and the OSC and MIDI
+// outputs as the app does. Configured by a JSON file and command-line flags. See
+// printUsage() for both.
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SoundplaneModel.h"
+#include "SimulatedSoundplaneDriver.h"
+#include "ReplaySoundplaneDriver.h"
+#include "ThreadUtility.h"
+
+#if SP_USE_LIBUSB
+#include "LibusbSoundplaneDriver.h"
+#endif
+
+namespace
+{
+
+volatile std::sig_atomic_t gQuit = 0;
+
+void handleSignal(int)
+{
+	gQuit = 1;
+}
+
+// a model property to set at startup.
+struct DaemonProperty
+{
+	std::string name;
+	bool isText;
+	float number;
+	std::string text;
+};
+
+struct DaemonConfig
+{
+	// "usb", "simulated" or "replay".
+	std::string driver{"usb"};
+
+	// for the replay driver.
+	std::string replayFile;
+	ReplayConfig replay;
+
+	// for the simulated driver.
+	int simulatedTouches{2};
+	SimulatedSoundplaneConfig simulated;
+
+	// if not empty, everything the device sends is recorded to this file.
+	std::string captureFile;
+
+	// if not empty, the latency of each frame is traced and written to this file in the
+	// Chrome trace event format.
+	std::string traceFile;
+
+	// if true, the latency of each frame is traced and summarized when we stop.
+	bool traceSummary{false};
+
+	// scheduling of the driver and process threads.
+	RealtimeOptions realtime;
+
+#if SP_USE_LIBUSB
+	// the depth of the USB driver's transfer queue.
+	LibusbTransferConfig usb;
+#endif
+
+	std::vector<DaemonProperty> properties;
+	bool verbose{false};
+};
+
+void printUsage()
+{
+	std::cerr <<
+		"usage: soundplaned [options]\n"
+		"  --config FILE         read settings from a JSON file. Flags override it.\n"
+		"  --driver NAME         usb (default), simulated or replay\n"
+		"  --replay FILE         capture file to replay, implies --driver replay\n"
+		"  --replay-mode MODE    realtime (default), accelerated or fast\n"
+		"  --speed X             speed for accelerated replays\n"
+		"  --loop                replay the capture file over and over\n"
+		"  --touches N           number of simulated touches\n"
+		"  --frames N            stop the simulated device after N frames\n"
+		"  --capture FILE        record everything the device sends to FILE\n"
+		"  --trace FILE          trace the latency of each frame and write a Chrome trace to FILE\n"
+		"  --trace-summary       trace the latency of each frame and print percentiles when stopped\n"
+		"  --set NAME=VALUE      set a model property, such as osc_active=1 or zone_preset=chromatic\n"
+		"  --rt-policy NAME      fifo (default), rr or other for the driver and process threads\n"
+		"  --rt-priority N       real-time priority of the driver thread, 70 by default\n"
+		"  --driver-cpu N        pin the driver thread to CPU N\n"
+		"  --process-cpu N       pin the process thread to CPU N\n"
+		"  --lock-memory         lock the process's memory so it is never paged out\n"
+#if SP_USE_LIBUSB
+		"  --usb-packets N       isochronous packets per USB transfer, 1-64, 8 by default\n"
+		"  --usb-in-flight N     USB transfers in flight on each endpoint, 1-32, 4 by default\n"
+		"  --usb-multiplier N    USB transfers allocated per transfer in flight, 2-8, 2 by default\n"
+#endif
+		"  --verbose             print status while running\n"
+		"\n"
+		"The config file is an object with the keys \"driver\", \"capture\", \"trace\",\n"
+		"\"trace_summary\", \"verbose\", \"replay\" {\"file\", \"mode\", \"speed\", \"loop\"},\n"
+		"\"simulated\" {\"touches\", \"frames\", \"noise\", \"real_time\"}, \"realtime\"\n"
+		"{\"policy\", \"priority\", \"driver_cpu\", \"process_cpu\", \"lock_memory\"}, \"usb\"\n"
+		"{\"packets_per_transfer\", \"in_flight\", \"in_flight_multiplier\"} and \"properties\"\n"
+		"{NAME: VALUE, ...}. A \"zone_JSON\" property can be given as an object.\n";
+}
+
+void setProperty(DaemonConfig& config, const std::string& name, float number)
+{
+	config.properties.push_back(DaemonProperty{name, false, number, std::string()});
+}
+
+void setProperty(DaemonConfig& config, const std::string& name, const std::string& text)
+{
+	config.properties.push_back(DaemonProperty{name, true, 0.f, text});
+}
+
+// parse NAME=VALUE, where a VALUE that is a number sets a float property and anything else
+// sets a text property.
+bool parsePropertyFlag(DaemonConfig& config, const std::string& flag)
+{
+	const size_t equals = flag.find('=');
+	if((equals == std::string::npos) || (equals == 0)) return false;
+	const std::string name = flag.substr(0, equals);
+	const std::string value = flag.substr(equals + 1);
+
+	char* end = nullptr;
+	const float number = std::strtof(value.c_str(), &end);
+	if(!value.empty() && (*end == 0))
+	{
+		setProperty(config, name, number);
+	}
+	else
+	{
+		setProperty(config, name, value);
+	}
+	return true;
+}
+
+bool parseReplayMode(const std::string& mode, ReplayMode& result)
+{
+	if(mode == "realtime") result = ReplayMode::kRealTime;
+	else if(mode == "accelerated") result = ReplayMode::kAccelerated;
+	else if(mode == "fast") result = ReplayMode::kAsFastAsPossible;
+	else return false;
+	return true;
+}
+
+bool parseRealtimePolicy(const std::string& name, int& result)
+{
+	if(name == "fifo") result = SCHED_FIFO;
+	else if(name == "rr") result = SCHED_RR;
+	else if(name == "other") result = SCHED_OTHER;
+	else return false;
+	return true;
+}
+
+bool loadConfigFile(DaemonConfig& config, const std::string& path)
+{
+	std::ifstream file(path);
+	if(!file)
+	{
+		std::cerr << "soundplaned: couldn't read config file " << path << "\n";
+		return false;
+	}
+	std::stringstream contents;
+	contents << file.rdbuf();
+
+	cJSON* root = cJSON_Parse(contents.str().c_str());
+	if(!root || (root->type != cJSON_Object))
+	{
+		std::cerr << "soundplaned: " << path << " is not a JSON object\n";
+		cJSON_Delete(root);
+		return false;
+	}
+
+	bool ok = true;
+	for(cJSON* item = root->child; item; item = item->next)
+	{
+		const std::string key(item->string);
+		if((key == "driver") && (item->type == cJSON_String))
+		{
+			config.driver = item->valuestring;
+		}
+		else if((key == "capture") && (item->type == cJSON_String))
+		{
+			config.captureFile = item->valuestring;
+		}
+		else if((key == "trace") && (item->type == cJSON_String))
+		{
+			config.traceFile = item->valuestring;
+		}
+		else if(key == "trace_summary")
+		{
+			config.traceSummary = (item->type == cJSON_True);
+		}
+		else if(key == "verbose")
+		{
+			config.verbose = (item->type == cJSON_True);
+		}
+		else if((key == "replay") && (item->type == cJSON_Object))
+		{
+			for(cJSON* r = item->child; r; r = r->next)
+			{
+				const std::string rKey(r->string);
+				if((rKey == "file") && (r->type == cJSON_String)) config.replayFile = r->valuestring;
+				else if((rKey == "mode") && (r->type == cJSON_String)) ok &= parseReplayMode(r->valuestring, config.replay.mode);
+				else if((rKey == "speed") && (r->type == cJSON_Number)) config.replay.speed = r->valuedouble;
+				else if(rKey == "loop") config.replay.loop = (r->type == cJSON_True);
+			}
+		}
+		else if((key == "simulated") && (item->type == cJSON_Object))
+		{
+			for(cJSON* s = item->child; s; s = s->next)
+			{
+				const std::string sKey(s->string);
+				if((sKey == "touches") && (s->type == cJSON_Number)) config.simulatedTouches = s->valueint;
+				else if((sKey == "frames") && (s->type == cJSON_Number)) config.simulated.frames = s->valuedouble;
+				else if((sKey == "noise") && (s->type == cJSON_Number)) config.simulated.noise = s->valuedouble;
+				else if(sKey == "real_time") config.simulated.realTime = (s->type == cJSON_True);
+			}
+		}
+		else if((key == "realtime") && (item->type == cJSON_Object))
+		{
+			for(cJSON* r = item->child; r; r = r->next)
+			{
+				const std::string rKey(r->string);
+				if((rKey == "policy") && (r->type == cJSON_String)) ok &= parseRealtimePolicy(r->valuestring, config.realtime.policy);
+				else if((rKey == "priority") && (r->type == cJSON_Number)) config.realtime.priority = r->valueint;
+				else if((rKey == "driver_cpu") && (r->type == cJSON_Number)) config.realtime.driverCPU = r->valueint;
+				else if((rKey == "process_cpu") && (r->type == cJSON_Number)) config.realtime.processCPU = r->valueint;
+				else if(rKey == "lock_memory") config.realtime.lockMemory = (r->type == cJSON_True);
+			}
+		}
+#if SP_USE_LIBUSB
+		else if((key == "usb") && (item->type == cJSON_Object))
+		{
+			for(cJSON* u = item->child; u; u = u->next)
+			{
+				const std::string uKey(u->string);
+				if(u->type != cJSON_Number) continue;
+				if(uKey == "packets_per_transfer") config.usb.packetsPerTransfer = u->valueint;
+				else if(uKey == "in_flight") config.usb.buffersInFlight = u->valueint;
+				else if(uKey == "in_flight_multiplier") config.usb.inFlightMultiplier = u->valueint;
+			}
+		}
+#endif
+		else if((key == "properties") && (item->type == cJSON_Object))
+		{
+			for(cJSON* p = item->child; p; p = p->next)
+			{
+				switch(p->type)
+				{
+					case cJSON_Number:
+						setProperty(config, p->string, static_cast<float>(p->valuedouble));
+						break;
+					case cJSON_True:
+					case cJSON_False:
+						setProperty(config, p->string, (p->type == cJSON_True) ? 1.f : 0.f);
+						break;
+					case cJSON_String:
+						setProperty(config, p->string, std::string(p->valuestring));
+						break;
+					case cJSON_Object:
+					case cJSON_Array:
+					{
+						// zone maps and other JSON-valued properties are set as text.
+						char* text = cJSON_PrintUnformatted(p);
+						setProperty(config, p->string, std::string(text));
+						free(text);
+					}
+						break;
+					default:
+						break;
+				}
+			}
+		}
+		else
+		{
+			std::cerr << "soundplaned: ignoring unknown config key " << key << "\n";
+		}
+	}
+	cJSON_Delete(root);
+
+	if(!ok)
+	{
+		std::cerr << "soundplaned: bad replay mode or real-time policy in " << path << "\n";
+	}
+	return ok;
+}
+
+bool parseArgs(DaemonConfig& config, int argc, const char* argv[])
+{
+	// read the config file first, so the other flags override it.
+	for(int i=1; i<argc - 1; ++i)
+	{
+		if(std::string(argv[i]) == "--config")
+		{
+			if(!loadConfigFile(config, argv[i + 1])) return false;
+		}
+	}
+
+	for(int i=1; i<argc; ++i)
+	{
+		const std::string arg(argv[i]);
+		const bool hasValue = (i + 1 < argc);
+		if((arg == "--config") && hasValue)
+		{
+			++i;
+		}
+		else if((arg == "--driver") && hasValue)
+		{
+			config.driver = argv[++i];
+		}
+		else if((arg == "--replay") && hasValue)
+		{
+			config.driver = "replay";
+			config.replayFile = argv[++i];
+		}
+		else if((arg == "--replay-mode") && hasValue)
+		{
+			if(!parseReplayMode(argv[++i], config.replay.mode)) return false;
+		}
+		else if((arg == "--speed") && hasValue)
+		{
+			config.replay.speed = std::strtof(argv[++i], nullptr);
+		}
+		else if(arg == "--loop")
+		{
+			config.replay.loop = true;
+		}
+		else if((arg == "--touches") && hasValue)
+		{
+			config.simulatedTouches = std::atoi(argv[++i]);
+		}
+		else if((arg == "--frames") && hasValue)
+		{
+			config.simulated.frames = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if((arg == "--capture") && hasValue)
+		{
+			config.captureFile = argv[++i];
+		}
+		else if((arg == "--trace") && hasValue)
+		{
+			config.traceFile = argv[++i];
+		}
+		else if(arg == "--trace-summary")
+		{
+			config.traceSummary = true;
+		}
+		else if((arg == "--set") && hasValue)
+		{
+			if(!parsePropertyFlag(config, argv[++i])) return false;
+		}
+		else if((arg == "--rt-policy") && hasValue)
+		{
+			if(!parseRealtimePolicy(argv[++i], config.realtime.policy)) return false;
+		}
+		else if((arg == "--rt-priority") && hasValue)
+		{
+			config.realtime.priority = std::atoi(argv[++i]);
+		}
+		else if((arg == "--driver-cpu") && hasValue)
+		{
+			config.realtime.driverCPU = std::atoi(argv[++i]);
+		}
+		else if((arg == "--process-cpu") && hasValue)
+		{
+			config.realtime.processCPU = std::atoi(argv[++i]);
+		}
+		else if(arg == "--lock-memory")
+		{
+			config.realtime.lockMemory = true;
+		}
+#if SP_USE_LIBUSB
+		else if((arg == "--usb-packets") && hasValue)
+		{
+			config.usb.packetsPerTransfer = std::atoi(argv[++i]);
+		}
+		else if((arg == "--usb-in-flight") && hasValue)
+		{
+			config.usb.buffersInFlight = std::atoi(argv[++i]);
+		}
+		else if((arg == "--usb-multiplier") && hasValue)
+		{
+			config.usb.inFlightMultiplier = std::atoi(argv[++i]);
+		}
+#endif
+		else if(arg == "--verbose")
+		{
+			config.verbose = true;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	if((config.driver != "usb") && (config.driver != "simulated") && (config.driver != "replay"))
+	{
+		std::cerr << "soundplaned: unknown driver " << config.driver << "\n";
+		return false;
+	}
+	if((config.driver == "replay") && config.replayFile.empty())
+	{
+		std::cerr << "soundplaned: no capture file to replay\n";
+		return false;
+	}
+#if SP_USE_LIBUSB
+	if(!config.usb.isValid())
+	{
+		std::cerr << "soundplaned: USB transfer settings out of range\n";
+		return false;
+	}
+#endif
+	return true;
+}
+
+// spread the simulated touches across the surface, moving at different rates.
+void makeSimulatedTouches(DaemonConfig& config)
+{
+	const int n = std::max(config.simulatedTouches, 0);
+	config.simulated.touches.clear();
+	for(int i=0; i<n; ++i)
+	{
+		SimulatedTouch t;
+		t.x0 = 4.f + (56.f*i)/std::max(n, 1);
+		t.x1 = t.x0 + 8.f;
+		t.y0 = 1.5f + (i % 5);
+		t.y1 = 6.f - (i % 5);
+		t.movePeriod = 1.f + 0.37f*i;
+		t.pressurePeriod = 0.5f + 0.21f*i;
+		t.phase = 0.13f*i;
+		config.simulated.touches.push_back(t);
+	}
+}
+
+// passes driver events on to the model, noting when the driver closes.
+class ClosingListener : public SoundplaneDriverListener
+{
+public:
+	void onStartup() override { mpModel->onStartup(); }
+	void onFrameReady() override { mpModel->onFrameReady(); }
+	void onError(int err, const char* errStr) override { mpModel->onError(err, errStr); }
+	void onClose() override
+	{
+		mpModel->onClose();
+		mClosed.store(true, std::memory_order_release);
+	}
+
+	SoundplaneDriverListener* mpModel{nullptr};
+	std::atomic<bool> mClosed{false};
+};
+
+}
+
+int main(int argc, const char* argv[])
+{
+	DaemonConfig config;
+	if(!parseArgs(config, argc, argv))
+	{
+		printUsage();
+		return 1;
+	}
+	makeSimulatedTouches(config);
+
+	std::signal(SIGINT, handleSignal);
+	std::signal(SIGTERM, handleSignal);
+	setRealtimeOptions(config.realtime);
+
+	// the simulated and replay drivers stop when they are done, and so do we. The USB driver
+	// keeps looking for a device until we are stopped.
+	ClosingListener listener;
+	ReplaySoundplaneDriver* pReplayDriver = nullptr;
+	SoundplaneModel::DriverFactory makeDriver = SoundplaneDriver::create;
+#if SP_USE_LIBUSB
+	if(config.driver == "usb")
+	{
+		makeDriver = [&](SoundplaneDriverListener& model)
+		{
+			return std::unique_ptr<SoundplaneDriver>(new LibusbSoundplaneDriver(model, config.usb));
+		};
+	}
+#endif
+	if(config.driver == "simulated")
+	{
+		makeDriver = [&](SoundplaneDriverListener& model)
+		{
+			listener.mpModel = &model;
+			return std::unique_ptr<SoundplaneDriver>(new SimulatedSoundplaneDriver(listener, config.simulated));
+		};
+	}
+	else if(config.driver == "replay")
+	{
+		makeDriver = [&](SoundplaneDriverListener& model)
+		{
+			listener.mpModel = &model;
+			pReplayDriver = new ReplaySoundplaneDriver(listener, config.replayFile, config.replay);
+			return std::unique_ptr<SoundplaneDriver>(pReplayDriver);
+		};
+	}
+
+	// fast replays run the driver and the model in turn on this thread.
+	const bool stepping = (config.driver == "replay") && (config.replay.mode == ReplayMode::kAsFastAsPossible);
+
+	MLConsole() << "soundplaned: starting with " << config.driver << " driver\n";
+	SoundplaneModel model(makeDriver, !stepping);
+	if(pReplayDriver && !pReplayDriver->isOpen())
+	{
+		std::cerr << "soundplaned: couldn't read capture file " << config.replayFile << "\n";
+		return 1;
+	}
+
+	for(const DaemonProperty& p : config.properties)
+	{
+		if(p.isText)
+		{
+			model.setProperty(ml::Symbol(p.name.c_str()), p.text.c_str());
+		}
+		else
+		{
+			model.setProperty(ml::Symbol(p.name.c_str()), p.number);
+		}
+	}
+	model.updateAllProperties();
+
+	if(!config.captureFile.empty() && !model.startCapture(config.captureFile))
+	{
+		return 1;
+	}
+
+	// collect frame traces from the model as we go, so that its ring doesn't fill.
+	const bool tracing = !config.traceFile.empty() || config.traceSummary;
+	LatencyTraceLog traceLog;
+	auto collectTraces = [&]()
+	{
+		model.getLatencyTrace().drain([&](const FrameTrace& t) { traceLog.add(t); });
+	};
+	LatencyTrace::setEnabled(tracing);
+
+	if(stepping)
+	{
+		while(!gQuit && pReplayDriver->step())
+		{
+			model.processFrames();
+			if(tracing)
+			{
+				collectTraces();
+			}
+		}
+	}
+	else
+	{
+		const bool finite = (config.driver != "usb");
+		int ticks = 0;
+		while(!gQuit && !(finite && listener.mClosed.load(std::memory_order_acquire)))
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			if(tracing)
+			{
+				collectTraces();
+			}
+			if(config.verbose && (++ticks % 50 == 0))
+			{
+				MLConsole() << "soundplaned: " << model.getHardwareStr() << ", " << model.getStatusStr() << "\n";
+			}
+		}
+	}
+
+	model.stopCapture();
+
+	if(tracing)
+	{
+		LatencyTrace::setEnabled(false);
+		collectTraces();
+		if(model.getLatencyTrace().getDroppedCount())
+		{
+			std::cerr << "soundplaned: " << model.getLatencyTrace().getDroppedCount() << " frame traces dropped\n";
+		}
+		if(config.traceSummary)
+		{
+			traceLog.writeSummary(std::cout);
+		}
+		if(!config.traceFile.empty())
+		{
+			std::ofstream traceStream(config.traceFile);
+			traceLog.writeChromeTrace(traceStream);
+			if(!traceStream)
+			{
+				std::cerr << "soundplaned: couldn't write trace file " << config.traceFile << "\n";
+			}
+		}
+	}
+
+	MLConsole() << "soundplaned: stopped.\n";
+	return 0;
+}
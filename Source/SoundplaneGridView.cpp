@@ -200,10 +200,9 @@ void SoundplaneGridView::setModel(SoundplaneModel* m)
 void SoundplaneGridView::renderXYGrid()
 {
 	float viewScale = mpModel->getFloatProperty("display_scale");
-	MLSignal calSignal = mpModel->getSmoothedSignal();
+	const SensorFrame& smoothed = mpModel->getSmoothedSnapshot();
 	
-	if((calSignal.getHeight() != mSensorHeight) || (calSignal.getWidth() != mSensorWidth)) return;
-	calSignal.scale(0.25f);
+	if((SensorGeometry::height != mSensorHeight) || (SensorGeometry::width != mSensorWidth)) return;
 	
 	setupOrthoView();
 
@@ -226,7 +225,7 @@ void SoundplaneGridView::renderXYGrid()
 		// Soundplane A-specific
 		for(int i=mLeftSensor; i<mRightSensor; ++i)
 		{
-			float mix = (calSignal)(i, j)*viewScale*20.f;
+			float mix = get(smoothed, i, j)*0.25f*viewScale*20.f;
 			mix *= displayScale * 0.5f;
 			mix = ml::clamp(mix, 0.f, 1.f);
 			Vec4 dataColor = vlerp(gray, lightGray, mix);
@@ -255,19 +254,19 @@ void SoundplaneGridView::renderXYGrid()
 	// render current touch dots
 	//
 	const int nt = mpModel->getFloatProperty("max_touches");
-	const MLSignal& touches = mpModel->getTouchFrame();
+	const TouchArray& touches = mpModel->getTouchSnapshot();
 	for(int t=0; t<nt; ++t)
 	{
-		int age = touches(ageColumn, t);
+		int age = touches[t].age;
 		if (age > 0)
 		{
-			float x = touches(xColumn, t);
-			float y = touches(yColumn, t);
+			float x = touches[t].x;
+			float y = touches[t].y;
 			
 			Vec2 gridPos(x, y);
 			float tx = mKeyRangeX.convert(gridPos.x());
 			float ty = mKeyRangeY.convert(gridPos.y());
-			float tz = touches(zColumn, t);
+			float tz = touches[t].z;
 			
 			Vec4 dataColor(MLGL::getIndicatorColor(t));
 			dataColor[3] = 0.75;
@@ -406,22 +405,18 @@ void SoundplaneGridView::renderZGrid()
 	ySensorRange.convertTo(MLRange(-sh, sh));
 	
 	const ml::Text viewMode = getTextProperty("viewmode");
-	MLSignal viewSignal;
-	if(viewMode == "raw data")
-	{
-		viewSignal = mpModel->getRawSignal();
-	}
-	else
-	{
-		viewSignal = mpModel->getCalibratedSignal();
-		viewSignal.scale(0.05f);
-	}
+	const bool raw = (viewMode == "raw data");
+	const SensorFrame& viewFrame = raw ? mpModel->getRawSnapshot() : mpModel->getCalibratedSnapshot();
 
-	// should be one compare for Vec2 signal dims
-	if((viewSignal.getHeight() != mSensorHeight) || (viewSignal.getWidth() != mSensorWidth)) return;
+	if((SensorGeometry::height != mSensorHeight) || (SensorGeometry::width != mSensorWidth)) return;
 	
 	float displayScale = mpModel->getFloatProperty("display_scale");
 	float gridScale = displayScale * 100.f;
+	if(!raw)
+	{
+		// calibrated values are much larger than raw ones.
+		gridScale *= 0.05f;
+	}
 	
 	float preOffset = 0.f;
 	bool separateSurfaces = false;
@@ -465,7 +460,7 @@ void SoundplaneGridView::renderZGrid()
 			{
 				float x = xSensorRange.convert(i);
 				float y = ySensorRange.convert(j);
-				float z = viewSignal(i, j);
+				float z = get(viewFrame, i, j);
 				if(zeroClip) { z = ml::max(z, 0.f); }
 				float zMean = (z + preOffset)*gridScale;
 				glVertex3f(x, y, -zMean);
@@ -480,14 +475,14 @@ void SoundplaneGridView::renderZGrid()
 				{
 					float x1 = xSensorRange.convert(i);
 					float y1 = ySensorRange.convert(j);
-					float z = viewSignal(i, j);
+					float z = get(viewFrame, i, j);
 					if(zeroClip) { z = ml::max(z, 0.f); }
 					float z1 = (z + preOffset)*gridScale;
 					glVertex3f(x1, y1, -z1);
 					
 					float x2 = xSensorRange.convert(i + 1);
 					float y2 = ySensorRange.convert(j);
-					z = viewSignal(i + 1, j);
+					z = get(viewFrame, i + 1, j);
 					if(zeroClip) { z = ml::max(z, 0.f); }
 					float z2 = (z + preOffset)*gridScale;
 					glVertex3f(x2, y2, -z2);
@@ -511,7 +506,7 @@ void SoundplaneGridView::renderZGrid()
 			{
 				float x = xSensorRange.convert(i);
 				float y = ySensorRange.convert(j);
-				float z0 = viewSignal(i, j);
+				float z0 = get(viewFrame, i, j);
 				if(zeroClip) { z0 = ml::max(z0, 0.f); }
 				float z = (z0 + preOffset)*gridScale;
 				glVertex3f(x, y, -z);
@@ -526,7 +521,7 @@ void SoundplaneGridView::renderZGrid()
 			{
 				float x = xSensorRange.convert(i);
 				float y = ySensorRange.convert(j);
-				float z0 = viewSignal(i, j);
+				float z0 = get(viewFrame, i, j);
 				if(zeroClip) { z0 = ml::max(z0, 0.f); }
 				float z = (z0 + preOffset)*gridScale;
 				glVertex3f(x, y, -z);
@@ -595,7 +590,7 @@ void SoundplaneGridView::renderOpenGL()
 	}
 	else if (viewMode == "touches")
 	{
-		renderTouches(mpModel->getTouchArray());
+		renderTouches(mpModel->getTouchSnapshot());
 		drawSurfaceOverlay();
 	}
 	else // raw, calibrated or smoothed
@@ -6,6 +6,8 @@
 #include "MLDebug.h"
 #include "SoundplaneMIDIOutput.h"
 
+#include <algorithm>
+
 const std::string kSoundplaneMIDIDeviceName("Soundplane IAC out");
 
 const int kMPE_MIDI_CC = 127;
@@ -156,6 +158,7 @@ void SoundplaneMIDIOutput::setDevice(int deviceIdx)
 	{
 		delete mpCurrentDevice;
 		mpCurrentDevice = 0;
+		mDeviceThreadStarted = false;
 	}
 
 	if(deviceIdx < mDevices.size())
@@ -172,6 +175,7 @@ void SoundplaneMIDIOutput::setDevice(const std::string& deviceStr)
 	{
 		delete mpCurrentDevice;
 		mpCurrentDevice = 0;
+		mDeviceThreadStarted = false;
 	}
 	
 	for(int i=0; i<mDevices.size(); ++i)
@@ -205,18 +209,57 @@ void SoundplaneMIDIOutput::setActive(bool v)
 	mActive = v; 
 }
 
+void SoundplaneMIDIOutput::sendMessage(const juce::MidiMessage& m)
+{
+	mpCurrentDevice->sendMessageNow(m);
+	mMessagesSent.add();
+}
+
+// send a message made for the current frame. When dejittering, hold it until
+// endOutputFrame() schedules the frame. Messages from anywhere else, such as the
+// property changes, go out right away through sendMessage().
+void SoundplaneMIDIOutput::sendFrameMessage(const juce::MidiMessage& m)
+{
+	if(mFrameDejitterMillis > 0.f)
+	{
+		mFrameMessages.addEvent(m, 0);
+		mMessagesSent.add();
+	}
+	else
+	{
+		sendMessage(m);
+	}
+}
+
+// send the messages held for the current frame at the frame's time plus the dejitter delay,
+// or right away if that time has passed. The device's background thread does the sending.
+void SoundplaneMIDIOutput::sendFrameMessages()
+{
+	if(mFrameMessages.isEmpty()) return;
+	if(!mDeviceThreadStarted)
+	{
+		mpCurrentDevice->startBackgroundThread();
+		mDeviceThreadStarted = true;
+	}
+	
+	const double delayMillis = duration<double, std::milli>(mFrameTime - system_clock::now()).count() + mFrameDejitterMillis;
+	const double startMillis = juce::Time::getMillisecondCounterHiRes() + std::max(delayMillis, 0.);
+	mpCurrentDevice->sendBlockOfMessages(mFrameMessages, startMillis, 1000.);
+	mFrameMessages.clear();
+}
+
 void SoundplaneMIDIOutput::sendMIDIChannelPressure(int chan, int p) 
 {
 	if(!mMPEExtended)
 	{
 		// normal MPE: send pressure as channel pressure
-		mpCurrentDevice->sendMessageNow(juce::MidiMessage::channelPressureChange(chan, p));
+		sendMessage(juce::MidiMessage::channelPressureChange(chan, p));
 	}
 	else
 	{
 		// multi channel, extensions
-		if(mPressureActive) mpCurrentDevice->sendMessageNow(juce::MidiMessage::channelPressureChange(chan, p));
-		mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(chan, 11, p));
+		if(mPressureActive) sendMessage(juce::MidiMessage::channelPressureChange(chan, p));
+		sendMessage(juce::MidiMessage::controllerEvent(chan, 11, p));
 	}
 }
 
@@ -233,7 +276,7 @@ void SoundplaneMIDIOutput::sendAllMIDINotesOff()
 {
 	for(int c=1; c<=kMaxMIDIVoices; ++c)
 	{
-		mpCurrentDevice->sendMessageNow(juce::MidiMessage::allNotesOff(c));
+		sendMessage(juce::MidiMessage::allNotesOff(c));
 	}
 }
 
@@ -376,11 +419,15 @@ int SoundplaneMIDIOutput::getMostRecentVoice()
 
 void SoundplaneMIDIOutput::beginOutputFrame(time_point<system_clock> now)
 {
+    mFrameTime = now;
     setupVoiceChannels();
 }
 
 void SoundplaneMIDIOutput::processTouch(int i, int offset, const Touch& t)
 {
+    // there is one voice per channel, so touches past the last voice are not sent.
+    if(i >= mVoices) return;
+    
     MIDIVoice* pVoice = &mMIDIVoices[i];
     pVoice->x = t.x;
     pVoice->y = t.y;
@@ -512,10 +559,12 @@ void SoundplaneMIDIOutput::processController(int zoneID, int h, const Controller
 
 void SoundplaneMIDIOutput::endOutputFrame()
 {
+    mFrameDejitterMillis = mDejitterMillis.load(std::memory_order_relaxed);
     sendMIDIVoiceMessages();
     if(mGotControllerChanges) sendMIDIControllerMessages();
     if(mVerbose) dumpVoices();
     updateVoiceStates();
+    sendFrameMessages();
 }
 
 void SoundplaneMIDIOutput::setupVoiceChannels()
@@ -539,17 +588,17 @@ void SoundplaneMIDIOutput::sendMIDIVoiceMessages()
 				
 		if(pVoice->mSendNoteOff)
 		{
-			mpCurrentDevice->sendMessageNow(juce::MidiMessage::noteOff(chan, pVoice->mPreviousMIDINote));
+			sendFrameMessage(juce::MidiMessage::noteOff(chan, pVoice->mPreviousMIDINote));
 		}
 		
 		if(pVoice->mSendNoteOn)
 		{
-			mpCurrentDevice->sendMessageNow(juce::MidiMessage::noteOn(chan, pVoice->mMIDINote, (unsigned char)pVoice->mMIDIVel));
+			sendFrameMessage(juce::MidiMessage::noteOn(chan, pVoice->mMIDINote, (unsigned char)pVoice->mMIDIVel));
 		}
 		
 		if(pVoice->mSendPitchBend)
 		{		
-			mpCurrentDevice->sendMessageNow(juce::MidiMessage::pitchWheel(chan, pVoice->mMIDIBend));
+			sendFrameMessage(juce::MidiMessage::pitchWheel(chan, pVoice->mMIDIBend));
 		}
 		
 		if(pVoice->mSendPressure)
@@ -560,29 +609,29 @@ void SoundplaneMIDIOutput::sendMIDIVoiceMessages()
 				if(!mMPEExtended)
 				{
 					// normal MPE: send pressure as channel pressure
-					mpCurrentDevice->sendMessageNow(juce::MidiMessage::channelPressureChange(chan, p));
+					sendFrameMessage(juce::MidiMessage::channelPressureChange(chan, p));
 				}
 				else
 				{
 					// MPE extensions
-					mpCurrentDevice->sendMessageNow(juce::MidiMessage::channelPressureChange(chan, p));	
-					mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(chan, 11, p));
+					sendFrameMessage(juce::MidiMessage::channelPressureChange(chan, p));	
+					sendFrameMessage(juce::MidiMessage::controllerEvent(chan, 11, p));
 				}
 			}
 			else  // for single channel MIDI, send pressure as poly aftertouch
 			{					
-				mpCurrentDevice->sendMessageNow(juce::MidiMessage::aftertouchChange(chan, pVoice->mMIDINote, p));	
+				sendFrameMessage(juce::MidiMessage::aftertouchChange(chan, pVoice->mMIDINote, p));	
 			}
 		}
 		
 		if(pVoice->mSendXCtrl)
 		{
-			mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(chan, 73, pVoice->mMIDIXCtrl));
+			sendFrameMessage(juce::MidiMessage::controllerEvent(chan, 73, pVoice->mMIDIXCtrl));
 		}
 		
 		if(pVoice->mSendYCtrl)
 		{
-			mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(chan, 74, pVoice->mMIDIYCtrl));
+			sendFrameMessage(juce::MidiMessage::controllerEvent(chan, 74, pVoice->mMIDIYCtrl));
 		}
 	}
 }
@@ -606,20 +655,20 @@ void SoundplaneMIDIOutput::sendMIDIControllerMessages()
             switch(c.type)
             {
                 case kControllerX:
-                    mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(channel, c.number1, ix));
+                    sendFrameMessage(juce::MidiMessage::controllerEvent(channel, c.number1, ix));
                     break;
                 case kControllerY:
-                    mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(channel, c.number1, iy));
+                    sendFrameMessage(juce::MidiMessage::controllerEvent(channel, c.number1, iy));
                     break;
                 case kControllerXY:
-                    mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(channel, c.number1, ix));
-                    mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(channel, c.number2, iy));
+                    sendFrameMessage(juce::MidiMessage::controllerEvent(channel, c.number1, ix));
+                    sendFrameMessage(juce::MidiMessage::controllerEvent(channel, c.number2, iy));
                     break;
                 case kControllerZ:
-                    mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(channel, c.number1, iz));
+                    sendFrameMessage(juce::MidiMessage::controllerEvent(channel, c.number1, iz));
                     break;
                 case kControllerToggle:
-                    mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(channel, c.number1, ix));
+                    sendFrameMessage(juce::MidiMessage::controllerEvent(channel, c.number1, ix));
                     break;
             }
         }
@@ -642,15 +691,15 @@ void SoundplaneMIDIOutput::doInfrequentTasks()
 void SoundplaneMIDIOutput::pollKymaViaMIDI()
 {
     // set NRPN
-    mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(16, 99, 0x53));
-    mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(16, 98, 0x50));
+    sendMessage(juce::MidiMessage::controllerEvent(16, 99, 0x53));
+    sendMessage(juce::MidiMessage::controllerEvent(16, 98, 0x50));
     
     // data entry -- send # of voices for Kyma
-    mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(16, 6, mVoices));
+    sendMessage(juce::MidiMessage::controllerEvent(16, 6, mVoices));
     
     // null NRPN
-    mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(16, 99, 0xFF));
-    mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(16, 98, 0xFF));  
+    sendMessage(juce::MidiMessage::controllerEvent(16, 99, 0xFF));
+    sendMessage(juce::MidiMessage::controllerEvent(16, 98, 0xFF));  
     
     // MLTEST Kyma debug
     MLConsole() << "polling Kyma via MIDI: " << mVoices << " voices.\n";
@@ -695,7 +744,7 @@ void SoundplaneMIDIOutput::setMaxTouches(int t)
     if (mMPEMode && mpCurrentDevice)
     {
         int globalChannel=mChannel;
-        mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(globalChannel, kMPE_MIDI_CC, mVoices));
+        sendMessage(juce::MidiMessage::controllerEvent(globalChannel, kMPE_MIDI_CC, mVoices));
     }
 }
 
@@ -703,7 +752,7 @@ void SoundplaneMIDIOutput::sendMPEChannels()
 {
 	int chan = getMPEMainChannel();
 	if(!mpCurrentDevice) return;
-	mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(chan, kMPE_MIDI_CC, mMPEChannels));
+	sendMessage(juce::MidiMessage::controllerEvent(chan, kMPE_MIDI_CC, mMPEChannels));
 }
 
 void SoundplaneMIDIOutput::sendPitchbendRange()
@@ -720,10 +769,10 @@ void SoundplaneMIDIOutput::sendPitchbendRange()
 		quantizedRange = (quantizedRange/12)*12;
 	}
 
-	mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(chan, 100, 0));
-	mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(chan, 101, 0));
-	mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(chan, 6, quantizedRange));
-	mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(chan, 38, 0));
+	sendMessage(juce::MidiMessage::controllerEvent(chan, 100, 0));
+	sendMessage(juce::MidiMessage::controllerEvent(chan, 101, 0));
+	sendMessage(juce::MidiMessage::controllerEvent(chan, 6, quantizedRange));
+	sendMessage(juce::MidiMessage::controllerEvent(chan, 38, 0));
 }
 
 void SoundplaneMIDIOutput::dumpVoices()
@@ -10,12 +10,14 @@
 
 #include <vector>
 #include <memory>
+#include <atomic>
 #include <chrono>
 #include <stdint.h>
 #include <stdlib.h>
 
 
 //#include "TouchTracker.h"
+#include "Metrics.h"
 #include "SoundplaneModelA.h"
 #include "SoundplaneOutput.h"
 #include "Touch.h"
@@ -114,9 +116,16 @@ public:
 	void setKymaMode(bool v);
     
     void setDataRate(float r) { mDataRate = r; }
+    
+    // if nonzero, each frame's messages are sent this many milliseconds after the
+    // device made the frame, instead of as soon as they are made.
+    // May be called from any thread.
+    void setDejitter(float millis) { mDejitterMillis.store(millis, std::memory_order_relaxed); }
 	
 	void doInfrequentTasks();
 	
+	const MetricCounter& getMessagesSent() const { return mMessagesSent; }
+	
 private:
 	int getMPEMainChannel();
 	int getMPEVoiceChannel(int voice);
@@ -128,6 +137,9 @@ private:
 
 	int getMIDIPressure(MIDIVoice* pVoice);
 
+	void sendMessage(const juce::MidiMessage& m);
+	void sendFrameMessage(const juce::MidiMessage& m);
+	void sendFrameMessages();
 	void sendMIDIChannelPressure(int chan, int p);
 	void sendAllMIDIChannelPressures(int p);
 	void sendAllMIDINotesOff();
@@ -173,6 +185,17 @@ private:
 	
 	bool mKymaMode;
 	bool mVerbose;
+	
+	// the messages of the current frame, when dejittering, and the time the device made it.
+	// Only endOutputFrame() on the process thread makes frame messages, with the delay it
+	// reads once per frame into mFrameDejitterMillis.
+	std::atomic<float> mDejitterMillis{0.f};
+	float mFrameDejitterMillis{0.f};
+	time_point<system_clock> mFrameTime{};
+	juce::MidiBuffer mFrameMessages;
+	bool mDeviceThreadStarted{false};
+	
+	MetricCounter mMessagesSent;
 };
 
 
@@ -8,6 +8,8 @@
 #include "SensorFrame.h"
 #include "MLProjectInfo.h"
 
+#include <algorithm>
+
 const int kModelDefaultCarriersSize = 40;
 const unsigned char kModelDefaultCarriers[kModelDefaultCarriersSize] =
 {
@@ -43,15 +45,15 @@ static void makeStandardCarrierSet(SoundplaneDriver::Carriers &carriers, int set
 	}
 }
 
-void touchArrayToFrame(TouchArray* pArray, MLSignal* pFrame)
+void touchArrayToFrame(const TouchArray* pArray, MLSignal* pFrame, int n)
 {
 	// get references for syntax
-	TouchArray& array = *pArray;
+	const TouchArray& array = *pArray;
 	MLSignal& frame = *pFrame;
 	
-	for(int i = 0; i < kMaxTouches; ++i)
+	for(int i = 0; i < n; ++i)
 	{
-		Touch t = array[i];
+		const Touch& t = array[i];
 		frame(xColumn, i) = t.x;
 		frame(yColumn, i) = t.y;
 		frame(zColumn, i) = t.z;
@@ -88,18 +90,12 @@ SensorFrame signalToSensorFrame(const MLSignal& in)
 //
 #pragma mark SoundplaneModel
 
-SoundplaneModel::SoundplaneModel() :
+SoundplaneModel::SoundplaneModel(DriverFactory makeDriver, bool useProcessThread) :
 mOutputEnabled(false),
-mSurface(SensorGeometry::width, SensorGeometry::height),
-
-mRawSignal(SensorGeometry::width, SensorGeometry::height),
-mCalibratedSignal(SensorGeometry::width, SensorGeometry::height),
-mSmoothedSignal(SensorGeometry::width, SensorGeometry::height),
-
 mCalibrating(false),
 mSelectingCarriers(false),
+mRaw(false),
 mHasCalibration(false),
-mZoneIndexMap(kSoundplaneAKeyWidth, kSoundplaneAKeyHeight),
 mHistoryCtr(0),
 mCarrierMaskDirty(false),
 mNeedsCarriersSet(false),
@@ -110,13 +106,8 @@ mDoOverrideCarriers(false),
 mKymaIsConnected(0),
 mKymaMode(false)
 {
-	mpDriver = SoundplaneDriver::create(*this);
-	
-	for(int i=0; i<kMaxTouches; ++i)
-	{
-		mCurrentKeyX[i] = -1;
-		mCurrentKeyY[i] = -1;
-	}
+	mpDriver = makeDriver(*this);
+	registerMetrics();
 	
 	// setup default carriers in case there are no saved carriers
 	for (int car=0; car<kSoundplaneNumCarriers; ++car)
@@ -147,10 +138,13 @@ mKymaMode(false)
 	
 	startModelTimer();
 	
-	mSensorFrameQueue = std::unique_ptr< Queue<SensorFrame> >(new Queue<SensorFrame>(kSensorFrameQueueSize));
-	
-	mProcessThread = std::thread(&SoundplaneModel::processThread, this);
-	SetPriorityRealtimeAudio(mProcessThread.native_handle());
+	mPrevProcessTouchesTime = steady_clock::now(); // TODO interval timer object
+	mNextInfrequentTasksTime = steady_clock::now() + seconds(1);
+	if(useProcessThread)
+	{
+		mProcessThread = std::thread(&SoundplaneModel::processThread, this);
+		setThreadRealtime(mProcessThread.native_handle(), kRealtimeProcessThread);
+	}
 	
 	mpDriver->start();
 }
@@ -159,6 +153,7 @@ SoundplaneModel::~SoundplaneModel()
 {
 	// signal threads to shut down
 	mTerminating = true;
+	mFrameEvent.notify();
 	
 	if (mProcessThread.joinable())
 	{
@@ -168,9 +163,31 @@ SoundplaneModel::~SoundplaneModel()
 	
 	listenToOSC(0);
 	
+	// the registry refers to the driver's metrics.
+	mStatsServer.stop();
+	mMetrics.clear();
+	
+	stopCapture();
 	mpDriver = nullptr;
 }
 
+void SoundplaneModel::registerMetrics()
+{
+	const DriverMetrics& driverMetrics = mpDriver->getMetrics();
+	mMetrics.addCounter("frames_received", driverMetrics.framesReceived);
+	mMetrics.addCounter("frames_dropped", driverMetrics.framesDropped);
+	mMetrics.addCounter("sequence_mismatches", driverMetrics.sequenceMismatches);
+	mMetrics.addHistogram("sequence_gaps", driverMetrics.sequenceGaps);
+	mMetrics.addCounter("frames_interpolated", driverMetrics.framesInterpolated);
+	mMetrics.addGauge("queue_high_water", mQueueHighWater);
+	mMetrics.addGauge("queue_overflows", mQueueOverflows);
+	mMetrics.addHistogram("tracker_ns", mTrackerTime);
+	mMetrics.addGauge("active_touches", mActiveTouches);
+	mMetrics.addCounter("osc_packets_sent", mOSCOutput.getPacketsSent());
+	mMetrics.addCounter("osc_bytes_sent", mOSCOutput.getBytesSent());
+	mMetrics.addCounter("midi_messages_sent", mMIDIOutput.getMessagesSent());
+}
+
 
 
 void SoundplaneModel::doPropertyChangeAction(ml::Symbol p, const MLProperty & newVal)
@@ -211,17 +228,23 @@ void SoundplaneModel::doPropertyChangeAction(ml::Symbol p, const MLProperty & ne
 			}
 			else if (p == "max_touches")
 			{
-				mMaxTouches = v;
+				mMaxTouches = ml::clamp((int)v, 0, kMaxTouches);
 				mMIDIOutput.setMaxTouches(v);
 				mOSCOutput.setMaxTouches(v);
 			}
 			else if (p == "lopass_z")
 			{
-				mTracker.setLopassZ(v);
+				for(SoundplaneTrackingBase* pTracking : mTrackings)
+				{
+					pTracking->setLopassZ(v);
+				}
 			}
 			else if (p == "z_thresh")
 			{
-				mTracker.setThresh(v);
+				for(SoundplaneTrackingBase* pTracking : mTrackings)
+				{
+					pTracking->setThresh(v);
+				}
 			}
 			else if (p == "snap")
 			{
@@ -261,6 +284,10 @@ void SoundplaneModel::doPropertyChangeAction(ml::Symbol p, const MLProperty & ne
 			{
 				mMIDIOutput.setPressureActive(bool(v));
 			}
+			else if (p == "midi_dejitter")
+			{
+				mMIDIOutput.setDejitter(v);
+			}
 			else if (p == "osc_active")
 			{
 				bool b = v;
@@ -271,6 +298,11 @@ void SoundplaneModel::doPropertyChangeAction(ml::Symbol p, const MLProperty & ne
 				bool b = v;
 				mSendMatrixData = b;
 			}
+			else if (p == "osc_stats")
+			{
+				bool b = v;
+				mSendStats = b;
+			}
 			else if (p == "quantize")
 			{
 				sendParametersToZones();
@@ -278,7 +310,10 @@ void SoundplaneModel::doPropertyChangeAction(ml::Symbol p, const MLProperty & ne
 			else if (p == "rotate")
 			{
 				bool b = v;
-				mTracker.setRotate(b);
+				for(SoundplaneTrackingBase* pTracking : mTrackings)
+				{
+					pTracking->setRotate(b);
+				}
 			}
 			else if (p == "glissando")
 			{
@@ -336,6 +371,17 @@ void SoundplaneModel::doPropertyChangeAction(ml::Symbol p, const MLProperty & ne
 			{
 				// nothing to do for Model
 			}
+			else if (p == "stats_socket")
+			{
+				if(str.empty())
+				{
+					mStatsServer.stop();
+				}
+				else if(mStatsServer.start(str))
+				{
+					MLConsole() << "SoundplaneModel: serving stats on " << str << "\n";
+				}
+			}
 			else if (p == "midi_device")
 			{
 				mMIDIOutput.setDevice(str);
@@ -405,15 +451,16 @@ void SoundplaneModel::onStartup()
 	
 	// connected but not calibrated -- disable output.
 	enableOutput(false);
+	mpDriver->clearCalibration();
 	// output will be enabled at end of calibration.
 	mNeedsCalibrate = true;
 }
 
 // we need to return as quickly as possible from driver callback.
-// just put the new frame in the queue.
-void SoundplaneModel::onFrame(const SensorFrame& frame)
+// the frame is already in the driver's ring, so just wake the process thread.
+void SoundplaneModel::onFrameReady()
 {
-	mSensorFrameQueue->push(frame);
+	mFrameEvent.notify();
 }
 
 void SoundplaneModel::onError(int error, const char* errStr)
@@ -452,64 +499,87 @@ void SoundplaneModel::onClose()
 
 void SoundplaneModel::processThread()
 {
-	time_point<system_clock> previous, now;
-	previous = now = system_clock::now();
-	mPrevProcessTouchesTime = now; // TODO interval timer object
-	
 	while(!mTerminating)
 	{
-		now = system_clock::now();
-		process(now);
+		// sleep until the driver has queued a frame, or until it's time for infrequent tasks.
+		mFrameEvent.waitUntil(mNextInfrequentTasksTime);
+		processFrames();
+	}
+}
+
+void SoundplaneModel::processFrames()
+{
+	// process all the queued frames. Their times are on the driver's steady clock, and
+	// go to the outputs as system time.
+	mClockOffset = system_clock::now().time_since_epoch() -
+		duration_cast<system_clock::duration>(steady_clock::now().time_since_epoch());
+	while(process())
+	{
 		mProcessCounter++;
-		
-		size_t queueSize = mSensorFrameQueue->elementsAvailable();
-		if(queueSize > kMaxQueueSize)
-		{
-			kMaxQueueSize = queueSize;
-		}
-		
-		if(mProcessCounter >= 1000)
+	}
+	
+	if(mProcessCounter >= 1000)
+	{
+		if(mVerbose)
 		{
-			if(mVerbose)
+			uint64_t overflowCount = mpDriver->getFrameRing().getOverflowCount();
+			if(overflowCount != mPrevOverflowCount)
 			{
-				if(kMaxQueueSize >= kSensorFrameQueueSize)
-				{
-					MLConsole() << "warning: input queue full \n";
-				}
+				MLConsole() << "warning: input queue full, " << static_cast<int>(overflowCount - mPrevOverflowCount) << " frames dropped\n";
+				mPrevOverflowCount = overflowCount;
 			}
-			
-			mProcessCounter = 0;
-			kMaxQueueSize = 0;
 		}
 		
-		// sleep, less than one frame interval
-		std::this_thread::sleep_for(std::chrono::microseconds(500));
-		
-		// do infrequent tasks every second
-		int secondsInterval = duration_cast<seconds>(now - previous).count();
-		if (secondsInterval >= 1)
-		{
-			previous = now;
-			doInfrequentTasks();
-		}
+		mProcessCounter = 0;
+	}
+	
+	// do infrequent tasks every second
+	time_point<steady_clock> now = steady_clock::now();
+	if (now >= mNextInfrequentTasksTime)
+	{
+		mNextInfrequentTasksTime = now + seconds(1);
+		doInfrequentTasks();
 	}
 }
 
-void SoundplaneModel::process(time_point<system_clock> now)
+// process one frame from the driver's frame ring in place. Returns false if there were none.
+bool SoundplaneModel::process()
 {
-	if (mSensorFrameQueue->pop(mSensorFrame))
+	SensorFrameRing& ring = mpDriver->getFrameRing();
+	const DriverFrame* pFrame = ring.acquire();
+	if(!pFrame) return false;
+	
+	// the time the device made the frame.
+	const time_point<steady_clock> frameTime = pFrame->frameTime;
+	
+	mFrameLatency.add(duration_cast<microseconds>(steady_clock::now() - pFrame->time).count());
+	
+	const bool tracing = LatencyTrace::isEnabled();
+	if(tracing)
 	{
-		mSurface = sensorFrameToSignal(mSensorFrame);
-		
-		// store surface for raw output
+		mFrameTrace = pFrame->trace;
+		mFrameTrace.mark(kTraceQueuePop);
+	}
+	
+	if(pFrame->calibrated)
+	{
+		// frames calibrated by the driver are ready to use.
+		if(mOutputEnabled && mHasCalibration && !mCalibrating && !mSelectingCarriers)
 		{
-			std::lock_guard<std::mutex> lock(mRawSignalMutex);
-			mRawSignal.copy(mSurface);
+			processCalibratedFrame(pFrame->frame, frameTime);
+			mCalibratedSnapshot.publish(pFrame->frame);
 		}
+	}
+	else
+	{
+		// raw frames, used for calibration and the raw view. These are calibrated here
+		// if the driver is not calibrating frames itself.
+		const SensorFrame& rawFrame = pFrame->frame;
+		mRawSnapshot.publish(rawFrame);
 		
 		if (mCalibrating)
 		{
-			mStats.accumulate(mSensorFrame);
+			mStats.accumulate(rawFrame);
 			if (mStats.getCount() >= kSoundplaneCalibrateSize)
 			{
 				endCalibrate();
@@ -517,7 +587,7 @@ void SoundplaneModel::process(time_point<system_clock> now)
 		}
 		else if (mSelectingCarriers)
 		{
-			mStats.accumulate(mSensorFrame);
+			mStats.accumulate(rawFrame);
 			
 			if (mStats.getCount() >= kSoundplaneCalibrateSize)
 			{
@@ -528,144 +598,96 @@ void SoundplaneModel::process(time_point<system_clock> now)
 		{
 			if (mHasCalibration)
 			{
-				mCalibratedFrame = subtract(multiply(mSensorFrame, mCalibrateMeanInv), 1.0f);
-				TouchArray touches = trackTouches(mCalibratedFrame);
-				
-				// let Zones process touches. This is always done at the controller's frame rate.
-				sendTouchesToZones(touches);
-				
-				// determine if incoming frame could start or end a touch
-				bool notesChangedThisFrame = findNoteChanges(touches, mTouchArray1);
-				mTouchArray1 = touches;
-				
-				const int dataPeriodMicrosecs = 1000*1000 / mDataRate;
-				int microsSinceSend = duration_cast<microseconds>(now - mPrevProcessTouchesTime).count();
-				bool timeForNewFrame = (microsSinceSend >= dataPeriodMicrosecs);
-				if(notesChangedThisFrame || timeForNewFrame)
-				{
-					mPrevProcessTouchesTime = now;
-					sendFrameToOutputs(now);
-				}
+				SensorFrame& calibrated = mCalibratedSnapshot.getWriteBuffer();
+				scaleOffset(calibrated, rawFrame, mCalibrateMeanInv, -1.0f);
+				processCalibratedFrame(calibrated, frameTime);
+				mCalibratedSnapshot.publish();
 			}
 		}
 	}
+	
+	ring.release();
+	
+	if(tracing)
+	{
+		mLatencyTrace.push(mFrameTrace);
+	}
+	return true;
 }
 
-
-// send raw touches to zones in order to generate touch and controller states within the Zones.
-//
-void SoundplaneModel::sendTouchesToZones(TouchArray touches)
+// track touches in a calibrated frame and send them to the outputs.
+void SoundplaneModel::processCalibratedFrame(const SensorFrame& calibrated, time_point<steady_clock> frameTime)
 {
-	const int maxTouches = getFloatProperty("max_touches");
-	const float hysteresis = getFloatProperty("hysteresis");
+	int maxTouches;
+	SoundplaneTrackingBase& tracking = getTracking(maxTouches);
+	const int capacity = tracking.getCapacity();
 	
-	// clear incoming touches and push touch history in each zone
-	for(auto& zone : mZones)
-	{
-		zone.newFrame();
-	}
+	const time_point<steady_clock> trackStart = steady_clock::now();
+	const TouchArray& touches = trackTouches(tracking, maxTouches, calibrated, frameTime);
+	mTrackerTime.add(duration_cast<nanoseconds>(steady_clock::now() - trackStart).count());
+	mActiveTouches.set(std::count_if(touches.begin(), touches.begin() + capacity, touchIsActive));
+	mFrameTrace.mark(kTraceTrackerDone);
 	
-	// add any active touches to the Zones they are over
-	for(int i=0; i<maxTouches; ++i)
-	{
-		float x = touches[i].x;
-		float y = touches[i].y;
-		
-		if(touchIsActive(touches[i]))
-		{
-			//std::cout << i << ":" << age << "\n";
-			// get fractional key grid position (Soundplane A)
-			Vec2 keyXY (x, y);
-			
-			// get integer key
-			int ix = (int)x;
-			int iy = (int)y;
-			
-			// apply hysteresis to raw position to get current key
-			// hysteresis: make it harder to move out of current key
-			if(touches[i].state == kTouchStateOn)
-			{
-				mCurrentKeyX[i] = ix;
-				mCurrentKeyY[i] = iy;
-			}
-			else
-			{
-				float hystWidth = hysteresis*0.25f;
-				MLRect currentKeyRect(mCurrentKeyX[i], mCurrentKeyY[i], 1, 1);
-				currentKeyRect.expand(hystWidth);
-				if(!currentKeyRect.contains(keyXY))
-				{
-					mCurrentKeyX[i] = ix;
-					mCurrentKeyY[i] = iy;
-				}
-			}
-			
-			// send index, xyz, dz to zone
-			int zoneIdx = mZoneIndexMap(mCurrentKeyX[i], mCurrentKeyY[i]);
-			if(zoneIdx >= 0)
-			{
-				Touch t = touches[i];
-				t.kx = mCurrentKeyX[i];
-				t.ky = mCurrentKeyY[i];
-				mZones[zoneIdx].addTouchToFrame(i, t);
-			}
-		}
-	}
+	// let Zones process touches. This is always done at the controller's frame rate.
+	tracking.processZones();
+	mFrameTrace.mark(kTraceZonesDone);
 	
-	for(auto& zone : mZones)
+	// determine if incoming frame could start or end a touch
+	bool notesChangedThisFrame = findNoteChanges(touches, mTouchArray1, capacity);
+	std::copy_n(touches.begin(), capacity, mTouchArray1.begin());
+	
+	const int dataPeriodMicrosecs = 1000*1000 / mDataRate;
+	int microsSinceSend = duration_cast<microseconds>(touches.time - mPrevProcessTouchesTime).count();
+	bool timeForNewFrame = (microsSinceSend >= dataPeriodMicrosecs);
+	if(notesChangedThisFrame || timeForNewFrame)
 	{
-		zone.storeAnyNewTouches();
+		mPrevProcessTouchesTime = touches.time;
+		sendFrameToOutputs(tracking, calibrated, touches);
+		mFrameTrace.mark(kTraceOutputSend);
 	}
-	
-	std::bitset<kMaxTouches> freedTouches;
-	
-	// process note offs for each zone
-	// this happens before processTouches() to allow touches to be freed
-	for(auto& zone : mZones)
+}
+
+// let the driver calibrate frames as it unpacks them, unless we need raw frames
+// for calibrating, selecting carriers or the raw view.
+void SoundplaneModel::updateDriverCalibration()
+{
+	if(mHasCalibration && !mCalibrating && !mSelectingCarriers && !mRaw)
 	{
-		zone.processTouchesNoteOffs(freedTouches);
+		mpDriver->setCalibration(mCalibrateMeanInv);
 	}
-	
-	// process touches for each zone
-	for(auto& zone : mZones)
+	else
 	{
-		zone.processTouches(freedTouches);
+		mpDriver->clearCalibration();
 	}
 }
 
-void SoundplaneModel::sendFrameToOutputs(time_point<system_clock> now)
+void SoundplaneModel::setRaw(bool b)
+{
+	mRaw = b;
+	updateDriverCalibration();
+}
+
+void SoundplaneModel::sendFrameToOutputs(SoundplaneTrackingBase& tracking, const SensorFrame& calibrated, const TouchArray& touches)
 {
-	beginOutputFrame(now);
+	// the outputs are stamped with the time the device made the frame.
+	beginOutputFrame(time_point<system_clock>(duration_cast<system_clock::duration>(touches.time.time_since_epoch()) + mClockOffset));
 	
 	// send messages to outputs about each zone
-	for(auto& zone : mZones)
-	{
-		// touches
-		for(int i=0; i<kMaxTouches; ++i)
+	tracking.forEachOutput(
+		[this](int zoneID, int offset, int i, const Touch& t)
 		{
-			Touch t = zone.mOutputTouches[i];
-			if(touchIsActive(t))
-			{
-				sendTouchToOutputs(i, zone.mOffset, t);
-			}
-		}
-		
-		// controller
-		if(zone.mOutputController.active)
+			sendTouchToOutputs(i, offset, t);
+		},
+		[this](int zoneID, int offset, const Controller& c)
 		{
-			sendControllerToOutputs(zone.mZoneID, zone.mOffset, zone.mOutputController);
-		}
-	}
+			sendControllerToOutputs(zoneID, offset, c);
+		});
 	
 	// send optional calibrated matrix to OSC output
 	if(mSendMatrixData)
 	{
-		MLSignal calibratedPressure = getCalibratedSignal();
-		if(calibratedPressure.getHeight() == SensorGeometry::height)
-		{
-			// send to OSC output only
-			mOSCOutput.processMatrix(calibratedPressure);
-		}
+		// send to OSC output only
+		mOSCOutput.processMatrix(calibrated);
 	}
 	
 	endOutputFrame();
@@ -741,6 +763,7 @@ void SoundplaneModel::setAllPropertiesToDefaults()
 	setProperty("midi_mpe", 1);
 	setProperty("midi_mpe_extended", 0);
 	setProperty("midi_channel", 1);
+	setProperty("midi_dejitter", 0.);
 	
 	setProperty("data_rate", 250.);
 	
@@ -755,6 +778,8 @@ void SoundplaneModel::setAllPropertiesToDefaults()
 
 	setProperty("osc_active", 1);
 	setProperty("osc_raw", 0);
+	setProperty("osc_stats", 0);
+	setProperty("stats_socket", "");
 	
 	setProperty("bend_range", 48);
 	setProperty("transpose", 0);
@@ -934,8 +959,10 @@ const char* SoundplaneModel::getClientStr()
 // remove all zones from the zone list.
 void SoundplaneModel::clearZones()
 {
-	mZones.clear();
-	mZoneIndexMap.fill(-1);
+	for(SoundplaneTrackingBase* pTracking : mTrackings)
+	{
+		pTracking->clearZones();
+	}
 }
 
 void SoundplaneModel::loadZonesFromString(const std::string& zoneStr)
@@ -954,22 +981,20 @@ void SoundplaneModel::loadZonesFromString(const std::string& zoneStr)
 	{
 		if(!strcmp(pNode->string, "zone"))
 		{
-			mZones.emplace_back(Zone());
-			Zone* pz = &mZones.back();
+			Zone z;
 			
 			cJSON* pZoneType = cJSON_GetObjectItem(pNode, "type");
 			if(pZoneType)
 			{
 				// get zone type and type specific attributes
-				ml::Symbol typeSym(pZoneType->valuestring);
-				int zoneTypeNum = Zone::symbolToZoneType(typeSym);
+				int zoneTypeNum = Zone::nameToZoneType(pZoneType->valuestring);
 				if(zoneTypeNum >= 0)
 				{
-					pz->mType = zoneTypeNum;
+					z.setType(zoneTypeNum);
 				}
 				else
 				{
-					MLConsole() << "Unknown type " << typeSym << " for zone!\n";
+					MLConsole() << "Unknown type " << pZoneType->valuestring << " for zone!\n";
 				}
 			}
 			else
@@ -988,7 +1013,7 @@ void SoundplaneModel::loadZonesFromString(const std::string& zoneStr)
 					int y = cJSON_GetArrayItem(pZoneRect, 1)->valueint;
 					int w = cJSON_GetArrayItem(pZoneRect, 2)->valueint;
 					int h = cJSON_GetArrayItem(pZoneRect, 3)->valueint;
-					pz->setBounds(MLRect(x, y, w, h));
+					z.setBounds(KeyRect{x, y, w, h});
 				}
 				else
 				{
@@ -1000,33 +1025,17 @@ void SoundplaneModel::loadZonesFromString(const std::string& zoneStr)
 				MLConsole() << "No rect for zone\n";
 			}
 			
-			pz->mName = TextFragment(getJSONString(pNode, "name"));
-			pz->mStartNote = getJSONInt(pNode, "note");
-			pz->mOffset = getJSONInt(pNode, "offset");
-			pz->mControllerNum1 = getJSONInt(pNode, "ctrl1");
-			pz->mControllerNum2 = getJSONInt(pNode, "ctrl2");
-			pz->mControllerNum3 = getJSONInt(pNode, "ctrl3");
+			z.setName(getJSONString(pNode, "name"));
+			z.setStartNote(getJSONInt(pNode, "note"));
+			z.setOffset(getJSONInt(pNode, "offset"));
+			z.setControllerNumbers(getJSONInt(pNode, "ctrl1"), getJSONInt(pNode, "ctrl2"), getJSONInt(pNode, "ctrl3"));
 			
-			int zoneIdx = mZones.size() - 1;
-			if(zoneIdx < kSoundplaneAMaxZones)
+			bool added = true;
+			for(SoundplaneTrackingBase* pTracking : mTrackings)
 			{
-				pz->setZoneID(zoneIdx);
-				
-				MLRect b(pz->getBounds());
-				int x = b.x();
-				int y = b.y();
-				int w = b.width();
-				int h = b.height();
-				
-				for(int j=y; j < y + h; ++j)
-				{
-					for(int i=x; i < x + w; ++i)
-					{
-						mZoneIndexMap(i, j) = zoneIdx;
-					}
-				}
+				added &= pTracking->addZone(z);
 			}
-			else
+			if(!added)
 			{
 				MLConsole() << "SoundplaneModel::loadZonesFromString: out of zones!\n";
 			}
@@ -1041,46 +1050,25 @@ void SoundplaneModel::loadZonesFromString(const std::string& zoneStr)
 void SoundplaneModel::sendParametersToZones()
 {
 	// TODO zones should have parameters (really attributes) too, so they can be inspected.
-	int zones = mZones.size();
-	const float v = getFloatProperty("vibrato");
-	const float h = getFloatProperty("hysteresis");
-	bool q = getFloatProperty("quantize");
-	bool nl = getFloatProperty("lock");
-	int t = getFloatProperty("transpose");
-	float sf = getFloatProperty("snap");
-	
-	for(int i=0; i<zones; ++i)
+	ZoneParameters p;
+	p.vibrato = getFloatProperty("vibrato");
+	p.hysteresis = getFloatProperty("hysteresis");
+	p.quantize = getFloatProperty("quantize");
+	p.noteLock = getFloatProperty("lock");
+	p.transpose = getFloatProperty("transpose");
+	p.snap = getFloatProperty("snap");
+	for(SoundplaneTrackingBase* pTracking : mTrackings)
 	{
-		mZones[i].mVibrato = v;
-		mZones[i].mHysteresis = h;
-		mZones[i].mQuantize = q;
-		mZones[i].mNoteLock = nl;
-		mZones[i].mTranspose = t;
-		mZones[i].setSnapFreq(sf);
+		pTracking->setZoneParameters(p);
 	}
 }
 
-// c over [0 - 1] fades response from sqrt(x) -> x -> x^2
-//
-float responseCurve(float x, float c)
-{
-	float y;
-	if(c < 0.5f)
-	{
-		y = lerp(x*x, x, c*2.f);
-	}
-	else
-	{
-		y = lerp(x, sqrtf(x), c*2.f - 1.f);
-	}
-	return y;
-}
-
-bool SoundplaneModel::findNoteChanges(TouchArray t0, TouchArray t1)
+// true if the state of any of the first n touches changed.
+bool SoundplaneModel::findNoteChanges(const TouchArray& t0, const TouchArray& t1, int n)
 {
 	bool anyChanges = false;
 	
-	for(int i=0; i<kMaxTouches; ++i)
+	for(int i=0; i<n; ++i)
 	{
 		if((t0[i].state) != (t1[i].state))
 		{
@@ -1092,46 +1080,47 @@ bool SoundplaneModel::findNoteChanges(TouchArray t0, TouchArray t1)
 	return anyChanges;
 }
 
-TouchArray SoundplaneModel::scaleTouchPressureData(TouchArray in)
+// the tracking of the smallest capacity that holds mMaxTouches, and the touches to track with
+// it this frame. When that capacity changes, the last tracking is run for one more frame with
+// no touches, so that its zones end their notes, and the next one starts from copies of those
+// zones and a tracker with no touches.
+SoundplaneTrackingBase& SoundplaneModel::getTracking(int& maxTouches)
 {
-	TouchArray out = in;
-	
-	const float zscale = getFloatProperty("z_scale");
-	const float zcurve = getFloatProperty("z_curve");
-	const float dzScale = 0.125f;
+	SoundplaneTrackingBase* pLast = mpTracking.load(std::memory_order_relaxed);
+	maxTouches = mMaxTouches;
+	const int capacity = getTouchCapacity(maxTouches);
+	if(pLast->getCapacity() == capacity) return *pLast;
+	if(pLast->getMaxTouches() > 0)
+	{
+		maxTouches = 0;
+		return *pLast;
+	}
 	
-	for(int i=0; i<kMaxTouches; ++i)
+	auto it = std::find_if(mTrackings.begin(), mTrackings.end(),
+		[capacity](SoundplaneTrackingBase* p){ return p->getCapacity() == capacity; });
+	SoundplaneTrackingBase* pNext = *it;
+	pNext->clear();
+	pNext->clearZones();
+	for(int i=0; i<pLast->getNumZones(); ++i)
 	{
-		float z = in[i].z;
-		z *= zscale;
-		z = ml::clamp(z, 0.f, 4.f);
-		z = responseCurve(z, zcurve);
-		out[i].z = z;
-		
-		// for note-ons, use same z scale controls as pressure
-		float dz = in[i].dz*dzScale;
-		dz *= zscale;
-		dz = ml::clamp(dz, 0.f, 1.f);
-		dz = responseCurve(dz, zcurve);
-		out[i].dz = dz;
+		pNext->addZone(pLast->getZone(i));
 	}
-	return out;
+	mpTracking.store(pNext);
+	return *pNext;
 }
 
-TouchArray SoundplaneModel::trackTouches(const SensorFrame& frame)
+const TouchArray& SoundplaneModel::trackTouches(SoundplaneTrackingBase& tracking, int maxTouches, const SensorFrame& frame, time_point<steady_clock> frameTime)
 {
-	SensorFrame curvature = mTracker.preprocess(frame);
-	TouchArray t = mTracker.process(curvature, mMaxTouches);
+	tracking.setMaxTouches(maxTouches);
+	tracking.setPressureScale(getFloatProperty("z_scale"), getFloatProperty("z_curve"));
 	
-	mSmoothedSignal = sensorFrameToSignal(curvature);
+	// preprocess directly into the smoothed snapshot for the view.
+	const TouchArray& t = tracking.track(frame, mSmoothedSnapshot.getWriteBuffer(), frameTime);
+	mSmoothedSnapshot.publish();
+	mTouchSnapshot.publish(t);
 	
-	t = scaleTouchPressureData(t);
-	
-	// convert array of touches to Signal for display, history
-	{
-		std::lock_guard<std::mutex> lock(mTouchFrameMutex);
-		touchArrayToFrame(&t, &mTouchFrame);
-	}
+	// convert array of touches to Signal for history
+	touchArrayToFrame(&t, &mTouchFrame, tracking.getCapacity());
 	
 	mHistoryCtr++;
 	if (mHistoryCtr >= kSoundplaneHistorySize) mHistoryCtr = 0;
@@ -1142,11 +1131,28 @@ TouchArray SoundplaneModel::trackTouches(const SensorFrame& frame)
 
 void SoundplaneModel::doInfrequentTasks()
 {
+	// report the frame latency and the highest frame ring fill level since the last time.
+	SensorFrameRing& ring = mpDriver->getFrameRing();
+	if(mVerbose && mFrameLatency.getCount())
+	{
+		MLConsole() << "frame latency p50: " << static_cast<int>(mFrameLatency.getPercentile(0.5)) << "us p99: "
+			<< static_cast<int>(mFrameLatency.getPercentile(0.99)) << "us max: " << static_cast<int>(mFrameLatency.getMax()) << "us"
+			<< " max queue: " << static_cast<int>(ring.getMaxFillLevel()) << "\n";
+	}
+	mFrameLatency.clear();
+	mQueueHighWater.set(ring.getMaxFillLevel());
+	mQueueOverflows.set(ring.getOverflowCount());
+	ring.resetMaxFillLevel();
+	
 	MLNetServiceHub::PollNetServices();
 	if(getDeviceState() == kDeviceHasIsochSync)
 	{
 		mOSCOutput.doInfrequentTasks();
 		mMIDIOutput.doInfrequentTasks();
+		if(mSendStats)
+		{
+			mOSCOutput.sendStats(mMetrics);
+		}
 		
 		if(mCarrierMaskDirty)
 		{
@@ -1219,7 +1225,10 @@ void SoundplaneModel::enableOutput(bool b)
 
 void SoundplaneModel::clear()
 {
-	mTracker.clear();
+	for(SoundplaneTrackingBase* pTracking : mTrackings)
+	{
+		pTracking->clear();
+	}
 }
 
 // --------------------------------------------------------------------------------
@@ -1234,6 +1243,7 @@ void SoundplaneModel::beginCalibrate()
 	{
 		mStats.clear();
 		mCalibrating = true;
+		updateDriverCalibration();
 	}
 }
 
@@ -1245,6 +1255,7 @@ void SoundplaneModel::endCalibrate()
 	mCalibrateMeanInv = divide(fill(1.f), mean);
 	mCalibrating = false;
 	mHasCalibration = true;
+	updateDriverCalibration();
 	enableOutput(true);
 }
 
@@ -1267,7 +1278,8 @@ void SoundplaneModel::beginSelectCarriers()
 		mSelectCarriersStep = 0;
 		mStats.clear();
 		mSelectingCarriers = true;
-		mTracker.clear();
+		updateDriverCalibration();
+		clear();
 		mMaxNoiseByCarrierSet.resize(kStandardCarrierSets);
 		mMaxNoiseByCarrierSet.clear();
 		mMaxNoiseFreqByCarrierSet.resize(kStandardCarrierSets);
@@ -1381,5 +1393,34 @@ void SoundplaneModel::endSelectCarriers()
 	
 	mSelectingCarriers = false;
 	mNeedsCalibrate = true;
+	updateDriverCalibration();
 }
 
+
+bool SoundplaneModel::startCapture(const std::string& path)
+{
+	stopCapture();
+	std::unique_ptr<CaptureRecorder> recorder(new CaptureRecorder(path, mpDriver->getSerialNumberString(),
+		mpDriver->getFirmwareVersion(), mpDriver->getCarriers()));
+	if(!recorder->isOpen())
+	{
+		MLConsole() << "SoundplaneModel: couldn't create capture file " << path << "\n";
+		return false;
+	}
+	mpCaptureRecorder = std::move(recorder);
+	mpDriver->setCaptureRecorder(mpCaptureRecorder.get());
+	MLConsole() << "SoundplaneModel: capturing to " << path << "\n";
+	return true;
+}
+
+void SoundplaneModel::stopCapture()
+{
+	if(!mpCaptureRecorder) return;
+	
+	// once the driver has let go of the recorder, destroy it here and not on the driver
+	// thread: the destructor joins the writer thread and flushes the rest of the file.
+	mpDriver->setCaptureRecorder(nullptr);
+	MLConsole() << "SoundplaneModel: capture done, " << mpCaptureRecorder->getRecordsWritten() << " records written, "
+		<< mpCaptureRecorder->getRecordsDropped() << " dropped.\n";
+	mpCaptureRecorder.reset();
+}
@@ -6,6 +6,9 @@
 #ifndef __SOUNDPLANE_MODEL__
 #define __SOUNDPLANE_MODEL__
 
+#include <array>
+#include <atomic>
+#include <functional>
 #include <list>
 #include <map>
 #include <thread>
@@ -16,15 +19,20 @@
 #include "SoundplaneDriver.h"
 #include "MLOSCListener.h"
 #include "MLNetServiceHub.h"
-#include "TouchTracker.h"
+#include "SoundplaneTracking.h"
 #include "SoundplaneMIDIOutput.h"
 #include "SoundplaneOSCOutput.h"
 #include "MLSymbol.h"
 #include "MLFileCollection.h"
 #include "cJSON/cJSON.h"
-#include "Zone.h"
 #include "SoundplaneBinaryData.h"
-#include "MLQueue.h"
+#include "WakeupEvent.h"
+#include "LatencyHistogram.h"
+#include "LatencyTrace.h"
+#include "Metrics.h"
+#include "StatsServer.h"
+#include "TripleBuffer.h"
+#include "CaptureRecorder.h"
 
 using namespace ml;
 using namespace std::chrono;
@@ -40,8 +48,6 @@ typedef enum
 	ageColumn = 4
 } TouchSignalColumns;
 
-const int kSensorFrameQueueSize = 16;
-
 class SoundplaneModel :
 public SoundplaneDriverListener,
 public MLOSCListener,
@@ -50,12 +56,18 @@ public MLModel
 {
 public:
 	
-	SoundplaneModel();
+	// makes the driver the model reads frames from.
+	using DriverFactory = std::function< std::unique_ptr< SoundplaneDriver >(SoundplaneDriverListener&) >;
+	
+	// by default the model reads from the hardware and processes frames on its own thread.
+	// Without a process thread the client calls processFrames() itself, for example after
+	// each step() of a ReplaySoundplaneDriver.
+	SoundplaneModel(DriverFactory makeDriver = SoundplaneDriver::create, bool useProcessThread = true);
 	~SoundplaneModel();
 	
 	// SoundplaneDriverListener
 	void onStartup() override;
-	void onFrame(const SensorFrame& frame) override;
+	void onFrameReady() override;
 	void onError(int error, const char* errStr) override;
 	void onClose() override;
 	
@@ -76,8 +88,8 @@ public:
 	float getSampleHistory(int x, int y);
 	
 	void getHistoryStats(float& mean, float& stdDev);
-	int getWidth() { return mSurface.getWidth(); }
-	int getHeight() { return mSurface.getHeight(); }
+	int getWidth() { return SensorGeometry::width; }
+	int getHeight() { return SensorGeometry::height; }
 	
 	void setDefaultCarriers();
 	void setCarriers(const SoundplaneDriver::Carriers& c);
@@ -112,22 +124,40 @@ public:
 	
 	void setFilter(bool b);
 	
+	// process all the frames waiting in the driver's frame ring, and do the infrequent tasks
+	// if they are due. Only for models made without a process thread.
+	void processFrames();
+	
+	// record everything the device sends to a capture file, until stopCapture() is called.
+	// See CaptureFormat.h. Returns false if the file could not be created.
+	bool startCapture(const std::string& path);
+	void stopCapture();
+	
+	// while latency tracing is enabled (see LatencyTrace::setEnabled()), the trace of
+	// each frame processed is pushed to this ring. Drain it from any one thread.
+	LatencyTrace& getLatencyTrace() { return mLatencyTrace; }
+	
+	// the metrics published to the stats socket and as /t3d/stats messages.
+	const MetricsRegistry& getMetrics() const { return mMetrics; }
+	
 	void getMinMaxHistory(int n);
 	
-	const MLSignal& getTouchFrame() { return mTouchFrame; }
 	const MLSignal& getTouchHistory() { return mTouchHistory; }
-	const MLSignal getRawSignal() { std::lock_guard<std::mutex> lock(mRawSignalMutex); return mRawSignal; }
-	const MLSignal getCalibratedSignal() { std::lock_guard<std::mutex> lock(mCalibratedSignalMutex); return sensorFrameToSignal(mCalibratedFrame); }
-	
-	const MLSignal getSmoothedSignal() { std::lock_guard<std::mutex> lock(mSmoothedSignalMutex); return mSmoothedSignal; }
 	
-	const TouchArray& getTouchArray() { return mTouchArray1; }
+	// snapshots of the most recent frames and touches for the views. These never block the
+	// process thread. Each returns a reference that stays unchanged until the next call of the
+	// same function, and each must only be called from one thread, the grid view's.
+	const SensorFrame& getRawSnapshot() { return mRawSnapshot.acquire(); }
+	const SensorFrame& getCalibratedSnapshot() { return mCalibratedSnapshot.acquire(); }
+	const SensorFrame& getSmoothedSnapshot() { return mSmoothedSnapshot.acquire(); }
+	const TouchArray& getTouchSnapshot() { return mTouchSnapshot.acquire(); }
 	
 	bool isWithinTrackerCalibrateArea(int i, int j);
 	const int getHistoryCtr() { return mHistoryCtr; }
 	
-	const std::vector< Zone >::const_iterator getZonesBegin(){ return mZones.begin(); }
-	const std::vector< Zone >::const_iterator getZonesEnd(){ return mZones.end(); }
+	// copies of the zones with their touches, for the zone view.
+	int getNumZones() { return mpTracking.load()->getNumZones(); }
+	Zone getZone(int i) { return mpTracking.load()->getZone(i); }
 	
 	void setStateFromJSON(cJSON* pNode, int depth);
 	bool loadZonePresetByName(const std::string& name);
@@ -142,19 +172,38 @@ private:
 	TouchArray mZoneOutputTouches{};
 	
 	std::unique_ptr< SoundplaneDriver > mpDriver;
-	std::unique_ptr< Queue< SensorFrame > > mSensorFrameQueue;
+	std::unique_ptr< CaptureRecorder > mpCaptureRecorder;
+	
+	// signalled by the driver when a frame is ready in its frame ring.
+	WakeupEvent mFrameEvent;
+	
+	// time from the driver callback to the start of processing each frame.
+	LatencyHistogram mFrameLatency;
+	
+	// the trace of the frame being processed, and the traces of finished frames.
+	FrameTrace mFrameTrace;
+	LatencyTrace mLatencyTrace;
+	
+	// metrics updated by the process thread, and the registry naming them with the
+	// driver's and outputs' metrics. Values are published every second.
+	MetricHistogram mTrackerTime;
+	MetricGauge mActiveTouches;
+	MetricGauge mQueueHighWater;
+	MetricGauge mQueueOverflows;
+	MetricsRegistry mMetrics;
+	StatsServer mStatsServer{mMetrics};
 	
 	// TODO order!
-	void process(time_point<system_clock> now);
+	bool process();
+	void processCalibratedFrame(const SensorFrame& calibrated, time_point<steady_clock> frameTime);
+	void updateDriverCalibration();
 	
-	TouchArray trackTouches(const SensorFrame& frame);
+	SoundplaneTrackingBase& getTracking(int& maxTouches);
+	const TouchArray& trackTouches(SoundplaneTrackingBase& tracking, int maxTouches, const SensorFrame& frame, time_point<steady_clock> frameTime);
 	void initialize();
-	bool findNoteChanges(TouchArray t0, TouchArray t1);
-	TouchArray scaleTouchPressureData(TouchArray in);
-	
-	void sendTouchesToZones(TouchArray touches);
+	bool findNoteChanges(const TouchArray& t0, const TouchArray& t1, int n);
 	
-	void sendFrameToOutputs(time_point<system_clock> now);
+	void sendFrameToOutputs(SoundplaneTrackingBase& tracking, const SensorFrame& calibrated, const TouchArray& touches);
 	void beginOutputFrame(time_point<system_clock> now);
 	void sendTouchToOutputs(int i, int offset, const Touch& t);
 	void sendControllerToOutputs(int zoneID, int offset, const Controller& m);
@@ -163,15 +212,13 @@ private:
 	void clearZones();
 	void sendParametersToZones();
 	
-	std::vector< Zone > mZones;
-	MLSignal mZoneIndexMap;
-	
 	bool mOutputEnabled;
 	
 	static const int kMiscStringSize{256};
 	void loadZonesFromString(const std::string& zoneStr);
 	
 	void doInfrequentTasks();
+	void registerMetrics();
 	uint64_t mLastInfrequentTaskTime;
 	
 	int mSerialNumber;
@@ -179,21 +226,17 @@ private:
 	SoundplaneMIDIOutput mMIDIOutput;
 	SoundplaneOSCOutput mOSCOutput;
 	
-	SensorFrame mSensorFrame{};
-	SensorFrame mCalibratedFrame{};
-	
-	MLSignal mSurface;
-	
+
 	int	mMaxTouches;
 	
 	MLSignal mTouchFrame;
-	std::mutex mTouchFrameMutex;
 	MLSignal mTouchHistory;
 	
 	bool mCalibrating;
 	bool mSelectingCarriers;
 	bool mRaw;
 	bool mSendMatrixData;
+	bool mSendStats{false};
 	
 	SoundplaneDriver::Carriers mCarriers;
 	
@@ -202,15 +245,10 @@ private:
 	SensorFrameStats mStats;
 	SensorFrame mCalibrateMeanInv{};
 	
-	MLSignal mRawSignal;
-	std::mutex mRawSignalMutex;
-	
-	MLSignal mCalibratedSignal;
-	std::mutex mCalibratedSignalMutex;
-	
-	SensorFrame mSmoothedFrame{};
-	MLSignal mSmoothedSignal;
-	std::mutex mSmoothedSignalMutex;
+	TripleBuffer<SensorFrame> mRawSnapshot;
+	TripleBuffer<SensorFrame> mCalibratedSnapshot;
+	TripleBuffer<SensorFrame> mSmoothedSnapshot;
+	TripleBuffer<TouchArray> mTouchSnapshot;
 	
 	int mCalibrateStep; // calibrate step from 0 - end
 	int mTotalCalibrateSteps;
@@ -219,15 +257,17 @@ private:
 	float mSurfaceWidthInv;
 	float mSurfaceHeightInv;
 	
-	// store current key for each touch to implement hysteresis.
-	int mCurrentKeyX[kMaxTouches];
-	int mCurrentKeyY[kMaxTouches];
-	
 	char mHardwareStr[kMiscStringSize];
 	char mStatusStr[kMiscStringSize];
 	char mClientStr[kMiscStringSize];
 	
-	TouchTracker mTracker;
+	// the tracker and zones at each touch capacity. Settings and zones go to all of them, and
+	// the process thread tracks with the smallest one that holds mMaxTouches, see getTracking().
+	SoundplaneTrackingN<kMinTouchCapacity> mSmallTracking;
+	SoundplaneTrackingN<kDefaultTouchCapacity> mDefaultTracking;
+	SoundplaneTrackingN<kMaxTouches> mLargeTracking;
+	const std::array<SoundplaneTrackingBase*, 3> mTrackings{{&mSmallTracking, &mDefaultTracking, &mLargeTracking}};
+	std::atomic<SoundplaneTrackingBase*> mpTracking{&mDefaultTracking};
 	
 	int mHistoryCtr;
 	bool mCarrierMaskDirty;
@@ -253,11 +293,15 @@ private:
 	int mProcessCounter{0};
 	void processThread();
 	std::thread mProcessThread;
+	time_point<steady_clock> mNextInfrequentTasksTime{};
 	
-	size_t kMaxQueueSize{0};
+	uint64_t mPrevOverflowCount{0};
 	
 	int mDataRate{100};
-	time_point<system_clock> mPrevProcessTouchesTime{};
+	time_point<steady_clock> mPrevProcessTouchesTime{};
+	
+	// system time minus steady time, for stamping outputs with the frames' times.
+	system_clock::duration mClockOffset{};
 };
 
 #endif // __SOUNDPLANE_MODEL__
@@ -5,6 +5,8 @@
 
 #include "SoundplaneOSCOutput.h"
 
+#include <algorithm>
+
 using namespace ml;
 
 const char* kDefaultHostnameString = "localhost";
@@ -66,7 +68,7 @@ void SoundplaneOSCOutput::reconnect()
 			*p << (osc::int32)mDataRate;
 			*p << osc::EndMessage;
 			*p << osc::EndBundle;
-			socket->Send( p->Data(), p->Size() );
+			sendPacket(socket, p);
 			
 			MLConsole() << "                     connected to port " << mCurrentBaseUDPPort + portOffset << "\n";
 		}
@@ -111,6 +113,13 @@ UdpTransmitSocket* SoundplaneOSCOutput::getTransmitSocketForOffset(int portOffse
 	return &(*mUDPSockets[portOffset]);
 }
 
+void SoundplaneOSCOutput::sendPacket(UdpTransmitSocket* socket, osc::OutboundPacketStream* p)
+{
+	socket->Send( p->Data(), p->Size() );
+	mPacketsSent.add();
+	mBytesSent.add(p->Size());
+}
+
 const ml::Symbol startFrameSym("start_frame");
 const ml::Symbol touchSym("touch");
 const ml::Symbol onSym("on");
@@ -133,7 +142,7 @@ void SoundplaneOSCOutput::beginOutputFrame(time_point<system_clock> now)
 	// update all voice states
 	for(int offset=0; offset < kNumUDPPorts; ++offset)
 	{
-		for(int voiceIdx=0; voiceIdx < kMaxTouches; ++voiceIdx)
+		for(int voiceIdx=0; voiceIdx < mMaxTouches; ++voiceIdx)
 		{
 			Touch& t = (mTouchesByPort[offset])[voiceIdx];
 			if (t.state == kTouchStateOff)
@@ -144,6 +153,17 @@ void SoundplaneOSCOutput::beginOutputFrame(time_point<system_clock> now)
 	}
 }
 
+void SoundplaneOSCOutput::setMaxTouches(int t)
+{
+	mMaxTouches = ml::clamp(t, 0, kMaxTouches);
+	
+	// forget touches past the new maximum, so they are not sent if it goes back up.
+	for(TouchArray& touches : mTouchesByPort)
+	{
+		std::fill(touches.begin() + mMaxTouches, touches.end(), Touch());
+	}
+}
+
 void SoundplaneOSCOutput::processTouch(int i, int offset, const Touch& t)
 {
 	// store incoming touch by port offset and index
@@ -189,7 +209,7 @@ void SoundplaneOSCOutput::sendFrame()
 			UdpTransmitSocket* socket = getTransmitSocketForOffset(portOffset);
 			if((!p) || (!socket)) return;
 			
-			TextFragment ctrlStr(TextFragment("/"), c.name);
+			TextFragment ctrlStr(TextFragment("/"), TextFragment(c.name));
 			
 			*p << osc::BeginMessage( ctrlStr.getText() );
 			switch(c.type)
@@ -213,7 +233,7 @@ void SoundplaneOSCOutput::sendFrame()
 			}
 			*p << osc::EndMessage;
 			
-			socket->Send( p->Data(), p->Size() );
+			sendPacket(socket, p);
 			
 			// clear
 			c.active = false;
@@ -237,7 +257,7 @@ void SoundplaneOSCOutput::sendFrame()
 		*p << mFrameId++ << mSerialNumber;
 		*p << osc::EndMessage;
 		
-		for(int voiceIdx=0; voiceIdx < kMaxTouches; ++voiceIdx)
+		for(int voiceIdx=0; voiceIdx < mMaxTouches; ++voiceIdx)
 		{
 			Touch& t = mTouchesByPort[portOffset][voiceIdx];
 			
@@ -256,7 +276,7 @@ void SoundplaneOSCOutput::sendFrame()
 		}
 		
 		*p << osc::EndBundle;
-		socket->Send( p->Data(), p->Size() );
+		sendPacket(socket, p);
 	}
 }
 
@@ -267,7 +287,7 @@ void SoundplaneOSCOutput::sendFrameToKyma()
 	if((!p) || (!socket)) return;
 	
 	*p << osc::BeginBundleImmediate;
-	for(int voiceIdx=0; voiceIdx < kMaxTouches; ++voiceIdx)
+	for(int voiceIdx=0; voiceIdx < mMaxTouches; ++voiceIdx)
 	{
 		Touch& t = mTouchesByPort[0][voiceIdx];
 		osc::int32 touchID = voiceIdx; // 0-based for Kyma
@@ -296,7 +316,7 @@ void SoundplaneOSCOutput::sendFrameToKyma()
 	}
 	
 	*p << osc::EndBundle;
-	socket->Send( p->Data(), p->Size() );
+	sendPacket(socket, p);
 }
 
 void SoundplaneOSCOutput::doInfrequentTasks()
@@ -325,7 +345,7 @@ void SoundplaneOSCOutput::sendInfrequentData()
 		*p << (osc::int32)mDataRate;
 		*p << osc::EndMessage;
 		*p << osc::EndBundle;
-		socket->Send( p->Data(), p->Size() );
+		sendPacket(socket, p);
 	}
 }
 
@@ -346,7 +366,7 @@ void SoundplaneOSCOutput::sendInfrequentDataToKyma()
 	*p << (osc::int32)1;
 	*p << osc::EndMessage;
 	*p << osc::EndBundle;
-	socket->Send( p->Data(), p->Size() );
+	sendPacket(socket, p);
 	
 	// send data rate to receiver
 	*p << osc::BeginBundleImmediate;
@@ -354,21 +374,46 @@ void SoundplaneOSCOutput::sendInfrequentDataToKyma()
 	*p << (osc::int32)mDataRate;
 	*p << osc::EndMessage;
 	*p << osc::EndBundle;
-	socket->Send( p->Data(), p->Size() );
+	sendPacket(socket, p);
 }
 
 
-void SoundplaneOSCOutput::processMatrix(const MLSignal& m)
+// send each value in the registry as a /t3d/stats message: serial number, name, value.
+void SoundplaneOSCOutput::sendStats(const MetricsRegistry& metrics)
+{
+	osc::OutboundPacketStream* p = getPacketStreamForOffset(0);
+	UdpTransmitSocket* socket = getTransmitSocketForOffset(0);
+	if((!p) || (!socket)) return;
+	
+	try
+	{
+		*p << osc::BeginBundleImmediate;
+		metrics.forEachValue([&](const std::string& name, int64_t value)
+		{
+			*p << osc::BeginMessage( "/t3d/stats" );
+			*p << (osc::int32)mSerialNumber << name.c_str() << (osc::int64)value;
+			*p << osc::EndMessage;
+		});
+		*p << osc::EndBundle;
+		sendPacket(socket, p);
+	}
+	catch(osc::OutOfBufferMemoryException&)
+	{
+		MLConsole() << "SoundplaneOSCOutput: too many stats for one packet\n";
+	}
+}
+
+void SoundplaneOSCOutput::processMatrix(const SensorFrame& m)
 {
 	osc::OutboundPacketStream* p = getPacketStreamForOffset(0);
 	UdpTransmitSocket* socket = getTransmitSocketForOffset(0);
 	if((!p) || (!socket)) return;
 	
 	*p << osc::BeginMessage( "/t3d/matrix" );
-	*p << osc::Blob( m.getConstBuffer(), m.getSize()*sizeof(float) );
+	*p << osc::Blob( m.data(), m.size()*sizeof(float) );
 	*p << osc::EndMessage;
 	
-	socket->Send( p->Data(), p->Size() );
+	sendPacket(socket, p);
 }
 
 
@@ -19,6 +19,7 @@
 #include "JuceHeader.h"
 
 #include "Controller.h"
+#include "Metrics.h"
 #include "Touch.h"
 
 #include "OSC/osc/OscOutboundPacketStream.h"
@@ -53,18 +54,25 @@ public:
 	void setDataRate(int r) { mDataRate = r; }
 	
 	void setActive(bool v);
-	void setMaxTouches(int t) { mMaxTouches = ml::clamp(t, 0, kMaxTouches); }
+	void setMaxTouches(int t);
 	
 	void setSerialNumber(int s) { mSerialNumber = s; }
 	void notify(int connected);
 	void doInfrequentTasks();
 	
-	void processMatrix(const MLSignal& m);
+	void processMatrix(const SensorFrame& m);
+	
+	// send the current values of the metrics to the first port as /t3d/stats messages.
+	void sendStats(const MetricsRegistry& metrics);
+	
+	const MetricCounter& getPacketsSent() const { return mPacketsSent; }
+	const MetricCounter& getBytesSent() const { return mBytesSent; }
 	
 private:
 	void initializeSocket(int port);
 	osc::OutboundPacketStream* getPacketStreamForOffset(int offset);
 	UdpTransmitSocket* getTransmitSocketForOffset(int portOffset);
+	void sendPacket(UdpTransmitSocket* socket, osc::OutboundPacketStream* p);
 	
 	void sendFrame();
 	void sendFrameToKyma();
@@ -72,7 +80,8 @@ private:
 	void sendInfrequentData();
 	void sendInfrequentDataToKyma();
 	
-	int mMaxTouches;
+	// touches past the most the model tracks are never sent, so frames skip them.
+	int mMaxTouches{kMaxTouches};
 	
 	std::array< TouchArray, kNumUDPPorts > mTouchesByPort;
 	std::array< Controller, kSoundplaneAMaxZones > mControllersByZone;
@@ -91,6 +100,9 @@ private:
 	int mSerialNumber;
 	
 	bool mKymaMode;
+	
+	MetricCounter mPacketsSent;
+	MetricCounter mBytesSent;
 };
 
 
@@ -42,8 +42,8 @@ void SoundplaneTouchGraphView::renderTouchBarGraphs()
     int viewH = getBackingLayerHeight();
 	int viewScale = getRenderingScale();
 	
-	const MLSignal& currentTouch = mpModel->getTouchFrame();
 	const MLSignal& touchHistory = mpModel->getTouchHistory();
+	const int currentTime = mpModel->getHistoryCtr();
 	const int frames = mpModel->getFloatProperty("max_touches");
 	if (!frames) return;
 				
@@ -90,7 +90,7 @@ void SoundplaneTouchGraphView::renderTouchBarGraphs()
 		glColor4fv(indLight);		
 		MLRect r(0, 0, numSize, numSize);		
 		MLRect tr = r.translated(Vec2(margin, margin + j*frameOffset + (frameHeight - numSize)/2));				
-		int age = currentTouch(ageColumn, j);		
+		int age = touchHistory(ageColumn, j, currentTime);		
 		if (age > 0)
 		{
 			glColor4fv(indLight);
@@ -393,7 +393,7 @@ mpMidiChannelDial(0)
 	// ----
 	
 	pD = page1->addDial("touches", dialRect.withCenter(0.5, dialY), "max_touches", c2);
-	pD->setRange(0., 16., 1.);
+	pD->setRange(0., kMaxTouches, 1.);
 	pD->setDefault(4);
 	
 	pB = page1->addToggleButton("rotate", toggleRect.withCenter(1.5, dialY), "rotate", c2);
@@ -478,6 +478,9 @@ void SoundplaneView::doPropertyChangeAction(ml::Symbol p, const MLProperty & val
 	{
 		handled = true;
 		const ml::Text v = val.getTextValue();
+		
+		// the model only keeps raw frames up to date while they are being viewed.
+		mpModel->setRaw(v == "raw data");
 		if(v == "raw data")
 		{
 			makeCarrierTogglesVisible(1);
@@ -649,4 +652,4 @@ void SoundplaneView::nextPage()
 		goToPage(page + 1);
 	}
 }
-
+
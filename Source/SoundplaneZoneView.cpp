@@ -124,11 +124,11 @@ void SoundplaneZoneView::renderZones()
     
    // float strokeWidth = viewW / 100;    
     
-    for(auto it = mpModel->getZonesBegin(); it != mpModel->getZonesEnd(); ++it)
+    for(int z = 0; z < mpModel->getNumZones(); ++z)
     {
-        const Zone& zone = *it;
+        const Zone zone = mpModel->getZone(z);
 
-        MLRect zr = zone.getBounds();
+        KeyRect zr = zone.getBounds();
         int offset = zone.getOffset();
         
         MLRange unityToKeyX(0.f, 1.f, zr.left(), zr.right());
@@ -158,7 +158,7 @@ void SoundplaneZoneView::renderZones()
         
         // draw name
         // all these rect calculations read upside-down here because view origin is at bottom
-        TextFragment nameFrag = zone.getName();
+        TextFragment nameFrag(zone.getName().c_str());
         MLGL::drawTextAt(zoneRectInView.left() + lineWidth, zoneRectInView.top() + lineWidth, 0.f, 0.1f, viewScale, nameFrag.getText());
         
         // draw zone-specific things
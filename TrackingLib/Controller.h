@@ -7,9 +7,7 @@
 
 #pragma once
 
-#include "MLText.h"
-
-using namespace ml;
+#include <array>
 
 constexpr int kMaxControllers = 128;
 
@@ -24,7 +22,7 @@ enum ControllerType
 
 struct Controller
 {
-    TextFragment name;
+    const char* name;
     bool active;
     int number1;
     int number2;
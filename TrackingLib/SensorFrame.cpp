@@ -0,0 +1,343 @@
+// geometry for Soundplane Model A.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "SensorFrame.h"
+#include "SensorFrameKernels.h"
+#include <iostream>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+template <class c>
+c (clamp)(const c& x, const c& min, const c& max)
+{
+	return (x < min) ? min : (x > max ? max : x);
+}
+
+float get(const SensorFrame& a, int col, int row)
+{
+	return a[row*SensorGeometry::width + col];
+}
+
+void set(SensorFrame& a, int col, int row, float val)
+{
+	a[row*SensorGeometry::width + col] = val;
+}
+
+float getColumnSum(const SensorFrame& a, int col)
+{
+	float sum = 0.f;
+	for(int j=0; j<SensorGeometry::height; ++j)
+	{
+		sum += get(a, col, j);
+	}
+	return sum;
+}
+
+// --------------------------------------------------------------------------------
+// output-parameter operations. These call the SIMD kernels for the current CPU,
+// see SensorFrameKernels.h. out may be the same frame as any input.
+
+namespace
+{
+	inline const SensorFrameKernels& kernels()
+	{
+		static const SensorFrameKernels& k = getSensorFrameKernels();
+		return k;
+	}
+}
+
+void add(SensorFrame& out, const SensorFrame& a, const SensorFrame& b)
+{
+	kernels().add(out.data(), a.data(), b.data());
+}
+
+void subtract(SensorFrame& out, const SensorFrame& a, const SensorFrame& b)
+{
+	kernels().subtract(out.data(), a.data(), b.data());
+}
+
+void multiply(SensorFrame& out, const SensorFrame& a, const SensorFrame& b)
+{
+	kernels().multiply(out.data(), a.data(), b.data());
+}
+
+void divide(SensorFrame& out, const SensorFrame& a, const SensorFrame& b)
+{
+	kernels().divide(out.data(), a.data(), b.data());
+}
+
+void add(SensorFrame& out, const SensorFrame& a, const float k)
+{
+	kernels().addScalar(out.data(), a.data(), k);
+}
+
+void subtract(SensorFrame& out, const SensorFrame& a, const float k)
+{
+	kernels().subtractScalar(out.data(), a.data(), k);
+}
+
+void multiply(SensorFrame& out, const SensorFrame& a, const float k)
+{
+	kernels().multiplyScalar(out.data(), a.data(), k);
+}
+
+void divide(SensorFrame& out, const SensorFrame& a, const float k)
+{
+	kernels().divideScalar(out.data(), a.data(), k);
+}
+
+void fill(SensorFrame& out, const float k)
+{
+	kernels().fill(out.data(), k);
+}
+
+void max(SensorFrame& out, const SensorFrame& b, const float k)
+{
+	kernels().max(out.data(), b.data(), k);
+}
+
+void min(SensorFrame& out, const SensorFrame& b, const float k)
+{
+	kernels().min(out.data(), b.data(), k);
+}
+
+void clamp(SensorFrame& out, const SensorFrame& b, const float k, const float m)
+{
+	kernels().clamp(out.data(), b.data(), k, m);
+}
+
+void sqrt(SensorFrame& out, const SensorFrame& b)
+{
+	kernels().sqrt(out.data(), b.data());
+}
+
+void axpy(SensorFrame& y, const float a, const SensorFrame& x)
+{
+	kernels().axpy(y.data(), a, x.data());
+}
+
+void scaleOffset(SensorFrame& out, const SensorFrame& in, const float scale, const float offset)
+{
+	kernels().scaleOffset(out.data(), in.data(), scale, offset);
+}
+
+void scaleOffset(SensorFrame& out, const SensorFrame& in, const SensorFrame& scale, const float offset)
+{
+	kernels().scaleOffsetFrame(out.data(), in.data(), scale.data(), offset);
+}
+
+void getCurvatureX(SensorFrame& out, const SensorFrame& in)
+{
+	kernels().curvatureX(out.data(), in.data());
+}
+
+void getCurvatureY(SensorFrame& out, const SensorFrame& in)
+{
+	kernels().curvatureY(out.data(), in.data());
+}
+
+// sqrt(curvatureX * curvatureY), computed in one pass. The results are identical to
+// sqrt(multiply(getCurvatureX(in), getCurvatureY(in))).
+void getCurvatureXY(SensorFrame& out, const SensorFrame& in)
+{
+	kernels().curvatureXY(out.data(), in.data());
+}
+
+void smooth(SensorFrame& out, const SensorFrame& in, const SmoothingWeights& weights)
+{
+	kernels().smooth(out.data(), in.data(), weights.x[0].data(), weights.y[0].data());
+}
+
+void findPeaks(SensorFrameMask& out, const SensorFrame& in, const float threshold)
+{
+	kernels().findPeaks(out.data(), in.data(), threshold);
+}
+
+void calibrate(SensorFrame& out, const SensorFrame& in, const SensorFrame& calibrateMean)
+{
+	divide(out, in, calibrateMean);
+	subtract(out, out, 1.0f);
+}
+
+// --------------------------------------------------------------------------------
+// value-returning operations, implemented with the output-parameter versions above.
+
+SensorFrame add(const SensorFrame& a, const SensorFrame& b)
+{
+	SensorFrame out;
+	add(out, a, b);
+	return out;
+}
+
+SensorFrame subtract(const SensorFrame& a, const SensorFrame& b)
+{
+	SensorFrame out;
+	subtract(out, a, b);
+	return out;
+}
+
+SensorFrame multiply(const SensorFrame& a, const SensorFrame& b)
+{
+	SensorFrame out;
+	multiply(out, a, b);
+	return out;
+}
+
+SensorFrame divide(const SensorFrame& a, const SensorFrame& b)
+{
+	SensorFrame out;
+	divide(out, a, b);
+	return out;
+}
+
+SensorFrame add(const SensorFrame& a, const float k)
+{
+	SensorFrame out;
+	add(out, a, k);
+	return out;
+}
+
+SensorFrame subtract(const SensorFrame& a, const float k)
+{
+	SensorFrame out;
+	subtract(out, a, k);
+	return out;
+}
+
+SensorFrame multiply(const SensorFrame& a, const float k)
+{
+	SensorFrame out;
+	multiply(out, a, k);
+	return out;
+}
+
+SensorFrame divide(const SensorFrame& a, const float k)
+{
+	SensorFrame out;
+	divide(out, a, k);
+	return out;
+}
+
+SensorFrame fill(const float k)
+{
+	SensorFrame out;
+	fill(out, k);
+	return out;
+}
+
+SensorFrame max(const SensorFrame& b, const float k)
+{
+	SensorFrame out;
+	max(out, b, k);
+	return out;
+}
+
+SensorFrame min(const SensorFrame& b, const float k)
+{
+	SensorFrame out;
+	min(out, b, k);
+	return out;
+}
+
+SensorFrame clamp(const SensorFrame& b, const float k, const float m)
+{
+	SensorFrame out;
+	clamp(out, b, k, m);
+	return out;
+}
+
+SensorFrame sqrt(const SensorFrame& b)
+{
+	SensorFrame out;
+	sqrt(out, b);
+	return out;
+}
+
+SensorFrame getCurvatureX(const SensorFrame& in)
+{
+	SensorFrame out;
+	getCurvatureX(out, in);
+	return out;
+}
+
+SensorFrame getCurvatureY(const SensorFrame& in)
+{
+	SensorFrame out;
+	getCurvatureY(out, in);
+	return out;
+}
+
+SensorFrame getCurvatureXY(const SensorFrame& in)
+{
+	SensorFrame out;
+	getCurvatureXY(out, in);
+	return out;
+} 
+
+SensorFrame calibrate(const SensorFrame& in, const SensorFrame& calibrateMean)
+{
+	SensorFrame out;
+	calibrate(out, in, calibrateMean);
+	return out;
+} 
+
+void dumpFrameAsASCII(std::ostream& s, const SensorFrame& f)
+{
+	const char* g = " .:;+=xX$&";
+	int w = SensorGeometry::width;
+	int h = SensorGeometry::height;
+	
+	int scale = static_cast<int>(strlen(g));
+	for (int j=0; j<h; ++j)
+	{
+		s << "|";
+		for(int i=0; i<w; ++i)
+		{
+			int v = (f[j*w + i]*scale);
+			s << g[clamp(v, 0, scale - 1)];
+		}
+		s << "|\n";
+	}
+}
+
+void dumpFrame(std::ostream& s, const SensorFrame& f)
+{
+	int w = SensorGeometry::width;
+	int h = SensorGeometry::height;
+	
+	for (int j=0; j<h; ++j)
+	{
+		for(int i=0; i<w; ++i)
+		{
+			float v = f[j*w + i];
+			
+			printf("%2.2f ", v);
+
+		}
+		std::cout << "\n";
+	}
+}
+
+void dumpFrameStats(std::ostream& s, const SensorFrame& f)
+{
+	int w = SensorGeometry::width;
+	int h = SensorGeometry::height;
+	
+	float min = MAXFLOAT;
+	float max = -min;
+	float sum = 0.f;
+	for (int j=0; j<h; ++j)
+	{
+		for(int i=0; i<w; ++i)
+		{
+			float v = f[j*w + i];
+			
+			sum += v;
+			min = std::min(min, v);
+			max = std::max(max, v);
+		}
+	}
+	s << "min: " << min << " max: " << max << " sum: " << sum << "\n";
+}
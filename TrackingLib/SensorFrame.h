@@ -0,0 +1,180 @@
+// geometry for Soundplane Model A.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+
+namespace SensorGeometry
+{
+    constexpr int width = 64;
+    constexpr int height = 8;
+    constexpr int elements = width*height;
+};
+
+// frames per second from each sensor board.
+const float kSoundplaneFrameRate = 976.5625f;
+
+// the grid of keys marked on the surface, which zones are laid out on.
+const int kSoundplaneAKeyWidth = 30;
+const int kSoundplaneAKeyHeight = 5;
+const int kSoundplaneAMaxZones = 150;
+
+typedef std::array<float, SensorGeometry::elements> SensorFrame;
+
+// the size of the separable kernel used by smooth().
+const int kSmoothXRadius = 4;
+const int kSmoothYRadius = 3;
+const int kSmoothXTaps = 2*kSmoothXRadius + 1;
+const int kSmoothYTaps = 2*kSmoothYRadius + 1;
+
+// one bit for each taxel of a frame: bit i of row j is the taxel in column i.
+static_assert(SensorGeometry::width <= 64, "a row must fit in a mask");
+typedef std::array<uint64_t, SensorGeometry::height> SensorFrameMask;
+
+float get(const SensorFrame& a, int col, int row);
+void set(SensorFrame& a, int col, int row, float val);
+float getColumnSum(const SensorFrame& a, int col);
+
+SensorFrame add(const SensorFrame& a, const SensorFrame& b);
+SensorFrame subtract(const SensorFrame& a, const SensorFrame& b);
+SensorFrame multiply(const SensorFrame& a, const SensorFrame& b);
+SensorFrame divide(const SensorFrame& a, const SensorFrame& b);
+
+SensorFrame add(const SensorFrame& a, const float k);
+SensorFrame subtract(const SensorFrame& a, const float k);
+SensorFrame multiply(const SensorFrame& a, const float k);
+SensorFrame divide(const SensorFrame& a, const float k);
+
+SensorFrame fill(const float k);
+
+SensorFrame max(const SensorFrame& b, const float k);
+SensorFrame min(const SensorFrame& b, const float k);
+SensorFrame clamp(const SensorFrame& b, const float k, const float m);
+SensorFrame sqrt(const SensorFrame& b);
+SensorFrame getCurvatureX(const SensorFrame& in);
+SensorFrame getCurvatureY(const SensorFrame& in);
+SensorFrame getCurvatureXY(const SensorFrame& in);
+SensorFrame calibrate(const SensorFrame& in, const SensorFrame& calibrateMean);
+
+// output-parameter versions of the operations above. These write their result to out
+// and never allocate or copy a temporary frame, so they are suitable for the per-frame
+// processing path. out may be the same frame as any of the inputs.
+
+void add(SensorFrame& out, const SensorFrame& a, const SensorFrame& b);
+void subtract(SensorFrame& out, const SensorFrame& a, const SensorFrame& b);
+void multiply(SensorFrame& out, const SensorFrame& a, const SensorFrame& b);
+void divide(SensorFrame& out, const SensorFrame& a, const SensorFrame& b);
+
+void add(SensorFrame& out, const SensorFrame& a, const float k);
+void subtract(SensorFrame& out, const SensorFrame& a, const float k);
+void multiply(SensorFrame& out, const SensorFrame& a, const float k);
+void divide(SensorFrame& out, const SensorFrame& a, const float k);
+
+void fill(SensorFrame& out, const float k);
+
+void max(SensorFrame& out, const SensorFrame& b, const float k);
+void min(SensorFrame& out, const SensorFrame& b, const float k);
+void clamp(SensorFrame& out, const SensorFrame& b, const float k, const float m);
+void sqrt(SensorFrame& out, const SensorFrame& b);
+void getCurvatureX(SensorFrame& out, const SensorFrame& in);
+void getCurvatureY(SensorFrame& out, const SensorFrame& in);
+void getCurvatureXY(SensorFrame& out, const SensorFrame& in);
+void calibrate(SensorFrame& out, const SensorFrame& in, const SensorFrame& calibrateMean);
+
+// mark the peaks of in: the taxels above threshold and greater than each of their eight
+// neighbors. Neighbors outside the frame don't count, and the edge columns are never peaks.
+void findPeaks(SensorFrameMask& out, const SensorFrame& in, const float threshold);
+
+// weights of a separable smoothing kernel. Every output column and row has its own taps, so that
+// a kernel can treat the frame as zero outside its edges in any way it likes.
+struct SmoothingWeights
+{
+	// x[t][i]: weight of input column (i + t - kSmoothXRadius) for output column i.
+	std::array<std::array<float, SensorGeometry::width>, kSmoothXTaps> x;
+	
+	// y[j][t]: weight of input row (j + t - kSmoothYRadius) for output row j.
+	std::array<std::array<float, kSmoothYTaps>, SensorGeometry::height> y;
+};
+
+// smooth each row of in with the x weights, then each column of the result with the y weights.
+// Inputs outside the frame are zero. Each output is summed over its taps in order.
+void smooth(SensorFrame& out, const SensorFrame& in, const SmoothingWeights& weights);
+
+// fused operations.
+// y = y + a*x
+void axpy(SensorFrame& y, const float a, const SensorFrame& x);
+// out = in*scale + offset
+void scaleOffset(SensorFrame& out, const SensorFrame& in, const float scale, const float offset);
+// out = in*scale + offset, with a separate scale for each element.
+void scaleOffset(SensorFrame& out, const SensorFrame& in, const SensorFrame& scale, const float offset);
+
+void dumpFrameAsASCII(std::ostream& s, const SensorFrame& f);
+void dumpFrame(std::ostream& s, const SensorFrame& f);
+void dumpFrameStats(std::ostream& s, const SensorFrame& f);
+
+class SensorFrameStats
+{
+public:
+	SensorFrameStats() : mCount(0) {}
+	
+	void clear()
+	{
+		mCount = 0;
+	}
+	
+	void accumulate(const SensorFrame& x)
+	{
+		mCount++;
+		
+		// compute a running mean.
+		// See Knuth TAOCP vol 2, 3rd edition, page 232
+		if (mCount == 1)
+		{
+			m_newM = x;
+			fill(m_newS, 0.f);
+		}
+		else
+		{
+			// update mean and sum of squares in place, one element at a time.
+			const float n = mCount;
+			for(int i=0; i<SensorGeometry::elements; ++i)
+			{
+				const float oldM = m_newM[i];
+				const float newM = oldM + (x[i] - oldM)/n;
+				m_newS[i] += (x[i] - oldM)*(x[i] - newM);
+				m_newM[i] = newM;
+			}
+		}
+	}
+	
+	int getCount()
+	{
+		return mCount;
+	}
+	
+	SensorFrame mean() const
+	{
+		return (mCount > 0) ? m_newM : fill(0.0);
+	}
+	
+	SensorFrame variance() const
+	{
+		return ( (mCount > 1) ? divide(m_newS, (mCount - 1)) : fill(0.0) );
+	}
+	
+	SensorFrame standardDeviation() const
+	{
+		return sqrt( variance() );
+	}
+	
+private:
+	int mCount;
+	SensorFrame m_newM, m_newS;
+};
+
+
+
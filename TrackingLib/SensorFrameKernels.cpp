@@ -0,0 +1,410 @@
+// SensorFrameKernels.cpp
+//
+// Scalar reference kernels for SensorFrame operations, and selection of the best
+// kernels for the CPU at runtime.
+
+#include "SensorFrameKernels.h"
+#include "SensorFrame.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+constexpr int kWidth = SensorGeometry::width;
+constexpr int kHeight = SensorGeometry::height;
+constexpr int kElements = SensorGeometry::elements;
+
+void addScalarKernel(float* out, const float* a, const float* b)
+{
+	for(int i=0; i<kElements; ++i)
+	{
+		out[i] = a[i] + b[i];
+	}
+}
+
+void subtractScalarKernel(float* out, const float* a, const float* b)
+{
+	for(int i=0; i<kElements; ++i)
+	{
+		out[i] = a[i] - b[i];
+	}
+}
+
+void multiplyScalarKernel(float* out, const float* a, const float* b)
+{
+	for(int i=0; i<kElements; ++i)
+	{
+		out[i] = a[i]*b[i];
+	}
+}
+
+void divideScalarKernel(float* out, const float* a, const float* b)
+{
+	for(int i=0; i<kElements; ++i)
+	{
+		out[i] = a[i]/b[i];
+	}
+}
+
+void addKScalarKernel(float* out, const float* a, float k)
+{
+	for(int i=0; i<kElements; ++i)
+	{
+		out[i] = a[i] + k;
+	}
+}
+
+void subtractKScalarKernel(float* out, const float* a, float k)
+{
+	for(int i=0; i<kElements; ++i)
+	{
+		out[i] = a[i] - k;
+	}
+}
+
+void multiplyKScalarKernel(float* out, const float* a, float k)
+{
+	for(int i=0; i<kElements; ++i)
+	{
+		out[i] = a[i]*k;
+	}
+}
+
+void divideKScalarKernel(float* out, const float* a, float k)
+{
+	for(int i=0; i<kElements; ++i)
+	{
+		out[i] = a[i]/k;
+	}
+}
+
+void maxScalarKernel(float* out, const float* a, float k)
+{
+	for(int i=0; i<kElements; ++i)
+	{
+		out[i] = std::max(a[i], k);
+	}
+}
+
+void minScalarKernel(float* out, const float* a, float k)
+{
+	for(int i=0; i<kElements; ++i)
+	{
+		out[i] = std::min(a[i], k);
+	}
+}
+
+void fillScalarKernel(float* out, float k)
+{
+	for(int i=0; i<kElements; ++i)
+	{
+		out[i] = k;
+	}
+}
+
+void clampScalarKernel(float* out, const float* a, float lo, float hi)
+{
+	for(int i=0; i<kElements; ++i)
+	{
+		const float x = a[i];
+		out[i] = (x < lo) ? lo : (x > hi ? hi : x);
+	}
+}
+
+void sqrtScalarKernel(float* out, const float* a)
+{
+	for(int i=0; i<kElements; ++i)
+	{
+		out[i] = sqrtf(a[i]);
+	}
+}
+
+// products and sums are kept in separate statements so that the compiler
+// will not contract them into fused multiply-adds.
+
+void axpyScalarKernel(float* y, float a, const float* x)
+{
+	for(int i=0; i<kElements; ++i)
+	{
+		const float ax = a*x[i];
+		y[i] += ax;
+	}
+}
+
+void scaleOffsetScalarKernel(float* out, const float* in, float scale, float offset)
+{
+	for(int i=0; i<kElements; ++i)
+	{
+		const float scaled = in[i]*scale;
+		out[i] = scaled + offset;
+	}
+}
+
+void scaleOffsetFrameScalarKernel(float* out, const float* in, const float* scale, float offset)
+{
+	for(int i=0; i<kElements; ++i)
+	{
+		const float scaled = in[i]*scale[i];
+		out[i] = scaled + offset;
+	}
+}
+
+// the curvature of each taxel is the negative second difference of its neighbors,
+// with the surface treated as zero outside its edges. The output element at i-1 is
+// written only after the input element at i is read, so in-place use is safe.
+void curvatureXScalarKernel(float* out, const float* in)
+{
+	// rows
+	for(int j=0; j<kHeight; ++j)
+	{
+		float z = 0.f;
+		float zm1 = 0.f;
+		float dz = 0.f;
+		float dzm1 = 0.f;
+		float ddz = 0.f;
+
+		for(int i=0; i <= kWidth; ++i)
+		{
+			z = (i < kWidth) ? in[j*kWidth + i] : 0.f;
+			dz = z - zm1;
+			ddz = dz - dzm1;
+			zm1 = z;
+			dzm1 = dz;
+
+			if(i >= 1)
+			{
+				out[j*kWidth + i - 1] = std::max(-ddz, 0.f);
+			}
+		}
+	}
+}
+
+void curvatureYScalarKernel(float* out, const float* in)
+{
+	// cols
+	for(int i=0; i<kWidth; ++i)
+	{
+		float z = 0.f;
+		float zm1 = 0.f;
+		float dz = 0.f;
+		float dzm1 = 0.f;
+		float ddz = 0.f;
+
+		for(int j=0; j <= kHeight; ++j)
+		{
+			z = (j < kHeight) ? in[j*kWidth + i] : 0.f;
+			dz = z - zm1;
+			ddz = dz - dzm1;
+			zm1 = z;
+			dzm1 = dz;
+
+			if(j >= 1)
+			{
+				out[(j - 1)*kWidth + i] = std::max(-ddz, 0.f);
+			}
+		}
+	}
+}
+
+// compute sqrt(curvatureX * curvatureY) in one pass. The differences are taken in the same
+// order as in the X and Y kernels, so the results are identical to computing them separately.
+// Copies of the input rows above and at the current row are kept for in-place use.
+void curvatureXYScalarKernel(float* out, const float* in)
+{
+	float rowAbove[kWidth] = {};
+	float row[kWidth];
+	float rowBelow[kWidth];
+
+	std::copy(in, in + kWidth, row);
+	for(int j=0; j<kHeight; ++j)
+	{
+		if(j + 1 < kHeight)
+		{
+			std::copy(in + (j + 1)*kWidth, in + (j + 2)*kWidth, rowBelow);
+		}
+		else
+		{
+			std::fill(rowBelow, rowBelow + kWidth, 0.f);
+		}
+
+		float* pOut = out + j*kWidth;
+		for(int i=0; i<kWidth; ++i)
+		{
+			const float left = (i > 0) ? row[i - 1] : 0.f;
+			const float right = (i < kWidth - 1) ? row[i + 1] : 0.f;
+			const float ddx = (right - row[i]) - (row[i] - left);
+			const float ddy = (rowBelow[i] - row[i]) - (row[i] - rowAbove[i]);
+			pOut[i] = sqrtf(std::max(-ddx, 0.f)*std::max(-ddy, 0.f));
+		}
+
+		std::copy(row, row + kWidth, rowAbove);
+		std::copy(rowBelow, rowBelow + kWidth, row);
+	}
+}
+
+// the x pass reads each row from a copy with kSmoothXRadius zeros on each side, and writes a
+// buffer with kSmoothYRadius rows of zeros above and below, which the y pass reads. The
+// copies make in-place use safe.
+void smoothScalarKernel(float* out, const float* in, const float* xWeights, const float* yWeights)
+{
+	float padded[kWidth + 2*kSmoothXRadius] = {};
+	float* row = padded + kSmoothXRadius;
+	float smoothX[(kHeight + 2*kSmoothYRadius)*kWidth] = {};
+
+	for(int j=0; j<kHeight; ++j)
+	{
+		std::copy(in + j*kWidth, in + (j + 1)*kWidth, row);
+		float* pSmoothX = smoothX + (j + kSmoothYRadius)*kWidth;
+		for(int i=0; i<kWidth; ++i)
+		{
+			float sum = xWeights[i]*row[i - kSmoothXRadius];
+			for(int t=1; t<kSmoothXTaps; ++t)
+			{
+				sum += xWeights[t*kWidth + i]*row[i + t - kSmoothXRadius];
+			}
+			pSmoothX[i] = sum;
+		}
+	}
+
+	for(int j=0; j<kHeight; ++j)
+	{
+		// rows j - kSmoothYRadius to j + kSmoothYRadius
+		const float* pSmoothX = smoothX + j*kWidth;
+		const float* w = yWeights + j*kSmoothYTaps;
+		float* pOut = out + j*kWidth;
+		for(int i=0; i<kWidth; ++i)
+		{
+			float sum = w[0]*pSmoothX[i];
+			for(int t=1; t<kSmoothYTaps; ++t)
+			{
+				sum += w[t]*pSmoothX[t*kWidth + i];
+			}
+			pOut[i] = sum;
+		}
+	}
+}
+
+// the neighbors outside the frame are taken to be at the threshold, so they never stop
+// a peak. Comparisons with NaN are false, so NaN is never a peak or next to one.
+void findPeaksScalarKernel(uint64_t* out, const float* in, float threshold)
+{
+	auto at = [&](int i, int j)
+	{
+		return ((j >= 0) && (j < kHeight)) ? in[j*kWidth + i] : threshold;
+	};
+
+	for(int j=0; j<kHeight; ++j)
+	{
+		uint64_t mask = 0;
+		for(int i=1; i<kWidth - 1; ++i)
+		{
+			const float z = at(i, j);
+			bool peak = (z > threshold);
+			for(int dj=-1; dj<=1; ++dj)
+			{
+				for(int di=-1; di<=1; ++di)
+				{
+					if(di || dj)
+					{
+						peak = peak && (z > at(i + di, j + dj));
+					}
+				}
+			}
+			mask |= static_cast<uint64_t>(peak) << i;
+		}
+		out[j] = mask;
+	}
+}
+
+const SensorFrameKernels kScalarKernels =
+{
+	SensorFrameISA::kScalar,
+	"scalar",
+	addScalarKernel,
+	subtractScalarKernel,
+	multiplyScalarKernel,
+	divideScalarKernel,
+	addKScalarKernel,
+	subtractKScalarKernel,
+	multiplyKScalarKernel,
+	divideKScalarKernel,
+	maxScalarKernel,
+	minScalarKernel,
+	fillScalarKernel,
+	clampScalarKernel,
+	sqrtScalarKernel,
+	axpyScalarKernel,
+	scaleOffsetScalarKernel,
+	scaleOffsetFrameScalarKernel,
+	curvatureXScalarKernel,
+	curvatureYScalarKernel,
+	curvatureXYScalarKernel,
+	smoothScalarKernel,
+	findPeaksScalarKernel
+};
+
+bool cpuSupports(SensorFrameISA isa)
+{
+	switch(isa)
+	{
+		case SensorFrameISA::kScalar:
+			return true;
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+		case SensorFrameISA::kSSE2:
+			return __builtin_cpu_supports("sse2");
+		case SensorFrameISA::kAVX2:
+			return __builtin_cpu_supports("avx2");
+#endif
+#if defined(__aarch64__)
+		case SensorFrameISA::kNEON:
+			// NEON is a required part of ARMv8-A.
+			return true;
+#endif
+		default:
+			return false;
+	}
+}
+
+}
+
+const SensorFrameKernels* getScalarSensorFrameKernels()
+{
+	return &kScalarKernels;
+}
+
+const SensorFrameKernels* getSensorFrameKernels(SensorFrameISA isa)
+{
+	if(!cpuSupports(isa)) return nullptr;
+
+	switch(isa)
+	{
+		case SensorFrameISA::kScalar:
+			return getScalarSensorFrameKernels();
+		case SensorFrameISA::kSSE2:
+			return getSSE2SensorFrameKernels();
+		case SensorFrameISA::kAVX2:
+			return getAVX2SensorFrameKernels();
+		case SensorFrameISA::kNEON:
+			return getNEONSensorFrameKernels();
+	}
+	return nullptr;
+}
+
+const SensorFrameKernels& getSensorFrameKernels()
+{
+	// choose once, in order of preference.
+	static const SensorFrameKernels& kernels = []() -> const SensorFrameKernels&
+	{
+		for(auto isa : {SensorFrameISA::kAVX2, SensorFrameISA::kSSE2, SensorFrameISA::kNEON})
+		{
+			if(const SensorFrameKernels* k = getSensorFrameKernels(isa))
+			{
+				return *k;
+			}
+		}
+		return kScalarKernels;
+	}();
+	return kernels;
+}
@@ -0,0 +1,83 @@
+// SIMD kernels for SensorFrame operations.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <cstdint>
+
+// Each SensorFrame operation is implemented once for every instruction set we support.
+// The best implementation for the CPU we are running on is chosen the first time any
+// SensorFrame operation is called. All pointers point to SensorGeometry::elements floats.
+// Every kernel produces results that are bit-identical to the scalar kernels: only
+// correctly rounded operations (add, subtract, multiply, divide, sqrt, min, max) are
+// used, in the same order as the scalar code, and fused multiply-add instructions are
+// avoided on purpose. Outputs may be the same as any input.
+//
+// Loads and stores are unaligned, because frames only have the alignment of float. On
+// aligned data these are as fast as the aligned versions on any recent CPU.
+
+enum class SensorFrameISA
+{
+	kScalar = 0,
+	kSSE2,
+	kAVX2,
+	kNEON
+};
+
+struct SensorFrameKernels
+{
+	typedef void (*BinaryFn)(float* out, const float* a, const float* b);
+	typedef void (*ScalarFn)(float* out, const float* a, float k);
+	typedef void (*UnaryFn)(float* out, const float* a);
+
+	SensorFrameISA isa;
+	const char* name;
+
+	BinaryFn add;
+	BinaryFn subtract;
+	BinaryFn multiply;
+	BinaryFn divide;
+
+	ScalarFn addScalar;
+	ScalarFn subtractScalar;
+	ScalarFn multiplyScalar;
+	ScalarFn divideScalar;
+	ScalarFn max;
+	ScalarFn min;
+
+	void (*fill)(float* out, float k);
+	void (*clamp)(float* out, const float* a, float lo, float hi);
+	UnaryFn sqrt;
+
+	// y = y + a*x
+	void (*axpy)(float* y, float a, const float* x);
+	// out = in*scale + offset
+	void (*scaleOffset)(float* out, const float* in, float scale, float offset);
+	void (*scaleOffsetFrame)(float* out, const float* in, const float* scale, float offset);
+
+	UnaryFn curvatureX;
+	UnaryFn curvatureY;
+	UnaryFn curvatureXY;
+
+	// separable smoothing, see smooth() in SensorFrame.h. xWeights is kSmoothXTaps rows of
+	// SensorGeometry::width weights, yWeights is SensorGeometry::height rows of kSmoothYTaps.
+	void (*smooth)(float* out, const float* in, const float* xWeights, const float* yWeights);
+
+	// one mask of peaks per row, see findPeaks() in SensorFrame.h.
+	void (*findPeaks)(uint64_t* out, const float* in, float threshold);
+};
+
+// returns the kernels for the best instruction set supported by this CPU.
+const SensorFrameKernels& getSensorFrameKernels();
+
+// returns the kernels for the given instruction set, or nullptr if they are not
+// compiled in or the CPU does not support them. Used for testing and benchmarks.
+const SensorFrameKernels* getSensorFrameKernels(SensorFrameISA isa);
+
+// implementations for each instruction set, defined in the SensorFrameKernels*.cpp files.
+// These return nullptr if not available for the current target.
+const SensorFrameKernels* getScalarSensorFrameKernels();
+const SensorFrameKernels* getSSE2SensorFrameKernels();
+const SensorFrameKernels* getAVX2SensorFrameKernels();
+const SensorFrameKernels* getNEONSensorFrameKernels();
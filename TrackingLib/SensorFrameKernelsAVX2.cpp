@@ -0,0 +1,68 @@
+// SIMD kernels for SensorFrame operations.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "SensorFrameKernels.h"
+#include "SensorFrame.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace
+{
+
+struct AVX2
+{
+	typedef __m256 T;
+	enum { width = 8 };
+
+	static inline T load(const float* p) { return _mm256_loadu_ps(p); }
+	static inline void store(float* p, T a) { _mm256_storeu_ps(p, a); }
+	static inline T set1(float k) { return _mm256_set1_ps(k); }
+	static inline T zero() { return _mm256_setzero_ps(); }
+	static inline T add(T a, T b) { return _mm256_add_ps(a, b); }
+	static inline T sub(T a, T b) { return _mm256_sub_ps(a, b); }
+	static inline T mul(T a, T b) { return _mm256_mul_ps(a, b); }
+	static inline T div(T a, T b) { return _mm256_div_ps(a, b); }
+	static inline T sqrt(T a) { return _mm256_sqrt_ps(a); }
+	static inline T max(T a, T b) { return _mm256_max_ps(a, b); }
+	static inline T min(T a, T b) { return _mm256_min_ps(a, b); }
+	static inline T neg(T a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.f)); }
+	static inline T greater(T a, T b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	static inline T bitAnd(T a, T b) { return _mm256_and_ps(a, b); }
+	static inline int signBits(T a) { return _mm256_movemask_ps(a); }
+};
+
+#include "SensorFrameKernelsImpl.h"
+
+constexpr SensorFrameKernels kAVX2Kernels = makeKernels<AVX2>(SensorFrameISA::kAVX2, "AVX2");
+
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+const SensorFrameKernels* getAVX2SensorFrameKernels()
+{
+	return &kAVX2Kernels;
+}
+
+#else
+
+const SensorFrameKernels* getAVX2SensorFrameKernels()
+{
+	return nullptr;
+}
+
+#endif
@@ -0,0 +1,420 @@
+// SIMD kernels for SensorFrame operations.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// Generic SIMD kernels, written in terms of a vector traits class V. This file is included
+// by each SensorFrameKernels<ISA>.cpp file inside an anonymous namespace, after that file
+// has defined its traits class and enabled code generation for its instruction set.
+// It must not include anything itself, so that no library code is compiled for the ISA.
+//
+// V must provide:
+//	T				the vector type
+//	width			the number of floats in a T, a divisor of SensorGeometry::width
+//	load, store		unaligned loads and stores
+//	set1, zero		broadcast
+//	add, sub, mul, div, sqrt
+//	max(a, b)		a > b ? a : b
+//	min(a, b)		a < b ? a : b
+//	neg(a)			flip the sign bit
+//	greater(a, b)	a > b in each element, as a mask of all ones or all zeros
+//	bitAnd(a, b)	bitwise and of two masks
+//	signBits(a)		the sign bit of element n of a in bit n of an int
+//
+// max and min are defined exactly like the SSE instructions so that results for NaN and
+// signed zero match std::max and std::min in the scalar kernels.
+
+constexpr int kWidth = SensorGeometry::width;
+constexpr int kHeight = SensorGeometry::height;
+constexpr int kElements = SensorGeometry::elements;
+
+template<class V>
+void addKernel(float* out, const float* a, const float* b)
+{
+	for(int i=0; i<kElements; i += V::width)
+	{
+		V::store(out + i, V::add(V::load(a + i), V::load(b + i)));
+	}
+}
+
+template<class V>
+void subtractKernel(float* out, const float* a, const float* b)
+{
+	for(int i=0; i<kElements; i += V::width)
+	{
+		V::store(out + i, V::sub(V::load(a + i), V::load(b + i)));
+	}
+}
+
+template<class V>
+void multiplyKernel(float* out, const float* a, const float* b)
+{
+	for(int i=0; i<kElements; i += V::width)
+	{
+		V::store(out + i, V::mul(V::load(a + i), V::load(b + i)));
+	}
+}
+
+template<class V>
+void divideKernel(float* out, const float* a, const float* b)
+{
+	for(int i=0; i<kElements; i += V::width)
+	{
+		V::store(out + i, V::div(V::load(a + i), V::load(b + i)));
+	}
+}
+
+template<class V>
+void addKKernel(float* out, const float* a, float k)
+{
+	const typename V::T vk = V::set1(k);
+	for(int i=0; i<kElements; i += V::width)
+	{
+		V::store(out + i, V::add(V::load(a + i), vk));
+	}
+}
+
+template<class V>
+void subtractKKernel(float* out, const float* a, float k)
+{
+	const typename V::T vk = V::set1(k);
+	for(int i=0; i<kElements; i += V::width)
+	{
+		V::store(out + i, V::sub(V::load(a + i), vk));
+	}
+}
+
+template<class V>
+void multiplyKKernel(float* out, const float* a, float k)
+{
+	const typename V::T vk = V::set1(k);
+	for(int i=0; i<kElements; i += V::width)
+	{
+		V::store(out + i, V::mul(V::load(a + i), vk));
+	}
+}
+
+template<class V>
+void divideKKernel(float* out, const float* a, float k)
+{
+	const typename V::T vk = V::set1(k);
+	for(int i=0; i<kElements; i += V::width)
+	{
+		V::store(out + i, V::div(V::load(a + i), vk));
+	}
+}
+
+// std::max(a, k) is (a < k) ? k : a, which is max(k, a) as defined above.
+template<class V>
+void maxKernel(float* out, const float* a, float k)
+{
+	const typename V::T vk = V::set1(k);
+	for(int i=0; i<kElements; i += V::width)
+	{
+		V::store(out + i, V::max(vk, V::load(a + i)));
+	}
+}
+
+// std::min(a, k) is (k < a) ? k : a, which is min(k, a) as defined above.
+template<class V>
+void minKernel(float* out, const float* a, float k)
+{
+	const typename V::T vk = V::set1(k);
+	for(int i=0; i<kElements; i += V::width)
+	{
+		V::store(out + i, V::min(vk, V::load(a + i)));
+	}
+}
+
+template<class V>
+void fillKernel(float* out, float k)
+{
+	const typename V::T vk = V::set1(k);
+	for(int i=0; i<kElements; i += V::width)
+	{
+		V::store(out + i, vk);
+	}
+}
+
+template<class V>
+void clampKernel(float* out, const float* a, float lo, float hi)
+{
+	const typename V::T vlo = V::set1(lo);
+	const typename V::T vhi = V::set1(hi);
+	for(int i=0; i<kElements; i += V::width)
+	{
+		V::store(out + i, V::max(vlo, V::min(vhi, V::load(a + i))));
+	}
+}
+
+template<class V>
+void sqrtKernel(float* out, const float* a)
+{
+	for(int i=0; i<kElements; i += V::width)
+	{
+		V::store(out + i, V::sqrt(V::load(a + i)));
+	}
+}
+
+template<class V>
+void axpyKernel(float* y, float a, const float* x)
+{
+	const typename V::T va = V::set1(a);
+	for(int i=0; i<kElements; i += V::width)
+	{
+		V::store(y + i, V::add(V::load(y + i), V::mul(va, V::load(x + i))));
+	}
+}
+
+template<class V>
+void scaleOffsetKernel(float* out, const float* in, float scale, float offset)
+{
+	const typename V::T vScale = V::set1(scale);
+	const typename V::T vOffset = V::set1(offset);
+	for(int i=0; i<kElements; i += V::width)
+	{
+		V::store(out + i, V::add(V::mul(V::load(in + i), vScale), vOffset));
+	}
+}
+
+template<class V>
+void scaleOffsetFrameKernel(float* out, const float* in, const float* scale, float offset)
+{
+	const typename V::T vOffset = V::set1(offset);
+	for(int i=0; i<kElements; i += V::width)
+	{
+		V::store(out + i, V::add(V::mul(V::load(in + i), V::load(scale + i)), vOffset));
+	}
+}
+
+template<class V>
+void copyRow(float* dest, const float* src)
+{
+	for(int i=0; i<kWidth; i += V::width)
+	{
+		V::store(dest + i, V::load(src + i));
+	}
+}
+
+// max(-ddz, 0) for the second difference (r - c) - (c - l), as in the scalar kernels.
+template<class V>
+typename V::T curvature(typename V::T l, typename V::T c, typename V::T r)
+{
+	const typename V::T ddz = V::sub(V::sub(r, c), V::sub(c, l));
+	return V::max(V::zero(), V::neg(ddz));
+}
+
+// each row is copied into a buffer with a zero on each side, so that the left and right
+// neighbors of every element can be loaded without special cases at the edges. The copy
+// also makes in-place use safe.
+template<class V>
+void curvatureXKernel(float* out, const float* in)
+{
+	float padded[kWidth + 2] = {};
+	float* row = padded + 1;
+	for(int j=0; j<kHeight; ++j)
+	{
+		copyRow<V>(row, in + j*kWidth);
+		float* pOut = out + j*kWidth;
+		for(int i=0; i<kWidth; i += V::width)
+		{
+			V::store(pOut + i, curvature<V>(V::load(row + i - 1), V::load(row + i), V::load(row + i + 1)));
+		}
+	}
+}
+
+// copies of the input rows above and at the current row are kept for in-place use.
+// The row below has not been written yet when it is read.
+template<class V>
+void curvatureYKernel(float* out, const float* in)
+{
+	float above[kWidth] = {};
+	float row[kWidth];
+	const float zeros[kWidth] = {};
+
+	copyRow<V>(row, in);
+	for(int j=0; j<kHeight; ++j)
+	{
+		const float* below = (j + 1 < kHeight) ? in + (j + 1)*kWidth : zeros;
+		float* pOut = out + j*kWidth;
+		for(int i=0; i<kWidth; i += V::width)
+		{
+			V::store(pOut + i, curvature<V>(V::load(above + i), V::load(row + i), V::load(below + i)));
+		}
+		copyRow<V>(above, row);
+		copyRow<V>(row, below);
+	}
+}
+
+template<class V>
+void curvatureXYKernel(float* out, const float* in)
+{
+	float above[kWidth] = {};
+	float padded[kWidth + 2] = {};
+	float* row = padded + 1;
+	const float zeros[kWidth] = {};
+
+	copyRow<V>(row, in);
+	for(int j=0; j<kHeight; ++j)
+	{
+		const float* below = (j + 1 < kHeight) ? in + (j + 1)*kWidth : zeros;
+		float* pOut = out + j*kWidth;
+		for(int i=0; i<kWidth; i += V::width)
+		{
+			const typename V::T c = V::load(row + i);
+			const typename V::T cx = curvature<V>(V::load(row + i - 1), c, V::load(row + i + 1));
+			const typename V::T cy = curvature<V>(V::load(above + i), c, V::load(below + i));
+			V::store(pOut + i, V::sqrt(V::mul(cx, cy)));
+		}
+		copyRow<V>(above, row);
+		copyRow<V>(row, below);
+	}
+}
+
+template<class V>
+void fillRow(float* dest, float k)
+{
+	const typename V::T vk = V::set1(k);
+	for(int i=0; i<kWidth; i += V::width)
+	{
+		V::store(dest + i, vk);
+	}
+}
+
+// as in the scalar kernel, each row is smoothed from a padded copy into a buffer with rows of
+// zeros above and below, which is then smoothed in y. The taps of each output are summed in
+// the same order, V::width outputs at a time. Only the padding rows of the buffer are cleared.
+template<class V>
+void smoothKernel(float* out, const float* in, const float* xWeights, const float* yWeights)
+{
+	float padded[kWidth + 2*kSmoothXRadius] = {};
+	float* row = padded + kSmoothXRadius;
+	float smoothX[(kHeight + 2*kSmoothYRadius)*kWidth];
+	for(int j=0; j<kSmoothYRadius; ++j)
+	{
+		fillRow<V>(smoothX + j*kWidth, 0.f);
+		fillRow<V>(smoothX + (kHeight + kSmoothYRadius + j)*kWidth, 0.f);
+	}
+
+	for(int j=0; j<kHeight; ++j)
+	{
+		copyRow<V>(row, in + j*kWidth);
+		float* pSmoothX = smoothX + (j + kSmoothYRadius)*kWidth;
+		for(int i=0; i<kWidth; i += V::width)
+		{
+			typename V::T sum = V::mul(V::load(xWeights + i), V::load(row + i - kSmoothXRadius));
+			for(int t=1; t<kSmoothXTaps; ++t)
+			{
+				sum = V::add(sum, V::mul(V::load(xWeights + t*kWidth + i), V::load(row + i + t - kSmoothXRadius)));
+			}
+			V::store(pSmoothX + i, sum);
+		}
+	}
+
+	for(int j=0; j<kHeight; ++j)
+	{
+		const float* pSmoothX = smoothX + j*kWidth;
+		typename V::T w[kSmoothYTaps];
+		for(int t=0; t<kSmoothYTaps; ++t)
+		{
+			w[t] = V::set1(yWeights[j*kSmoothYTaps + t]);
+		}
+		float* pOut = out + j*kWidth;
+		for(int i=0; i<kWidth; i += V::width)
+		{
+			typename V::T sum = V::mul(w[0], V::load(pSmoothX + i));
+			for(int t=1; t<kSmoothYTaps; ++t)
+			{
+				sum = V::add(sum, V::mul(w[t], V::load(pSmoothX + t*kWidth + i)));
+			}
+			V::store(pOut + i, sum);
+		}
+	}
+}
+
+// each taxel is compared with its neighbors in the rows above, at and below it, loaded at
+// offsets of -1, 0 and 1 from padded copies of the rows, and the masks of the comparisons
+// are anded and packed into the row's bits. The padding, and the rows outside the frame,
+// are at the threshold, which a peak must be above anyway.
+template<class V>
+void findPeaksKernel(uint64_t* out, const float* in, float threshold)
+{
+	// bits 1 to kWidth - 2.
+	constexpr uint64_t kInteriorColumns = (uint64_t(1) << (kWidth - 1)) - 2;
+	const typename V::T vThreshold = V::set1(threshold);
+
+	float padded[3][kWidth + 2];
+	for(auto& p : padded)
+	{
+		p[0] = p[kWidth + 1] = threshold;
+	}
+	float* above = padded[0] + 1;
+	float* row = padded[1] + 1;
+	float* below = padded[2] + 1;
+
+	fillRow<V>(above, threshold);
+	copyRow<V>(row, in);
+	for(int j=0; j<kHeight; ++j)
+	{
+		if(j + 1 < kHeight)
+		{
+			copyRow<V>(below, in + (j + 1)*kWidth);
+		}
+		else
+		{
+			fillRow<V>(below, threshold);
+		}
+
+		uint64_t mask = 0;
+		for(int i=0; i<kWidth; i += V::width)
+		{
+			const typename V::T c = V::load(row + i);
+			typename V::T m = V::greater(c, vThreshold);
+			m = V::bitAnd(m, V::greater(c, V::load(row + i - 1)));
+			m = V::bitAnd(m, V::greater(c, V::load(row + i + 1)));
+			m = V::bitAnd(m, V::greater(c, V::load(above + i - 1)));
+			m = V::bitAnd(m, V::greater(c, V::load(above + i)));
+			m = V::bitAnd(m, V::greater(c, V::load(above + i + 1)));
+			m = V::bitAnd(m, V::greater(c, V::load(below + i - 1)));
+			m = V::bitAnd(m, V::greater(c, V::load(below + i)));
+			m = V::bitAnd(m, V::greater(c, V::load(below + i + 1)));
+			mask |= static_cast<uint64_t>(V::signBits(m)) << i;
+		}
+		out[j] = mask & kInteriorColumns;
+
+		float* next = above;
+		above = row;
+		row = below;
+		below = next;
+	}
+}
+
+template<class V>
+constexpr SensorFrameKernels makeKernels(SensorFrameISA isa, const char* name)
+{
+	return SensorFrameKernels
+	{
+		isa,
+		name,
+		addKernel<V>,
+		subtractKernel<V>,
+		multiplyKernel<V>,
+		divideKernel<V>,
+		addKKernel<V>,
+		subtractKKernel<V>,
+		multiplyKKernel<V>,
+		divideKKernel<V>,
+		maxKernel<V>,
+		minKernel<V>,
+		fillKernel<V>,
+		clampKernel<V>,
+		sqrtKernel<V>,
+		axpyKernel<V>,
+		scaleOffsetKernel<V>,
+		scaleOffsetFrameKernel<V>,
+		curvatureXKernel<V>,
+		curvatureYKernel<V>,
+		curvatureXYKernel<V>,
+		smoothKernel<V>,
+		findPeaksKernel<V>
+	};
+}
@@ -0,0 +1,68 @@
+// SIMD kernels for SensorFrame operations.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "SensorFrameKernels.h"
+#include "SensorFrame.h"
+
+// vector divide and square root are only available on AArch64.
+#if defined(__aarch64__)
+
+#include <arm_neon.h>
+
+namespace
+{
+
+// vmaxq_f32 and vminq_f32 return NaN if either input is NaN, so max and min are
+// made from a compare and select to match the scalar results.
+struct NEON
+{
+	typedef float32x4_t T;
+	enum { width = 4 };
+
+	static inline T load(const float* p) { return vld1q_f32(p); }
+	static inline void store(float* p, T a) { vst1q_f32(p, a); }
+	static inline T set1(float k) { return vdupq_n_f32(k); }
+	static inline T zero() { return vdupq_n_f32(0.f); }
+	static inline T add(T a, T b) { return vaddq_f32(a, b); }
+	static inline T sub(T a, T b) { return vsubq_f32(a, b); }
+	static inline T mul(T a, T b) { return vmulq_f32(a, b); }
+	static inline T div(T a, T b) { return vdivq_f32(a, b); }
+	static inline T sqrt(T a) { return vsqrtq_f32(a); }
+	static inline T max(T a, T b) { return vbslq_f32(vcgtq_f32(a, b), a, b); }
+	static inline T min(T a, T b) { return vbslq_f32(vcltq_f32(a, b), a, b); }
+	static inline T neg(T a) { return vnegq_f32(a); }
+	static inline T greater(T a, T b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+	static inline T bitAnd(T a, T b)
+	{
+		return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+	}
+
+	// NEON has no movemask, so the sign bits are shifted into place and added.
+	static inline int signBits(T a)
+	{
+		const int32_t shifts[4] = {0, 1, 2, 3};
+		const uint32x4_t bits = vshrq_n_u32(vreinterpretq_u32_f32(a), 31);
+		return vaddvq_u32(vshlq_u32(bits, vld1q_s32(shifts)));
+	}
+};
+
+#include "SensorFrameKernelsImpl.h"
+
+constexpr SensorFrameKernels kNEONKernels = makeKernels<NEON>(SensorFrameISA::kNEON, "NEON");
+
+}
+
+const SensorFrameKernels* getNEONSensorFrameKernels()
+{
+	return &kNEONKernels;
+}
+
+#else
+
+const SensorFrameKernels* getNEONSensorFrameKernels()
+{
+	return nullptr;
+}
+
+#endif
@@ -0,0 +1,68 @@
+// SIMD kernels for SensorFrame operations.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "SensorFrameKernels.h"
+#include "SensorFrame.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+
+#include <emmintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+
+namespace
+{
+
+struct SSE2
+{
+	typedef __m128 T;
+	enum { width = 4 };
+
+	static inline T load(const float* p) { return _mm_loadu_ps(p); }
+	static inline void store(float* p, T a) { _mm_storeu_ps(p, a); }
+	static inline T set1(float k) { return _mm_set1_ps(k); }
+	static inline T zero() { return _mm_setzero_ps(); }
+	static inline T add(T a, T b) { return _mm_add_ps(a, b); }
+	static inline T sub(T a, T b) { return _mm_sub_ps(a, b); }
+	static inline T mul(T a, T b) { return _mm_mul_ps(a, b); }
+	static inline T div(T a, T b) { return _mm_div_ps(a, b); }
+	static inline T sqrt(T a) { return _mm_sqrt_ps(a); }
+	static inline T max(T a, T b) { return _mm_max_ps(a, b); }
+	static inline T min(T a, T b) { return _mm_min_ps(a, b); }
+	static inline T neg(T a) { return _mm_xor_ps(a, _mm_set1_ps(-0.f)); }
+	static inline T greater(T a, T b) { return _mm_cmpgt_ps(a, b); }
+	static inline T bitAnd(T a, T b) { return _mm_and_ps(a, b); }
+	static inline int signBits(T a) { return _mm_movemask_ps(a); }
+};
+
+#include "SensorFrameKernelsImpl.h"
+
+constexpr SensorFrameKernels kSSE2Kernels = makeKernels<SSE2>(SensorFrameISA::kSSE2, "SSE2");
+
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+const SensorFrameKernels* getSSE2SensorFrameKernels()
+{
+	return &kSSE2Kernels;
+}
+
+#else
+
+const SensorFrameKernels* getSSE2SensorFrameKernels()
+{
+	return nullptr;
+}
+
+#endif
@@ -0,0 +1,159 @@
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+#include "SensorFrame.h"
+#include "Touch.h"
+#include "TouchTracker.h"
+#include "Zone.h"
+#include "ZoneMap.h"
+
+// the path from calibrated frames to touches and zone outputs, as the Soundplane client runs
+// it, for embedding the tracker in another process. Feed calibrated frames to process() at
+// kSoundplaneFrameRate, then read the touches it returns, or the notes and controllers from
+// the zones with forEachOutput(). Zones are laid out with addZone().
+//
+// This is the part that does not depend on the touch capacity, so that a client can pick the
+// capacity as it runs, see SoundplaneTrackingN. Touches and zones are passed in and out at the
+// largest capacity, kMaxTouches.
+//
+// Not thread safe: call everything from the thread that calls process().
+class SoundplaneTrackingBase
+{
+public:
+	// called with the ID and offset of a zone, and the index of the touch in it.
+	typedef std::function<void(int zoneID, int offset, int i, const Touch& t)> TouchFn;
+	typedef std::function<void(int zoneID, int offset, const Controller& c)> ControllerFn;
+
+	virtual ~SoundplaneTrackingBase() {}
+
+	// the most touches that can be tracked.
+	virtual int getCapacity() const = 0;
+
+	void setMaxTouches(int n) { mMaxTouches = std::min(std::max(n, 0), getCapacity()); }
+	int getMaxTouches() const { return mMaxTouches; }
+
+	// scale and curve applied to pressure and velocity, as the client's z_scale and z_curve.
+	void setPressureScale(float zScale, float zCurve)
+	{
+		mZScale = zScale;
+		mZCurve = zCurve;
+	}
+
+	// the tracker's settings, and clear() to forget its touches. See TouchTrackerN.
+	virtual void setThresh(float f) = 0;
+	virtual void setLopassZ(float k) = 0;
+	virtual void setRotate(bool b) = 0;
+	virtual void clear() = 0;
+
+	// the zones, see ZoneMapN. getZone() returns a copy of a zone with its touches.
+	virtual void clearZones() = 0;
+	virtual bool addZone(const Zone& zone) = 0;
+	virtual void setZoneParameters(const ZoneParameters& p) = 0;
+	virtual int getNumZones() const = 0;
+	virtual Zone getZone(int i) const = 0;
+
+	// track touches in a calibrated frame, writing the preprocessed frame to smoothed. Returns
+	// the scaled touches, which stay valid until the next call. The touches carry frameTime, the
+	// time the device made the frame, such as DriverFrame::frameTime.
+	virtual const TouchArray& track(const SensorFrame& calibrated, SensorFrame& smoothed,
+		std::chrono::steady_clock::time_point frameTime) = 0;
+
+	// send the touches from the last track() to the zones.
+	virtual void processZones() = 0;
+
+	// call touchFn for each active output touch and controllerFn for each active controller
+	// from the last processZones().
+	virtual void forEachOutput(const TouchFn& touchFn, const ControllerFn& controllerFn) const = 0;
+
+	// track touches in a calibrated frame and send them to the zones.
+	const TouchArray& process(const SensorFrame& calibrated,
+		std::chrono::steady_clock::time_point frameTime = std::chrono::steady_clock::time_point())
+	{
+		const TouchArray& touches = track(calibrated, mSmoothed, frameTime);
+		processZones();
+		return touches;
+	}
+
+	// the preprocessed frame the touches in the last process() were found in.
+	const SensorFrame& getSmoothedFrame() const { return mSmoothed; }
+
+protected:
+	int mMaxTouches{4};
+	float mZScale{1.f};
+	float mZCurve{0.5f};
+	SensorFrame mSmoothed{};
+};
+
+// the tracking of up to Capacity touches. Its tracker and zones can also be used directly.
+// SoundplaneTracking is the one for kMaxTouches.
+template<int Capacity>
+class SoundplaneTrackingN : public SoundplaneTrackingBase
+{
+public:
+	typedef TouchArrayN<Capacity> Touches;
+
+	TouchTrackerN<Capacity>& getTracker() { return mTracker; }
+	ZoneMapN<Capacity>& getZones() { return mZones; }
+	const ZoneMapN<Capacity>& getZones() const { return mZones; }
+
+	// the touches from the last track(), at this capacity.
+	const Touches& getTouches() const { return mTouches; }
+
+	// SoundplaneTrackingBase
+	int getCapacity() const override { return Capacity; }
+	void setThresh(float f) override { mTracker.setThresh(f); }
+	void setLopassZ(float k) override { mTracker.setLopassZ(k); }
+	void setRotate(bool b) override { mTracker.setRotate(b); }
+	void clear() override { mTracker.clear(); }
+
+	void clearZones() override { mZones.clear(); }
+	bool addZone(const Zone& zone) override { return mZones.addZone(zone); }
+	void setZoneParameters(const ZoneParameters& p) override { mZones.setParameters(p); }
+	int getNumZones() const override { return static_cast<int>(mZones.size()); }
+	Zone getZone(int i) const override { return Zone(*(mZones.begin() + i)); }
+
+	const TouchArray& track(const SensorFrame& calibrated, SensorFrame& smoothed,
+		std::chrono::steady_clock::time_point frameTime) override
+	{
+		mTracker.preprocess(calibrated, smoothed);
+		mTouches = scaleTouchPressure(mTracker.process(smoothed, mMaxTouches), mZScale, mZCurve);
+		mTouches.time = frameTime;
+
+		// touches past the capacity stay inactive.
+		copyTouches(mAllTouches, mTouches);
+		return mAllTouches;
+	}
+
+	void processZones() override
+	{
+		mZones.process(mTouches, mMaxTouches);
+	}
+
+	void forEachOutput(const TouchFn& touchFn, const ControllerFn& controllerFn) const override
+	{
+		mZones.forEachOutput(
+			[&](const ZoneN<Capacity>& zone, int i, const Touch& t)
+			{
+				touchFn(zone.getZoneID(), zone.getOffset(), i, t);
+			},
+			[&](const ZoneN<Capacity>& zone, const Controller& c)
+			{
+				controllerFn(zone.getZoneID(), zone.getOffset(), c);
+			});
+	}
+
+private:
+	TouchTrackerN<Capacity> mTracker;
+	ZoneMapN<Capacity> mZones;
+	Touches mTouches{};
+	TouchArray mAllTouches{};
+};
+
+typedef SoundplaneTrackingN<kMaxTouches> SoundplaneTracking;
@@ -0,0 +1,81 @@
+//
+//  Touch.h
+//  soundplane
+//
+//  Created by Randy Jones on 1/22/18.
+//
+
+#pragma once
+
+#include <array>
+#include <chrono>
+
+// the touch capacities the tracker, zones and outputs are built for: a few touches for mono
+// and duo playing, the usual 16, and kMaxTouches for large surfaces and several devices.
+// The smallest one that holds the touches wanted is chosen, see getTouchCapacity().
+static constexpr int kMinTouchCapacity = 4;
+static constexpr int kDefaultTouchCapacity = 16;
+static constexpr int kMaxTouches = 32;
+
+enum TouchState
+{
+    kTouchStateInactive = 0,
+    kTouchStateOn,
+    kTouchStateContinue,
+    kTouchStateOff
+};
+
+struct Touch
+{
+    float x;
+    float y;
+    float z;
+    float dz;
+    
+    int age;
+    int state;
+
+    // store the current key grid location the touch is in, which due to hysteresis may not be
+    // the one directly under the position.
+    int kx;
+    int ky;
+    
+    float note;
+    float vibrato;
+
+    int voiceIdx;
+};
+
+// the touches in one frame, with the time the device made the frame on the
+// driver's steady clock, or zero if it is not known.
+template<int Capacity>
+struct TouchArrayN : public std::array<Touch, Capacity>
+{
+    std::chrono::steady_clock::time_point time{};
+};
+
+// touches of the largest capacity, which can hold those of any other.
+typedef TouchArrayN<kMaxTouches> TouchArray;
+
+inline bool touchIsActive(Touch t) { return t.state != kTouchStateInactive; }
+
+// the smallest touch capacity that holds the given number of touches.
+inline int getTouchCapacity(int touches)
+{
+    return (touches <= kMinTouchCapacity) ? kMinTouchCapacity :
+        (touches <= kDefaultTouchCapacity) ? kDefaultTouchCapacity : kMaxTouches;
+}
+
+// copy touches to an array of another capacity. Touches past the end of the smaller
+// one are left out, or left as they were in out.
+template<int OutCapacity, int InCapacity>
+void copyTouches(TouchArrayN<OutCapacity>& out, const TouchArrayN<InCapacity>& in)
+{
+    const int n = (OutCapacity < InCapacity) ? OutCapacity : InCapacity;
+    for(int i=0; i<n; ++i)
+    {
+        out[i] = in[i];
+    }
+    out.time = in.time;
+}
+
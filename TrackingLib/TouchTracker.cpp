@@ -0,0 +1,1056 @@
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2017 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include <iostream>
+#include <cmath>
+#include <list>
+#include <thread>
+#include <mutex>
+#include <array>
+#include <algorithm>
+#include <limits>
+
+#include "TouchTracker.h"
+
+constexpr float kTwoPi = 3.1415926535f*2.f;
+
+template <class c>
+inline c (clamp)(const c& x, const c& min, const c& max)
+{
+	return (x < min) ? min : (x > max ? max : x);
+}
+
+// the index of the lowest set bit of a nonzero mask.
+inline int countTrailingZeros(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(x);
+#else
+	int n = 0;
+	for(; !(x & 1); x >>= 1) ++n;
+	return n;
+#endif
+}
+
+// within range, including start, excluding end value.
+template <class c>
+inline bool (within)(const c& x, const c& min, const c& max)
+{
+	return ((x >= min) && (x < max));
+}
+
+inline float lerp(const float a, const float b, const float m)
+{
+	return(a + m*(b-a));
+}
+
+inline float unlerp(const float a, const float b, const float x)
+{
+	return(x - a)/(b-a);
+}
+
+inline float mapRange(const float a, const float b, const float c, const float d, const float x)
+{
+	return lerp(c, d, unlerp(a, b, x));
+}
+
+inline float mapAndClipRange(const float a, const float b, const float c, const float d, const float x)
+{
+	return lerp(c, d, clamp(unlerp(a, b, x), 0.f, 1.f));
+}
+
+// return city block distance between two touches with a "z importance" parameter.
+// if z scale is too small, zero touches will get matched with new active ones in the same position.
+// if too big, z is more important than position and nothing works.	
+inline float cityBlockDistanceXYZ(Touch a, Touch b, float zScale)
+{
+	return fabs(a.x - b.x) + fabs(a.y - b.y) + zScale*fabs(a.z - b.z);
+}
+
+// c over [0 - 1] fades response from sqrt(x) -> x -> x^2
+//
+float responseCurve(float x, float c)
+{
+	float y;
+	if(c < 0.5f)
+	{
+		y = lerp(x*x, x, c*2.f);
+	}
+	else
+	{
+		y = lerp(x, sqrtf(x), c*2.f - 1.f);
+	}
+	return y;
+}
+
+template<int Capacity>
+TouchArrayN<Capacity> scaleTouchPressure(const TouchArrayN<Capacity>& in, float zScale, float zCurve)
+{
+	TouchArrayN<Capacity> out = in;
+	const float dzScale = 0.125f;
+	
+	for(int i=0; i<Capacity; ++i)
+	{
+		float z = in[i].z;
+		z *= zScale;
+		z = clamp(z, 0.f, 4.f);
+		z = responseCurve(z, zCurve);
+		out[i].z = z;
+		
+		// for note-ons, use same z scale controls as pressure
+		float dz = in[i].dz*dzScale;
+		dz *= zScale;
+		dz = clamp(dz, 0.f, 1.f);
+		dz = responseCurve(dz, zCurve);
+		out[i].dz = dz;
+	}
+	return out;
+}
+
+// TouchTracker
+
+template<int Capacity>
+TouchTrackerN<Capacity>::TouchTrackerN() :
+	mSampleRate(1000.f),
+	mMaxTouchesPerFrame(0),
+	mLopassZ(50.),
+	mRotate(false)
+{
+	setThresh(0.1);
+	
+	for(int i = 0; i < Capacity; i++)
+	{
+		mRotateShuffleOrder[i] = i;
+	}
+}
+		
+template<int Capacity>
+TouchTrackerN<Capacity>::~TouchTrackerN()
+{
+}
+
+template<int Capacity>
+void TouchTrackerN<Capacity>::setMaxTouches(int t)
+{
+	int kmax = Capacity;
+	int newT = clamp(t, 0, kmax);
+	if(newT != mMaxTouchesPerFrame)
+	{
+		mMaxTouchesPerFrame = newT;
+		
+		// reset shuffle order
+		for(int i = 0; i < Capacity; i++)
+		{
+			mRotateShuffleOrder[i] = i;
+		}
+	}
+}
+
+template<int Capacity>
+void TouchTrackerN<Capacity>::setRotate(bool b)
+{ 
+	mRotate = b; 
+	for(int i = 0; i < Capacity; i++)
+	{
+		mRotateShuffleOrder[i] = i;
+	}
+}
+
+template<int Capacity>
+void TouchTrackerN<Capacity>::clear()
+{
+	for (int i=0; i<Capacity; i++)	
+	{
+		mTouches[i] = Touch();	
+	}
+}
+
+// set the threshold of curvature that will cause a touch. Note that this will not correspond with the pressure (z) values reported by touches. 
+template<int Capacity>
+void TouchTrackerN<Capacity>::setThresh(float f) 
+{ 
+	mOnThreshold = clamp(f, 0.005f, 1.f); 
+	mFilterThreshold = mOnThreshold * 0.5f; 
+	mOffThreshold = mOnThreshold * 0.75f; 
+}
+
+template<int Capacity>
+void TouchTrackerN<Capacity>::setLopassZ(float k)
+{ 
+	mLopassZ = k; 
+}
+
+// sum each taxel with its neighbors in x. Each input row is copied into a zero-padded
+// row buffer first, so that out may be the same frame as in.
+void smoothPressureX(SensorFrame& out, const SensorFrame& in)
+{
+	constexpr int w = SensorGeometry::width;
+	std::array<float, w + 2> row;
+	row[0] = row[w + 1] = 0.f;
+	
+	for(int j = 0; j < SensorGeometry::height; j++)
+	{
+		// row ptrs
+		const float* pr2 = in.data() + j*w;
+		float* prOut = out.data() + j*w;
+		std::copy(pr2, pr2 + w, row.begin() + 1);
+		
+		for(int i = 0; i < w; i++)
+		{
+			prOut[i] = (row[i] + row[i + 1] + row[i + 2]);
+		}
+	}
+}
+
+// sum each taxel with its neighbors in y. A copy of the previous input row is kept
+// so that out may be the same frame as in.
+void smoothPressureY(SensorFrame& out, const SensorFrame& in)
+{
+	constexpr int w = SensorGeometry::width;
+	constexpr int h = SensorGeometry::height;
+	std::array<float, w> rowAbove;
+	std::array<float, w> row;
+	
+	const float* pr2 = in.data();
+	const float* pr3 = in.data() + w;
+	float* prOut = out.data();
+	
+	// top row
+	std::copy(pr2, pr2 + w, row.begin());
+	for(int i = 0; i < w; i++)
+	{
+		prOut[i] = row[i] + pr3[i];
+	}
+	
+	// center rows
+	for(int j = 1; j < h - 1; j++)
+	{
+		rowAbove = row;
+		pr2 = in.data() + j*w;
+		pr3 = in.data() + (j + 1)*w;
+		std::copy(pr2, pr2 + w, row.begin());
+		prOut = out.data() + j*w;
+		for(int i = 0; i < w; i++)
+		{
+			prOut[i] = rowAbove[i] + row[i] + pr3[i];
+		}
+	}
+	
+	// bottom row
+	rowAbove = row;
+	pr2 = in.data() + (h - 1)*w;
+	prOut = out.data() + (h - 1)*w;
+	for(int i = 0; i < w; i++)
+	{
+		prOut[i] = rowAbove[i] + pr2[i];
+	}
+}
+
+SensorFrame smoothPressureX(const SensorFrame& in)
+{
+	SensorFrame out;
+	smoothPressureX(out, in);
+	return out;
+}
+
+SensorFrame smoothPressureY(const SensorFrame& in)
+{
+	SensorFrame out;
+	smoothPressureY(out, in);
+	return out;
+}
+
+template<int Capacity>
+SensorFrame TouchTrackerN<Capacity>::preprocess(const SensorFrame& in)
+{
+	SensorFrame y;
+	preprocess(in, y);
+	return y;
+}
+
+namespace
+{
+	// a lot of filtering is needed here for Soundplane A to make sure peaks are in centers of touches.
+	// it also reduces noise.
+	// the down side is, contiguous touches are harder to tell apart. a smart blob-shape algorithm
+	// can make up for this later, with this filtering still intact.
+	constexpr int kSmoothXPasses = 4;
+	constexpr int kSmoothYPasses = 3;
+	constexpr float kSmoothScale = 1.f/64.f;
+	
+	static_assert(kSmoothXRadius == kSmoothXPasses, "each box filter pass widens the kernel by one");
+	static_assert(kSmoothYRadius == kSmoothYPasses, "each box filter pass widens the kernel by one");
+	
+	// the repeated box filters smoothPressureX() and smoothPressureY() as one separable kernel,
+	// 9 taps in x and 7 in y. Because each box filter pass treats the frame as zero outside its
+	// edges, the weights near the edges are not the binomial weights of the center, so every output
+	// column and row gets its own taps. The weights are small integers, and kSmoothScale is a power
+	// of two folded into the y weights, so all of them are exact. We get the
+	// weights by running the box filters on an impulse at each input position.
+	SmoothingWeights makeSmoothingWeights()
+	{
+		constexpr int w = SensorGeometry::width;
+		constexpr int h = SensorGeometry::height;
+		SmoothingWeights k{};
+		
+		for(int c = 0; c < w; ++c)
+		{
+			SensorFrame impulse{};
+			impulse[c] = 1.f;
+			for(int n = 0; n < kSmoothXPasses; ++n)
+			{
+				smoothPressureX(impulse, impulse);
+			}
+			for(int i = 0; i < w; ++i)
+			{
+				int t = c - i + kSmoothXRadius;
+				if(within(t, 0, kSmoothXTaps))
+				{
+					k.x[t][i] = impulse[i];
+				}
+			}
+		}
+		
+		for(int r = 0; r < h; ++r)
+		{
+			SensorFrame impulse{};
+			impulse[r*w] = 1.f;
+			for(int n = 0; n < kSmoothYPasses; ++n)
+			{
+				smoothPressureY(impulse, impulse);
+			}
+			for(int j = 0; j < h; ++j)
+			{
+				int t = r - j + kSmoothYRadius;
+				if(within(t, 0, kSmoothYTaps))
+				{
+					k.y[j][t] = impulse[j*w]*kSmoothScale;
+				}
+			}
+		}
+		return k;
+	}
+}
+
+// the box filters are applied as one separable kernel by smooth(), which makes two passes over
+// the frame instead of seven and is vectorized like the other SensorFrame operations.
+//
+// The result differs from running the filters one after another only in the order of the sums.
+// Where the curvature is near zero, the square root magnifies that difference. For random input
+// frames, every output is within 1e-3 of the largest output in the frame of the sequential result.
+template<int Capacity>
+void TouchTrackerN<Capacity>::preprocess(const SensorFrame& in, SensorFrame& y)
+{
+	static const SmoothingWeights kWeights = makeSmoothingWeights();
+	
+	// fixed IIR filter input
+	const float k = 0.25f;
+	multiply(mInputZ1, mInputZ1, 1.f - k);
+	axpy(mInputZ1, k, in);
+	
+	// filter out any negative values. negative values can show up from capacitive coupling near edges,
+	// from motion or bending of the whole instrument,
+	// from the elastic layer deforming and pushing up on the sensors near a touch.
+	max(y, mInputZ1, 0.f);
+	
+	smooth(y, y, kWeights);
+	getCurvatureXY(y, y);
+}
+
+template<int Capacity>
+typename TouchTrackerN<Capacity>::Touches TouchTrackerN<Capacity>::process(const SensorFrame& in, int maxTouches)
+{
+	setMaxTouches(maxTouches);
+
+    mTouches = Touches{};
+    
+	if(mMaxTouchesPerFrame > 0)
+	{
+		mTouches = findTouches(in);
+					
+		// match -> position filter -> feedback
+		mTouches = matchTouches(mTouches, mTouchesMatch1);	
+		mTouches = filterTouchesXYAdaptive(mTouches, mTouchesMatch1);
+		mTouchesMatch1 = mTouches;
+		
+		// asymmetrical z filter from user setting. Ages are created here.
+		mTouches = filterTouchesZ(mTouches, mTouches2, mLopassZ*2.f, mLopassZ*0.25f);
+		mTouches2 = mTouches;
+		
+		// after variable filter, exile decayed touches so they are not matched. Note this affects match feedback!
+		mTouchesMatch1 = exileUnusedTouches(mTouchesMatch1, mTouches);
+								
+		// TODO hysteresis after matching to prevent glitching when there are more
+		// physical touches than mMaxTouchesPerFrame and touches are stolen
+		
+		if(mRotate)
+		{
+			mTouches = rotateTouches(mTouches);
+		}	
+		
+		mTouches = clampAndScaleTouches(mTouches);
+	}
+    
+    return mTouches;
+}
+
+Touch correctPeakX(Touch pos, const SensorFrame& in) 
+{		
+	Touch newPos = pos;
+	const float maxCorrect = 0.5f;
+	const int w = SensorGeometry::width;
+	int x = pos.x;
+	int y = pos.y;
+	
+	if(within(x, 1, w - 1))
+	{
+		float a = in[y*w + x - 1];
+		float b = in[y*w + x];
+		float c = in[y*w + x + 1];
+		float p = ((a - c)/(a - 2.f*b + c))*0.5f;
+		float fx = x + clamp(p, -maxCorrect, maxCorrect);										
+        newPos = Touch{.x = fx, .y = pos.y, .z = pos.z};
+	}
+	
+	return newPos;
+}
+
+Touch correctPeakY(Touch pos, const SensorFrame& in) 
+{		
+	const float maxCorrect = 0.5f;
+	const int w = SensorGeometry::width;
+	const int h = SensorGeometry::height;
+	int x = pos.x;
+	int y = pos.y;
+	
+	float a, b, c;
+	if(y <= 0)
+	{
+		a = 0;
+		b = in[y*w + x];
+		c = in[(y + 1)*w + x];
+	}
+	else if(y >= h - 1)
+	{
+		a = in[(y - 1)*w + x];
+		b = in[y*w + x];
+		c = 0;
+	}
+	else
+	{
+		a = in[(y - 1)*w + x];
+		b = in[y*w + x];
+		c = in[(y + 1)*w + x];
+	}
+	float p = ((a - c)/(a - 2.f*b + c))*0.5f;		
+	float fy = y + clamp(p, -maxCorrect, maxCorrect);							
+    return Touch{.x = pos.x, .y = fy, .z = pos.z};
+}
+
+float sensorToKeyY(float sy)
+{
+	float ky = 0.f;
+	
+	constexpr int mapSize = 6;
+	
+	// Soundplane A as measured.
+	// NOTE: these y locations depend on the amount of smoothing done in smoothPressureX / smoothPressureY.
+	constexpr std::array<float, mapSize> sensorMap{{0.7, 1.2, 2.7, 4.3, 5.8, 6.3}};
+	constexpr std::array<float, mapSize> keyMap{{0.01, 1., 2., 3., 4., 4.99}};
+	
+	if(sy < sensorMap[0])
+	{
+		ky = keyMap[0];
+	}
+	else if(sy > sensorMap[mapSize - 1])
+	{
+		ky = keyMap[mapSize - 1];
+	}
+	else
+	{
+		// piecewise linear map
+		for(int i = 1; i<mapSize; ++i)
+		{
+			if(sy <= sensorMap[i])
+			{
+				// piecewise linear
+				float m = (sy - sensorMap[i - 1])/(sensorMap[i] - sensorMap[i - 1]);
+				ky = lerp(keyMap[i - 1], keyMap[i], m);
+				break;
+			}
+		}
+	}
+	
+	return ky;
+}
+
+Touch peakToTouch(Touch p)
+{
+    return Touch{.x = mapRange(3.5f, 59.5f, 1.f, 29.f, p.x), .y = sensorToKeyY(p.y), .z = p.z};
+}
+
+// the strongest peaks added so far, strongest first, up to a capacity of at most Capacity.
+// Each peak is inserted in order as it is found, and a peak weaker than all of a full set is
+// passed over with one comparison. Peaks of equal strength keep the order they were added in.
+template<int Capacity>
+class StrongestPeaks
+{
+public:
+	explicit StrongestPeaks(int capacity) : mCapacity(capacity) {}
+	
+	void add(Touch p)
+	{
+		if(mSize < mCapacity)
+		{
+			mSize++;
+		}
+		else if(!(p.z > mPeaks[mSize - 1].z))
+		{
+			return;
+		}
+		
+		int i = mSize - 1;
+		for(; (i > 0) && (p.z > mPeaks[i - 1].z); --i)
+		{
+			mPeaks[i] = mPeaks[i - 1];
+		}
+		mPeaks[i] = p;
+	}
+	
+	int size() const { return mSize; }
+	const Touch& operator[](int i) const { return mPeaks[i]; }
+	
+private:
+	std::array<Touch, Capacity> mPeaks;
+	int mCapacity;
+	int mSize{0};
+};
+
+// quick touch finder based on peaks of curvature. 
+// this works well, but a different approach based on blob sizes / shapes could do a much better
+// job with contiguous keys.
+template<int Capacity>
+typename TouchTrackerN<Capacity>::Touches TouchTrackerN<Capacity>::findTouches(const SensorFrame& in)
+{
+	constexpr int w = SensorGeometry::width;
+	constexpr int h = SensorGeometry::height;
+	
+    Touches touches{};
+	if(mMaxTouchesPerFrame < 1) return touches;
+	
+	// get peaks
+	SensorFrameMask map;
+	findPeaks(map, in, mFilterThreshold);
+	
+	// keep the strongest peaks, as many as we have touches for.
+	StrongestPeaks<Capacity> peaks(mMaxTouchesPerFrame);
+	for (int j=0; j<h; j++)
+	{
+		for (uint64_t mapRow = map[j]; mapRow; mapRow &= mapRow - 1)
+		{
+			const int i = countTrailingZeros(mapRow);
+			float z = in[j*w + i];
+			peaks.add(Touch{.x = static_cast<float>(i), .y = static_cast<float>(j), .z = z});
+		}
+	}
+
+	// correct the survivors
+	for(int i=0; i<peaks.size(); ++i)
+	{
+		Touch p = peaks[i];
+		if(p.z < mFilterThreshold) break;
+				
+		Touch px = correctPeakX(p, in);	
+		Touch pxy = correctPeakY(px, in);			
+		touches[i] = peakToTouch(pxy);	
+	}
+
+	return touches;
+}
+
+// costs of matching touches in one frame, in rows, with touches in another, in columns.
+template<int Capacity>
+using MatchCosts = std::array<std::array<float, Capacity>, Capacity>;
+
+// the cost of a pair of touches that can't be matched. Larger than any number of costs of
+// pairs that can be added up, so that the most pairs that can be matched always are.
+const float kNoMatchCost = 1e6f;
+
+// assign each of nRows rows to a different one of nCols >= nRows columns with the least
+// total cost, by the Hungarian method with row and column potentials, in O(nRows^2 nCols).
+template<int Capacity>
+void solveAssignment(const MatchCosts<Capacity>& cost, int nRows, int nCols, std::array<int, Capacity>& rowCol)
+{
+	// the method's arrays are indexed from 1, with 0 for the row being added.
+	std::array<double, Capacity + 1> u{}, v{};
+	std::array<int, Capacity + 1> p{}, way{};
+	
+	for(int i=1; i<=nRows; ++i)
+	{
+		std::array<double, Capacity + 1> minV;
+		std::array<bool, Capacity + 1> used{};
+		minV.fill(std::numeric_limits<double>::max());
+		p[0] = i;
+		int j0 = 0;
+		
+		// find the shortest augmenting path from row i to a free column.
+		do
+		{
+			used[j0] = true;
+			const int i0 = p[j0];
+			double delta = std::numeric_limits<double>::max();
+			int j1 = 0;
+			for(int j=1; j<=nCols; ++j)
+			{
+				if(!used[j])
+				{
+					const double reduced = cost[i0 - 1][j - 1] - u[i0] - v[j];
+					if(reduced < minV[j])
+					{
+						minV[j] = reduced;
+						way[j] = j0;
+					}
+					if(minV[j] < delta)
+					{
+						delta = minV[j];
+						j1 = j;
+					}
+				}
+			}
+			for(int j=0; j<=nCols; ++j)
+			{
+				if(used[j])
+				{
+					u[p[j]] += delta;
+					v[j] -= delta;
+				}
+				else
+				{
+					minV[j] -= delta;
+				}
+			}
+			j0 = j1;
+		}
+		while(p[j0] != 0);
+		
+		// flip the path.
+		do
+		{
+			const int j1 = way[j0];
+			p[j0] = p[j1];
+			j0 = j1;
+		}
+		while(j0);
+	}
+	
+	for(int j=1; j<=nCols; ++j)
+	{
+		if(p[j])
+		{
+			rowCol[p[j] - 1] = j - 1;
+		}
+	}
+}
+
+// for each row, the column it is matched to with the least total cost, or -1 if it is not
+// matched. Rows can only be matched to columns at less than kNoMatchCost. nRows <= nCols.
+// One or two rows, as with one or two fingers down, are matched without the full solve.
+template<int Capacity>
+void getBestMatches(const MatchCosts<Capacity>& cost, int nRows, int nCols, std::array<int, Capacity>& rowCol)
+{
+	if(nRows == 1)
+	{
+		rowCol[0] = static_cast<int>(std::min_element(cost[0].begin(), cost[0].begin() + nCols) - cost[0].begin());
+	}
+	else if(nRows == 2)
+	{
+		// prefer the pairing that matches the most rows, then the least cost of the matched
+		// pairs. Adding kNoMatchCost to the costs would lose their differences to rounding.
+		int maxMatched = -1;
+		float minCost = std::numeric_limits<float>::max();
+		for(int j=0; j<nCols; ++j)
+		{
+			for(int k=0; k<nCols; ++k)
+			{
+				if(j == k) continue;
+				const bool match0 = (cost[0][j] < kNoMatchCost);
+				const bool match1 = (cost[1][k] < kNoMatchCost);
+				const int matched = match0 + match1;
+				const float c = (match0 ? cost[0][j] : 0.f) + (match1 ? cost[1][k] : 0.f);
+				if((matched > maxMatched) || ((matched == maxMatched) && (c < minCost)))
+				{
+					maxMatched = matched;
+					minCost = c;
+					rowCol[0] = j;
+					rowCol[1] = k;
+				}
+			}
+		}
+	}
+	else if(nRows > 2)
+	{
+		solveAssignment<Capacity>(cost, nRows, nCols, rowCol);
+	}
+	
+	for(int i=0; i<nRows; ++i)
+	{
+		if(cost[i][rowCol[i]] >= kNoMatchCost)
+		{
+			rowCol[i] = -1;
+		}
+	}
+}
+
+// match incoming touches in x with previous frame of touches in x1.
+// the active touches in each frame are matched with the least total distance, counting pressure
+// as well as position, and only touches closer than kMaxConnectDist are matched. Each matched
+// touch continues the previous touch at its index with age (w) 1. A previous touch that is not
+// matched gives up its index in the same frame, so each other incoming touch goes to the nearest
+// index that is free or given up, with its age set to 1 if it is close to the previous touch
+// there, otherwise 0. A touch that moves further than kMaxConnectDist in one frame is not dropped.
+// if there is no incoming touch at index i, the position at index i will be maintained.
+
+template<int Capacity>
+typename TouchTrackerN<Capacity>::Touches TouchTrackerN<Capacity>::matchTouches(const Touches& x, const Touches& x1)
+{
+	const float kMaxConnectDist = 2.f; 
+	
+    Touches newTouches{};
+	
+	// compact lists of the indices of the active touches in each frame.
+	std::array<int, Capacity> curr, prev;
+	int nCurr = 0;
+	int nPrev = 0;
+	for(int i=0; i<mMaxTouchesPerFrame; ++i)
+	{
+		if(x[i].z > mFilterThreshold) curr[nCurr++] = i;
+		if(x1[i].z > mFilterThreshold) prev[nPrev++] = i;
+	}
+	
+	// get the best matches, solving for the shorter of the two lists.
+	std::array<int, Capacity> currToPrev;
+	currToPrev.fill(-1);
+	if(nCurr && nPrev)
+	{
+		const bool currRows = (nCurr <= nPrev);
+		MatchCosts<Capacity> cost;
+		for(int c=0; c<nCurr; ++c)
+		{
+			for(int p=0; p<nPrev; ++p)
+			{
+				const Touch a = x[curr[c]];
+				const Touch b = x1[prev[p]];
+				const float d = (cityBlockDistanceXYZ(b, a, 0.f) < kMaxConnectDist) ? cityBlockDistanceXYZ(b, a, 20.f) : kNoMatchCost;
+				(currRows ? cost[c][p] : cost[p][c]) = d;
+			}
+		}
+		
+		std::array<int, Capacity> rowCol;
+		if(currRows)
+		{
+			getBestMatches<Capacity>(cost, nCurr, nPrev, currToPrev);
+		}
+		else
+		{
+			getBestMatches<Capacity>(cost, nPrev, nCurr, rowCol);
+			for(int p=0; p<nPrev; ++p)
+			{
+				if(rowCol[p] >= 0) currToPrev[rowCol[p]] = p;
+			}
+		}
+	}
+	
+	// first, continue matched touches. They are all connected.
+	std::array<bool, Capacity> indexUsed;
+	indexUsed.fill(false);
+	for(int c=0; c<nCurr; ++c)
+	{
+		if(currToPrev[c] >= 0)
+		{
+			const int j = prev[currToPrev[c]];
+			newTouches[j] = x[curr[c]];
+			newTouches[j].age = 1;
+			indexUsed[j] = true;
+		}
+	}
+		
+	// now take care of any remaining current touches
+	for(int c=0; c<nCurr; ++c)
+	{
+		if(currToPrev[c] >= 0) continue;
+		
+		const int i = curr[c];
+		Touch t = x[i];
+		int freeIdx = -1;
+		float minDist = MAXFLOAT;
+		
+		// first, try to match same touch index (important for decay!)
+		if((x1[i].z <= mFilterThreshold) && !indexUsed[i])
+		{
+			freeIdx = i;
+		}
+		
+		// then try closest free touch, or previous touch left unmatched
+		if(freeIdx < 0)
+		{
+			for(int j=0; j<mMaxTouchesPerFrame; ++j)
+			{
+				if(!indexUsed[j])
+				{
+					float d = cityBlockDistanceXYZ(t, x1[j], 0.f);
+					if(d < minDist)
+					{
+						minDist = d;
+						freeIdx = j;
+					}
+				}
+			}
+		}
+		
+		// if a free index was found, write the current touch
+		if(freeIdx >= 0)
+		{
+			t.age = (cityBlockDistanceXYZ(x1[freeIdx], t, 0.f) < kMaxConnectDist);
+			newTouches[freeIdx] = t;
+			indexUsed[freeIdx] = true;
+		}
+	}
+	
+	// fill in any free touches with previous touches at those indices. This will allow old touches to re-link if not reused.
+	for(int i=0; i < mMaxTouchesPerFrame; ++i)
+	{
+		Touch t = newTouches[i];
+		if(t.z <= mFilterThreshold)
+		{
+			newTouches[i].x = (x1[i].x);
+			newTouches[i].y = (x1[i].y);
+		}
+	}
+
+	return newTouches;
+}
+
+// input: vec4<x, y, z, k> where k is 1 if the touch is connected to the previous touch at the same index.
+//
+template<int Capacity>
+typename TouchTrackerN<Capacity>::Touches TouchTrackerN<Capacity>::filterTouchesXYAdaptive(const Touches& in, const Touches& inz1)
+{
+	// these filter settings have a big and sort of delicate impact on play feel, so they are not user settable
+	const float kFixedXYFreqMax = 20.f;
+	const float kFixedXYFreqMin = 1.f;
+	
+    Touches out{};
+	
+	for(int i=0; i<mMaxTouchesPerFrame; ++i)
+	{
+		float x = in[i].x;
+		float y = in[i].y;
+		float z = in[i].z;
+		int age = in[i].age; 
+		
+		float x1 = inz1[i].x;
+		float y1 = inz1[i].y;
+		
+		// filter, or not, based on w from matchTouches
+		float newX, newY;
+		if(age > 0) 
+		{
+			// get xy coeffs, adaptive based on z
+			float freq = mapAndClipRange(0., 0.02, kFixedXYFreqMin, kFixedXYFreqMax, z); 			
+			float omegaXY = freq*kTwoPi/mSampleRate;
+			float kXY = expf(-omegaXY);
+			float a0XY = 1.f - kXY;
+			float b1XY = kXY;
+			
+			// onepole filters			
+			newX = (x*a0XY) + (x1*b1XY);
+			newY = (y*a0XY) + (y1*b1XY);		
+		}
+		else
+		{
+			newX = x;
+			newY = y;
+		}
+		
+        out[i] = Touch{.x = newX, .y = newY, .z = z, .age = age};
+	}
+	
+	return out;
+}
+
+template<int Capacity>
+typename TouchTrackerN<Capacity>::Touches TouchTrackerN<Capacity>::filterTouchesZ(const Touches& in, const Touches& inz1, float upFreq, float downFreq)
+{
+	const float omegaUp = upFreq*kTwoPi/mSampleRate;
+	const float kUp = expf(-omegaUp);
+	const float a0Up = 1.f - kUp;
+	const float b1Up = kUp;
+	const float omegaDown = downFreq*kTwoPi/mSampleRate;
+	const float kDown = expf(-omegaDown);
+	const float a0Down = 1.f - kDown;
+	const float b1Down = kDown;
+	
+    Touches out{};
+	
+	for(int i=0; i<mMaxTouchesPerFrame; ++i)
+	{
+		float x = in[i].x;
+		float y = in[i].y;
+		float z = in[i].z;
+
+		float z1 = inz1[i].z;
+		int age1 = inz1[i].age;		
+
+        float newZ;
+		
+		// filter z variable
+		float dz = z - z1;
+		if(dz > 0.f)
+		{
+			newZ = (z*a0Up) + (z1*b1Up);
+		}
+		else
+		{
+			newZ = (z*a0Down) + (z1*b1Down);				
+		}	
+		
+		// gate with hysteresis
+        bool gate1 = (age1 > 0);
+        bool newGate = gate1;
+		if(newZ > mOnThreshold)
+		{
+			newGate = true;
+		}
+		else if (newZ < mOffThreshold)
+		{
+			newGate = false;
+		}
+		
+		// increment age
+        int newAge = newGate ? (age1 + 1) : 0;
+
+        // set state
+        int newState = newGate ? (gate1 ? kTouchStateContinue : kTouchStateOn) : (gate1 ? kTouchStateOff : kTouchStateInactive);
+		
+        out[i] = Touch{.x=x, .y=y, .z=newZ, .dz=dz, .age=newAge, .state=newState};
+	}
+	
+	return out;
+}
+
+// if a touch has decayed below the filter threshold after z filtering, move it off the scene so it won't match to other nearby touches.
+template<int Capacity>
+typename TouchTrackerN<Capacity>::Touches TouchTrackerN<Capacity>::exileUnusedTouches(const Touches& preFiltered, const Touches& postFiltered)
+{
+	Touches out(preFiltered);
+	for(int i = 0; i < mMaxTouchesPerFrame; ++i)
+	{
+		Touch a = preFiltered[i];
+		Touch b = postFiltered[i];
+		
+		if(b.x > 0.f)
+		{
+			if(b.z <= mFilterThreshold) 
+			{
+				a.x = (-1.f);
+				a.y = (-10.f);
+				a.z = (0.f);
+			}
+		}
+		
+		out[i] = a;					
+	}
+	return out;
+}
+
+// rotate order of touches, changing order every time there is a new touch in a frame.
+// side effect: writes to mRotateShuffleOrder
+template<int Capacity>
+typename TouchTrackerN<Capacity>::Touches TouchTrackerN<Capacity>::rotateTouches(const Touches& in)
+{	
+	Touches touches(in);
+	if(mMaxTouchesPerFrame > 1)
+	{		
+		bool doRotate = false;
+		for(int i = 0; i < mMaxTouchesPerFrame; ++i)
+		{
+			if(in[i].age == 1)
+			{
+				// we have a new touch at index i.
+				doRotate = true;
+				break;
+			}
+		}
+		
+		if(doRotate)
+		{
+			// rotate the indices of all free or new touches in the shuffle order		
+			int nFree = 0;
+			std::array<int, Capacity> freeIndexes;
+			
+			for(int i=0; i<mMaxTouchesPerFrame; ++i)
+			{
+				if((in[i].z < mFilterThreshold) || (in[i].age == 1))
+				{
+					freeIndexes[nFree++] = i;
+				}
+			}
+					
+			if(nFree > 1)
+			{
+				int first = mRotateShuffleOrder[freeIndexes[0]];
+				for(int i=0; i < nFree - 1; ++i)
+				{				
+					mRotateShuffleOrder[freeIndexes[i]] = mRotateShuffleOrder[freeIndexes[i + 1]];
+				}
+				mRotateShuffleOrder[freeIndexes[nFree - 1]] = first;
+			}
+		}
+
+		// shuffle
+		for(int i = 0; i < mMaxTouchesPerFrame; ++i)
+		{
+			touches[mRotateShuffleOrder[i]] = in[i];
+		}
+	}
+	return touches;
+}
+
+template<int Capacity>
+typename TouchTrackerN<Capacity>::Touches TouchTrackerN<Capacity>::clampAndScaleTouches(const Touches& in)
+{
+	const float kTouchOutputScale = 4.f;
+    Touches out{};
+	for(int i = 0; i < mMaxTouchesPerFrame; ++i)
+	{
+		Touch t = in[i];
+		
+		if(t.x != t.x)
+		{
+			t.x = (0.f);
+		}
+		if(t.y != t.y)
+		{
+			t.y = (0.f);
+		}
+				
+		out[i] = t;			
+		float newZ = (clamp((t.z - mOnThreshold)*kTouchOutputScale, 0.f, 8.f));
+		if(t.age == 0)
+		{
+			newZ = 0.f;
+		}
+		out[i].z = (newZ);
+	}
+	return out;
+}
+
+// the capacities in Touch.h.
+template class TouchTrackerN<kMinTouchCapacity>;
+template class TouchTrackerN<kDefaultTouchCapacity>;
+template class TouchTrackerN<kMaxTouches>;
+
+template TouchArrayN<kMinTouchCapacity> scaleTouchPressure(const TouchArrayN<kMinTouchCapacity>&, float, float);
+template TouchArrayN<kDefaultTouchCapacity> scaleTouchPressure(const TouchArrayN<kDefaultTouchCapacity>&, float, float);
+template TouchArrayN<kMaxTouches> scaleTouchPressure(const TouchArrayN<kMaxTouches>&, float, float);
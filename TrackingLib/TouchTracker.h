@@ -0,0 +1,85 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include "SensorFrame.h"
+#include "Touch.h"
+
+// box filters used by the preprocessor. The output-parameter versions may be used in place.
+SensorFrame smoothPressureX(const SensorFrame& in);
+SensorFrame smoothPressureY(const SensorFrame& in);
+void smoothPressureX(SensorFrame& out, const SensorFrame& in);
+void smoothPressureY(SensorFrame& out, const SensorFrame& in);
+
+// c over [0 - 1] fades response from sqrt(x) -> x -> x^2
+float responseCurve(float x, float c);
+
+// scale the pressure and note-on velocity of tracked touches for output, with the same
+// response curve for both.
+template<int Capacity>
+TouchArrayN<Capacity> scaleTouchPressure(const TouchArrayN<Capacity>& in, float zScale, float zCurve);
+
+// finds and follows up to Capacity touches. Every per-frame copy and loop is sized by the
+// capacity, so a tracker for a few touches does much less work than one for many. Built for
+// each of the capacities in Touch.h. TouchTracker is the one for kMaxTouches.
+template<int Capacity>
+class TouchTrackerN
+{
+public:
+	typedef TouchArrayN<Capacity> Touches;
+	
+	TouchTrackerN();
+	~TouchTrackerN();
+	
+	void clear();
+	void setRotate(bool b);	
+	void setThresh(float f);
+	void setLopassZ(float k); 	
+	
+    // preprocess input to get curvature
+    SensorFrame preprocess(const SensorFrame& in);
+    
+    // preprocess input to get curvature, writing the result to out without making any temporary frames.
+    void preprocess(const SensorFrame& in, SensorFrame& out);
+    
+	// process input and get touches. returns one frame of touch data. changes history of many filters.
+	Touches process(const SensorFrame& in, int maxTouches);
+	
+	// the first stages of process(), which can be run separately to measure them.
+	// findTouches() finds up to the number of touches given to setMaxTouches().
+	void setMaxTouches(int t);
+	Touches findTouches(const SensorFrame& in);
+	Touches matchTouches(const Touches& x, const Touches& x1);
+	
+private:
+
+	float mSampleRate;	
+	int mMaxTouchesPerFrame;
+	float mLopassZ;	
+	bool mRotate;	
+	
+	float mFilterThreshold;
+	float mOnThreshold;
+	float mOffThreshold;
+	
+    SensorFrame mInput{};
+    SensorFrame mInputZ1{};
+	
+    Touches mTouches{};
+    Touches mTouchesMatch1{};
+    Touches mTouches2{}; 
+	
+	std::array<int, Capacity> mRotateShuffleOrder;
+	
+	Touches rotateTouches(const Touches& t);
+	Touches filterTouchesXYAdaptive(const Touches& x, const Touches& x1);
+	Touches filterTouchesZ(const Touches& x, const Touches& x1, float upFreq, float downFreq);
+	Touches exileUnusedTouches(const Touches& x1, const Touches& x2);
+	Touches clampAndScaleTouches(const Touches& x);
+	void outputTouches(Touches touches);
+};
+
+typedef TouchTrackerN<kMaxTouches> TouchTracker;
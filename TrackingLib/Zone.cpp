@@ -8,17 +8,40 @@
 
 #include "Zone.h"
 
-const ml::Symbol zoneTypes[kZoneTypes] = {"note_row", "x", "y", "xy", "z", "toggle"};
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+const char* const zoneTypes[kZoneTypes] = {"note_row", "x", "y", "xy", "z", "toggle"};
 const float kVibratoFilterFreq = 12.0f;
 const float kSoundplaneVibratoAmount = 5.;
 
+namespace
+{
+
+inline float clamp(float x, float lo, float hi)
+{
+    return std::min(std::max(x, lo), hi);
+}
+
+}
+
+void OnePoleFilter::setOnePole(float f)
+{
+    const float kTwoPi = 3.1415926535f*2.f;
+    const float x = expf(-kTwoPi*f*mInvSampleRate);
+    mA0 = 1.f - x;
+    mB1 = x;
+}
+
 // turn zone type name into enum type. names above must match ZoneType enum.
-int Zone::symbolToZoneType(ml::Symbol s)
+template<int Capacity>
+int ZoneN<Capacity>::nameToZoneType(const char* name)
 {
     int zoneTypeNum = -1;
     for(int i=0; i<kZoneTypes; ++i)
     {
-        if(s == zoneTypes[i])
+        if(name && !strcmp(name, zoneTypes[i]))
         {
             zoneTypeNum = i;
             break;
@@ -27,19 +50,17 @@ int Zone::symbolToZoneType(ml::Symbol s)
     return zoneTypeNum;
 }
 
-Zone::Zone()
+template<int Capacity>
+ZoneN<Capacity>::ZoneN()
 {
-    mNoteFilters.resize(kMaxTouches);
-	mVibratoFilters.resize(kMaxTouches);
-
-    for(int i=0; i<kMaxTouches; ++i)
+    for(int i=0; i<Capacity; ++i)
     {
         mTouches0[i] = Touch{};
         mTouches1[i] = Touch{};
         mStartTouches[i] = Touch{};
     }
     
-	for(int i=0; i<kMaxTouches; ++i)
+	for(int i=0; i<Capacity; ++i)
 	{
 		mNoteFilters[i].setSampleRate(kSoundplaneFrameRate);
 		mNoteFilters[i].setOnePole(250.0f);
@@ -48,44 +69,82 @@ Zone::Zone()
 	}
 }
 
-void Zone::setBounds(MLRect b)
+template<int Capacity>
+void ZoneN<Capacity>::setBounds(KeyRect b)
 {
     mBounds = b;
-    mXRange = MLRange(0., 1., b.left(), b.right());
-    mYRange = MLRange(0., 1., b.top(), b.bottom());
-    mXRangeInv = MLRange(b.left(), b.right(), 0., 1.);
-    mYRangeInv = MLRange(b.top(), b.bottom(), 0., 1.);
+    mXRange = LinearRange(0., 1., b.left(), b.right());
+    mYRange = LinearRange(0., 1., b.top(), b.bottom());
+    mXRangeInv = LinearRange(b.left(), b.right(), 0., 1.);
+    mYRangeInv = LinearRange(b.top(), b.bottom(), 0., 1.);
     
-    mScaleMap.setDims(b.width() + 1);
+    mScaleMap.resize(b.width() + 1);
     // setup chromatic scale
-    for(int i=0; i<mScaleMap.getWidth(); ++i)
+    for(int i=0; i<static_cast<int>(mScaleMap.size()); ++i)
     {
         mScaleMap[i] = i;
     }
 }
 
+template<int Capacity>
+void ZoneN<Capacity>::setControllerNumbers(int n1, int n2, int n3)
+{
+    mControllerNum1 = n1;
+    mControllerNum2 = n2;
+    mControllerNum3 = n3;
+}
+
+template<int Capacity>
+void ZoneN<Capacity>::setParameters(const ZoneParameters& p)
+{
+    mVibrato = p.vibrato;
+    mHysteresis = p.hysteresis;
+    mQuantize = p.quantize;
+    mNoteLock = p.noteLock;
+    mTranspose = p.transpose;
+    setSnapFreq(p.snap);
+}
+
+// linear interpolation in the scale map, clamped to its ends.
+template<int Capacity>
+float ZoneN<Capacity>::interpolateScaleMap(float x) const
+{
+    const int n = mScaleMap.size();
+    if(n < 2) return n ? mScaleMap[0] : 0.f;
+    const float xc = clamp(x, 0.f, n - 1.f);
+    const int i = std::min(static_cast<int>(xc), n - 2);
+    const float m = xc - i;
+    return mScaleMap[i] + m*(mScaleMap[i + 1] - mScaleMap[i]);
+}
+
 // input: approx. snap time in ms
-void Zone::setSnapFreq(float f)
+template<int Capacity>
+void ZoneN<Capacity>::setSnapFreq(float f)
 {
     float snapFreq = 1000.f / (f + 1.);
-    snapFreq = ml::clamp(snapFreq, 1.f, 1000.f);
-    for(int i=0; i<kMaxTouches; ++i)
+    snapFreq = clamp(snapFreq, 1.f, 1000.f);
+    for(int i=0; i<Capacity; ++i)
     {
         mNoteFilters[i].setOnePole(snapFreq);
     }
 }
 
-void Zone::newFrame()
+template<int Capacity>
+void ZoneN<Capacity>::newFrame(std::chrono::steady_clock::time_point time)
 {
-    for(int i=0; i<kMaxTouches; ++i)
+    for(int i=0; i<Capacity; ++i)
     {
         mTouches1[i] = mTouches0[i];
         mTouches0[i] = Touch{};
         mOutputTouches[i] = Touch{};
     }
+    mTouches1.time = mTouches0.time;
+    mTouches0.time = time;
+    mOutputTouches.time = time;
 }
 
-void Zone::addTouchToFrame(int i, Touch t)
+template<int Capacity>
+void ZoneN<Capacity>::addTouchToFrame(int i, Touch t)
 {
     // MLTEST
     // debug() << "zone " << mName << " adding touch " << t << " at " << x << ", " << y << "\n";
@@ -97,9 +156,10 @@ void Zone::addTouchToFrame(int i, Touch t)
     mTouches0[i] = u;
 }
 
-void Zone::storeAnyNewTouches()
+template<int Capacity>
+void ZoneN<Capacity>::storeAnyNewTouches()
 {
-    for(int i=0; i<kMaxTouches; ++i)
+    for(int i=0; i<Capacity; ++i)
     {
         // store start of touch
         if (touchIsActive(mTouches0[i]) && !(touchIsActive(mTouches1[i])))
@@ -109,10 +169,11 @@ void Zone::storeAnyNewTouches()
     }
 }
 
-int Zone::getNumberOfActiveTouches() const
+template<int Capacity>
+int ZoneN<Capacity>::getNumberOfActiveTouches() const
 {
     int activeTouches = 0;
-    for(int i=0; i<kMaxTouches; ++i)
+    for(int i=0; i<Capacity; ++i)
     {
         if(touchIsActive(mTouches0[i]))
         {
@@ -122,10 +183,11 @@ int Zone::getNumberOfActiveTouches() const
     return activeTouches;
 }
 
-int Zone::getNumberOfNewTouches() const
+template<int Capacity>
+int ZoneN<Capacity>::getNumberOfNewTouches() const
 {
     int newTouches = 0;
-    for(int i=0; i<kMaxTouches; ++i)
+    for(int i=0; i<Capacity; ++i)
     {
         if(touchIsActive(mTouches0[i]) && (!touchIsActive(mTouches1[i])))
         {
@@ -135,30 +197,36 @@ int Zone::getNumberOfNewTouches() const
     return newTouches;
 }
 
-Vec3 Zone::getAveragePositionOfActiveTouches() const
+template<int Capacity>
+void ZoneN<Capacity>::getAveragePositionOfActiveTouches(float& x, float& y) const
 {
-    Vec2 avg;
+    float sumX = 0.f;
+    float sumY = 0.f;
     int activeTouches = 0;
-    for(int i=0; i<kMaxTouches; ++i)
+    for(int i=0; i<Capacity; ++i)
     {
         Touch t = mTouches0[i];
         if(touchIsActive(t))
         {
-            avg += Vec2{t.x, t.y};
+            sumX += t.x;
+            sumY += t.y;
             activeTouches++;
         }
     }
     if(activeTouches > 0)
     {
-        avg *= (1.f / (float)activeTouches);
+        sumX *= (1.f / (float)activeTouches);
+        sumY *= (1.f / (float)activeTouches);
     }
-    return avg;
+    x = sumX;
+    y = sumY;
 }
 
-float Zone::getMaxZOfActiveTouches() const
+template<int Capacity>
+float ZoneN<Capacity>::getMaxZOfActiveTouches() const
 {
     float maxZ = 0.f;
-    for(int i=0; i<kMaxTouches; ++i)
+    for(int i=0; i<Capacity; ++i)
     {
         Touch t = mTouches0[i];
         if(touchIsActive(t))
@@ -175,7 +243,8 @@ float Zone::getMaxZOfActiveTouches() const
 
 // after all touches for a frame have been received using addTouchToFrame, generate
 // any needed messages about the frame and prepare for the next frame. 
-void Zone::processTouches(const std::bitset<kMaxTouches>& freedTouches)
+template<int Capacity>
+void ZoneN<Capacity>::processTouches(const std::bitset<Capacity>& freedTouches)
 {
     switch(mType)
     {
@@ -200,9 +269,10 @@ void Zone::processTouches(const std::bitset<kMaxTouches>& freedTouches)
     }
 }
 
-void Zone::processTouchesNoteRow(const std::bitset<kMaxTouches>& freedTouches)
+template<int Capacity>
+void ZoneN<Capacity>::processTouchesNoteRow(const std::bitset<Capacity>& freedTouches)
 {
-    for(int i=0; i<kMaxTouches; ++i)
+    for(int i=0; i<Capacity; ++i)
     {
         Touch t1 = mTouches0[i];
         Touch t2 = mTouches1[i];
@@ -246,7 +316,7 @@ void Zone::processTouchesNoteRow(const std::bitset<kMaxTouches>& freedTouches)
         }
         else
         {
-            scaleNote = mScaleMap.getInterpolatedLinear(touchPos - 0.5f);
+            scaleNote = interpolateScaleMap(touchPos - 0.5f);
         }
 
         if(isActive && !wasActive)
@@ -262,15 +332,15 @@ void Zone::processTouchesNoteRow(const std::bitset<kMaxTouches>& freedTouches)
             if(retrig)
             {
                 // sliding from key to key- get retrigger velocity from current z
-                t1dz = ml::clamp(t1z * 0.01f, 0.0001f, 1.f);
+                t1dz = clamp(t1z * 0.01f, 0.0001f, 1.f);
             }
             else
             {
                 // clamp note-on dz for use as velocity later.
-                t1dz = ml::clamp(t1dz, 0.0001f, 1.f);
+                t1dz = clamp(t1dz, 0.0001f, 1.f);
             }
             float note = mStartNote + mTranspose + scaleNote;
-            mOutputTouches[i] = Touch{.x = t1x, .y = t1y, .z = t1z, .dz = t1dz, .note = note, .state = kTouchStateOn};
+            mOutputTouches[i] = Touch{.x = t1x, .y = t1y, .z = t1z, .dz = t1dz, .state = kTouchStateOn, .note = note};
         }
         else if(isActive)
         {
@@ -282,16 +352,17 @@ void Zone::processTouchesNoteRow(const std::bitset<kMaxTouches>& freedTouches)
             float vibratoHP = (currentXPos - vibratoX)*mVibrato*kSoundplaneVibratoAmount;
             
             float note = mStartNote + mTranspose + scaleNote + vibratoHP;
-            mOutputTouches[i] = Touch{.x = t1x, .y = t1y, .z = t1z, .dz = t1dz, .note = note, .state = kTouchStateContinue, .vibrato = vibratoHP};
+            mOutputTouches[i] = Touch{.x = t1x, .y = t1y, .z = t1z, .dz = t1dz, .state = kTouchStateContinue, .note = note, .vibrato = vibratoHP};
         }
     }
 }
 
 // process any note offs. called by the model for all zones before processTouches() so that any new
 // notes with the same index as an expiring one will have a chance to get started.
-void Zone::processTouchesNoteOffs(std::bitset<kMaxTouches>& freedTouches)
+template<int Capacity>
+void ZoneN<Capacity>::processTouchesNoteOffs(std::bitset<Capacity>& freedTouches)
 {
-    for(int i=0; i<kMaxTouches; ++i)
+    for(int i=0; i<Capacity; ++i)
     {
         Touch t1 = mTouches0[i];
         Touch t2 = mTouches1[i];
@@ -300,7 +371,7 @@ void Zone::processTouchesNoteOffs(std::bitset<kMaxTouches>& freedTouches)
         
         float t2x = t2.x;
         float xPos = mXRange(t2x) - mBounds.left();
-        xPos = ml::clamp(xPos, 0.f, mBounds.width());
+        xPos = clamp(xPos, 0.f, static_cast<float>(mBounds.width()));
         float scaleNote;
         if(mQuantize)
         {
@@ -308,7 +379,7 @@ void Zone::processTouchesNoteOffs(std::bitset<kMaxTouches>& freedTouches)
         }
         else
         {
-            scaleNote = mScaleMap.getInterpolatedLinear(xPos - 0.5f);
+            scaleNote = interpolateScaleMap(xPos - 0.5f);
         }
         if(wasActive)
         {
@@ -323,50 +394,57 @@ void Zone::processTouchesNoteOffs(std::bitset<kMaxTouches>& freedTouches)
                 else
                 {
                     float lastX = mXRange(t2.x) - mBounds.left();
-                    lastScaleNote = mScaleMap.getInterpolatedLinear(lastX - 0.5f);
+                    lastScaleNote = interpolateScaleMap(lastX - 0.5f);
                 }
                 freedTouches[i] = true;
 
                 // set state
                 float note = mStartNote + mTranspose + lastScaleNote;
-                mOutputTouches[i] = Touch{.x = t2.x, .y = t2.y, .z = t2.z, .dz = t2.dz, .note = note, .state = kTouchStateOff};
+                mOutputTouches[i] = Touch{.x = t2.x, .y = t2.y, .z = t2.z, .dz = t2.dz, .state = kTouchStateOff, .note = note};
             }
         }
     }
 }
 
-void Zone::processTouchesControllerX()
+template<int Capacity>
+void ZoneN<Capacity>::processTouchesControllerX()
 {
     if(getNumberOfActiveTouches() > 0)
     {
-        Vec3 avgPos = getAveragePositionOfActiveTouches();
-        float xVal = ml::clamp(avgPos.x(), 0.f, 1.f);
+        float avgX, avgY;
+        getAveragePositionOfActiveTouches(avgX, avgY);
+        float xVal = clamp(avgX, 0.f, 1.f);
         mOutputController = Controller{.name="x", .active=true, .number1=mControllerNum1, .x=xVal};
     }
 }
 
-void Zone::processTouchesControllerY()
+template<int Capacity>
+void ZoneN<Capacity>::processTouchesControllerY()
 {
     if(getNumberOfActiveTouches() > 0)
     {
-        Vec3 avgPos = getAveragePositionOfActiveTouches();
-        float yVal = ml::clamp(avgPos.y(), 0.f, 1.f);
+        float avgX, avgY;
+        getAveragePositionOfActiveTouches(avgX, avgY);
+        float yVal = clamp(avgY, 0.f, 1.f);
         mOutputController = Controller{.name="y", .active=true, .number1=mControllerNum1, .y=yVal};
     }    
 }
 
-void Zone::processTouchesControllerXY()
+template<int Capacity>
+void ZoneN<Capacity>::processTouchesControllerXY()
 {
     if(getNumberOfActiveTouches() > 0)
     {
-        Vec3 avgPos = getAveragePositionOfActiveTouches();
-        float xVal = ml::clamp(avgPos.x(), 0.f, 1.f);
-        float yVal = ml::clamp(avgPos.y(), 0.f, 1.f);
+        float avgX, avgY;
+        getAveragePositionOfActiveTouches(avgX, avgY);
+        float xVal = clamp(avgX, 0.f, 1.f);
+        float yVal = clamp(avgY, 0.f, 1.f);
         mOutputController = Controller{.name="xy", .active=true, .number1=mControllerNum1, .number2=mControllerNum2, .x=xVal, .y=yVal};
     }
 }
 
-void Zone::processTouchesControllerToggle()
+template<int Capacity>
+void ZoneN<Capacity>::processTouchesControllerToggle()
 {
     bool touchOn = getNumberOfNewTouches() > 0;
     if(touchOn)
@@ -377,10 +455,14 @@ void Zone::processTouchesControllerToggle()
     }
 }
 
-void Zone::processTouchesControllerPressure()
+template<int Capacity>
+void ZoneN<Capacity>::processTouchesControllerPressure()
 {
-    float zVal = ml::clamp(getMaxZOfActiveTouches(), 0.f, 1.f);
+    float zVal = clamp(getMaxZOfActiveTouches(), 0.f, 1.f);
     mOutputController = Controller{.name="z", .active=true, .number1=mControllerNum1, .z=zVal};
 }
 
-
+// the capacities in Touch.h.
+template class ZoneN<kMinTouchCapacity>;
+template class ZoneN<kDefaultTouchCapacity>;
+template class ZoneN<kMaxTouches>;
@@ -0,0 +1,260 @@
+//
+//  Zone.h
+//  Soundplane
+//
+//  Created by Randy Jones on 10/18/13.
+//
+//
+
+#pragma once
+
+#include "SensorFrame.h"
+#include "Touch.h"
+#include "Controller.h"
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <string>
+#include <vector>
+
+enum ZoneType
+{
+    kZoneNoteRow,
+    kZoneControllerX,
+    kZoneControllerY,
+    kZoneControllerXY,
+    kZoneControllerZ,
+    kZoneToggle,
+    kZoneTypes
+};
+
+const int kZoneValArraySize = 8;
+
+// a rectangle of keys in the key grid.
+struct KeyRect
+{
+    int mX{0};
+    int mY{0};
+    int mWidth{0};
+    int mHeight{0};
+
+    KeyRect() {}
+    KeyRect(int x, int y, int w, int h) : mX(x), mY(y), mWidth(w), mHeight(h) {}
+
+    int x() const { return mX; }
+    int y() const { return mY; }
+    int width() const { return mWidth; }
+    int height() const { return mHeight; }
+    int left() const { return mX; }
+    int right() const { return mX + mWidth; }
+    int top() const { return mY; }
+    int bottom() const { return mY + mHeight; }
+};
+
+// linear map from [a, b] to [c, d].
+struct LinearRange
+{
+    float mScale{1.f};
+    float mOffset{0.f};
+
+    LinearRange() {}
+    LinearRange(float a, float b, float c, float d) :
+        mScale((d - c)/(b - a)), mOffset(c - a*(d - c)/(b - a)) {}
+
+    float operator()(float x) const { return x*mScale + mOffset; }
+};
+
+// one-pole lowpass filter for smoothing notes and finding vibrato.
+class OnePoleFilter
+{
+public:
+    void setSampleRate(float sr) { mInvSampleRate = 1.f/sr; }
+    void setOnePole(float f);
+    void setState(float x) { mY1 = x; }
+    float processSample(float x)
+    {
+        mY1 = mA0*x + mB1*mY1;
+        return mY1;
+    }
+
+private:
+    float mInvSampleRate{1.f};
+    float mA0{1.f};
+    float mB1{0.f};
+    float mY1{0.f};
+};
+
+// settings shared by all the zones, from the model's properties.
+struct ZoneParameters
+{
+    float vibrato{0.f};
+    float hysteresis{0.f};
+    bool quantize{false};
+    bool noteLock{false};
+    int transpose{0};
+
+    // approx. snap time in ms
+    float snap{250.f};
+};
+
+// a zone on the key grid, with the state of up to Capacity touches in it. Built for each of
+// the capacities in Touch.h. Zone is the one for kMaxTouches.
+template<int Capacity>
+class ZoneN
+{
+public:
+    typedef TouchArrayN<Capacity> Touches;
+
+    ZoneN();
+    ~ZoneN() {}
+
+    // copy a zone of another capacity, with as many of its touches as fit.
+    template<int OtherCapacity>
+    explicit ZoneN(const ZoneN<OtherCapacity>& z);
+
+    // turn a zone type name such as "note_row" into a ZoneType, or -1 if there is none.
+    static int nameToZoneType(const char* name);
+
+    // start a frame of touches made by the device at the given time.
+    void newFrame(std::chrono::steady_clock::time_point time);
+    void addTouchToFrame(int i, Touch t);
+    void storeAnyNewTouches();
+
+    void processTouches(const std::bitset<Capacity>& freedTouches);
+    void processTouchesNoteRow(const std::bitset<Capacity>& freedTouches);
+    void processTouchesNoteOffs(std::bitset<Capacity>& freedTouches);
+
+    const Touch touchToKeyPos(const Touch& t) const
+    {
+        Touch u = t;
+        u.x = mXRange(t.x);
+        u.y = mYRange(t.y);
+        return u;
+    }
+
+    const Touch getTouch(int i) const { return mTouches1[i]; }
+
+    const std::string& getName() const { return mName; }
+    KeyRect getBounds() const { return mBounds; }
+	int getType() const { return mType; }
+	int getOffset() const { return mOffset; }
+    int getZoneID() const { return mZoneID; }
+
+    // the states made by the last processTouches(), which the outputs send.
+    const Touches& getOutputTouches() const { return mOutputTouches; }
+    const Controller& getController() const { return mOutputController; }
+
+    void setType(int t) { mType = t; }
+    void setName(const std::string& name) { mName = name; }
+    void setStartNote(int n) { mStartNote = n; }
+    void setOffset(int o) { mOffset = o; }
+    void setControllerNumbers(int n1, int n2, int n3);
+    void setZoneID(int z) { mZoneID = z; }
+    void setParameters(const ZoneParameters& p);
+    void setSnapFreq(float f);
+
+    // set bounds in key grid
+    void setBounds(KeyRect b);
+
+protected:
+    template<int OtherCapacity> friend class ZoneN;
+
+    KeyRect mBounds;
+    LinearRange mXRange;
+    LinearRange mYRange;
+    LinearRange mXRangeInv;
+    LinearRange mYRangeInv;
+
+    int mZoneID{0};
+    int mType{-1};
+    int mStartNote{60};
+
+    float mVibrato{0};
+    float mHysteresis{0};
+    bool mQuantize{false};
+    bool mNoteLock{false};
+    int mTranspose{0};
+
+    // start note falls on this degree of scale-- for diatonic and other non-chromatic scales
+    int mScaleNoteOffset = 0;
+
+    // TODO make a scale object instead
+    std::vector<float> mScaleMap{};
+
+    int mControllerNum1{0};
+    int mControllerNum2{0};
+    int mControllerNum3{0};
+
+    bool mToggleValue{};
+    int mOffset{0};
+    std::string mName{"unnamed zone"};
+
+    // states read by the Model to generate output
+    Touches mOutputTouches{};
+    Controller mOutputController{};
+
+private:
+    int getNumberOfActiveTouches() const;
+    int getNumberOfNewTouches() const;
+    void getAveragePositionOfActiveTouches(float& x, float& y) const;
+    float getMaxZOfActiveTouches() const;
+    float interpolateScaleMap(float x) const;
+
+    void processTouchesControllerX();
+    void processTouchesControllerY();
+    void processTouchesControllerXY();
+    void processTouchesControllerToggle();
+    void processTouchesControllerPressure();
+
+    // touch locations are stored scaled to [0..1] over the Zone boundary.
+    // incoming touches
+    Touches mTouches0{};
+    // touch positions this frame
+    Touches mTouches1{};
+    // touch positions saved at touch onsets
+    Touches mStartTouches{};
+
+	std::array<OnePoleFilter, Capacity> mNoteFilters;
+	std::array<OnePoleFilter, Capacity> mVibratoFilters;
+};
+
+typedef ZoneN<kMaxTouches> Zone;
+
+template<int Capacity>
+template<int OtherCapacity>
+ZoneN<Capacity>::ZoneN(const ZoneN<OtherCapacity>& z) : ZoneN()
+{
+    mBounds = z.mBounds;
+    mXRange = z.mXRange;
+    mYRange = z.mYRange;
+    mXRangeInv = z.mXRangeInv;
+    mYRangeInv = z.mYRangeInv;
+    mZoneID = z.mZoneID;
+    mType = z.mType;
+    mStartNote = z.mStartNote;
+    mVibrato = z.mVibrato;
+    mHysteresis = z.mHysteresis;
+    mQuantize = z.mQuantize;
+    mNoteLock = z.mNoteLock;
+    mTranspose = z.mTranspose;
+    mScaleNoteOffset = z.mScaleNoteOffset;
+    mScaleMap = z.mScaleMap;
+    mControllerNum1 = z.mControllerNum1;
+    mControllerNum2 = z.mControllerNum2;
+    mControllerNum3 = z.mControllerNum3;
+    mToggleValue = z.mToggleValue;
+    mOffset = z.mOffset;
+    mName = z.mName;
+    mOutputController = z.mOutputController;
+
+    copyTouches(mOutputTouches, z.mOutputTouches);
+    copyTouches(mTouches0, z.mTouches0);
+    copyTouches(mTouches1, z.mTouches1);
+    copyTouches(mStartTouches, z.mStartTouches);
+    for(int i=0; i<std::min(Capacity, OtherCapacity); ++i)
+    {
+        mNoteFilters[i] = z.mNoteFilters[i];
+        mVibratoFilters[i] = z.mVibratoFilters[i];
+    }
+}
@@ -0,0 +1,138 @@
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "ZoneMap.h"
+
+#include <algorithm>
+
+template<int Capacity>
+ZoneMapN<Capacity>::ZoneMapN()
+{
+	for(int i=0; i<Capacity; ++i)
+	{
+		mCurrentKeyX[i] = -1;
+		mCurrentKeyY[i] = -1;
+	}
+	clear();
+}
+
+template<int Capacity>
+void ZoneMapN<Capacity>::clear()
+{
+	mZones.clear();
+	mZoneIndexMap.fill(-1);
+}
+
+template<int Capacity>
+bool ZoneMapN<Capacity>::addZone(const ZoneType& zone)
+{
+	const int zoneIdx = mZones.size();
+	if(zoneIdx >= kSoundplaneAMaxZones) return false;
+
+	mZones.push_back(zone);
+	mZones.back().setZoneID(zoneIdx);
+
+	const KeyRect b = zone.getBounds();
+	for(int j=std::max(b.top(), 0); j < std::min(b.bottom(), kSoundplaneAKeyHeight); ++j)
+	{
+		for(int i=std::max(b.left(), 0); i < std::min(b.right(), kSoundplaneAKeyWidth); ++i)
+		{
+			mZoneIndexMap[j*kSoundplaneAKeyWidth + i] = zoneIdx;
+		}
+	}
+	return true;
+}
+
+template<int Capacity>
+void ZoneMapN<Capacity>::setParameters(const ZoneParameters& p)
+{
+	mHysteresis = p.hysteresis;
+	for(auto& zone : mZones)
+	{
+		zone.setParameters(p);
+	}
+}
+
+// send raw touches to zones in order to generate touch and controller states within the Zones.
+//
+template<int Capacity>
+void ZoneMapN<Capacity>::process(const Touches& touches, int maxTouches)
+{
+	// clear incoming touches and push touch history in each zone
+	for(auto& zone : mZones)
+	{
+		zone.newFrame(touches.time);
+	}
+
+	// add any active touches to the Zones they are over
+	for(int i=0; i<std::min(maxTouches, Capacity); ++i)
+	{
+		float x = touches[i].x;
+		float y = touches[i].y;
+
+		if(touchIsActive(touches[i]))
+		{
+			// get integer key
+			int ix = (int)x;
+			int iy = (int)y;
+
+			// apply hysteresis to raw position to get current key
+			// hysteresis: make it harder to move out of current key
+			if(touches[i].state == kTouchStateOn)
+			{
+				mCurrentKeyX[i] = ix;
+				mCurrentKeyY[i] = iy;
+			}
+			else
+			{
+				float hystWidth = mHysteresis*0.25f;
+				bool inCurrentKey = (x >= mCurrentKeyX[i] - hystWidth) && (x < mCurrentKeyX[i] + 1 + hystWidth) &&
+					(y >= mCurrentKeyY[i] - hystWidth) && (y < mCurrentKeyY[i] + 1 + hystWidth);
+				if(!inCurrentKey)
+				{
+					mCurrentKeyX[i] = ix;
+					mCurrentKeyY[i] = iy;
+				}
+			}
+
+			// send index, xyz, dz to zone
+			const int kx = mCurrentKeyX[i];
+			const int ky = mCurrentKeyY[i];
+			const bool onGrid = (kx >= 0) && (kx < kSoundplaneAKeyWidth) && (ky >= 0) && (ky < kSoundplaneAKeyHeight);
+			int zoneIdx = onGrid ? mZoneIndexMap[ky*kSoundplaneAKeyWidth + kx] : -1;
+			if(zoneIdx >= 0)
+			{
+				Touch t = touches[i];
+				t.kx = kx;
+				t.ky = ky;
+				mZones[zoneIdx].addTouchToFrame(i, t);
+			}
+		}
+	}
+
+	for(auto& zone : mZones)
+	{
+		zone.storeAnyNewTouches();
+	}
+
+	std::bitset<Capacity> freedTouches;
+
+	// process note offs for each zone
+	// this happens before processTouches() to allow touches to be freed
+	for(auto& zone : mZones)
+	{
+		zone.processTouchesNoteOffs(freedTouches);
+	}
+
+	// process touches for each zone
+	for(auto& zone : mZones)
+	{
+		zone.processTouches(freedTouches);
+	}
+}
+
+// the capacities in Touch.h.
+template class ZoneMapN<kMinTouchCapacity>;
+template class ZoneMapN<kDefaultTouchCapacity>;
+template class ZoneMapN<kMaxTouches>;
@@ -0,0 +1,79 @@
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "Zone.h"
+
+// the zones laid out on the key grid. Each frame of touches from the tracker is sent to the
+// zones the touches are over, and each zone makes its output touches and controller from them.
+// Built for each of the capacities in Touch.h. ZoneMap is the one for kMaxTouches.
+template<int Capacity>
+class ZoneMapN
+{
+public:
+	typedef ZoneN<Capacity> ZoneType;
+	typedef TouchArrayN<Capacity> Touches;
+
+	ZoneMapN();
+
+	// remove all zones.
+	void clear();
+
+	// add a zone, covering its bounds in the key grid. Returns false if there are already
+	// kSoundplaneAMaxZones zones. A zone of another capacity is copied to this one's.
+	bool addZone(const ZoneType& zone);
+	template<int OtherCapacity>
+	bool addZone(const ZoneN<OtherCapacity>& zone) { return addZone(ZoneType(zone)); }
+
+	void setParameters(const ZoneParameters& p);
+
+	// send a frame of touches to the zones. After this, each zone's getOutputTouches() and
+	// getController() hold the states to send to the outputs.
+	void process(const Touches& touches, int maxTouches);
+
+	// call touchFn(zone, touchIndex, touch) for each active output touch and
+	// controllerFn(zone, controller) for each active controller from the last process().
+	template<typename TouchFn, typename ControllerFn>
+	void forEachOutput(TouchFn touchFn, ControllerFn controllerFn) const
+	{
+		for(const ZoneType& zone : mZones)
+		{
+			const Touches& touches = zone.getOutputTouches();
+			for(int i=0; i<Capacity; ++i)
+			{
+				if(touchIsActive(touches[i]))
+				{
+					touchFn(zone, i, touches[i]);
+				}
+			}
+			const Controller& c = zone.getController();
+			if(c.active)
+			{
+				controllerFn(zone, c);
+			}
+		}
+	}
+
+	size_t size() const { return mZones.size(); }
+	typename std::vector<ZoneType>::const_iterator begin() const { return mZones.begin(); }
+	typename std::vector<ZoneType>::const_iterator end() const { return mZones.end(); }
+
+private:
+	std::vector<ZoneType> mZones;
+
+	// index of the zone over each key, or -1.
+	std::array<int, kSoundplaneAKeyWidth*kSoundplaneAKeyHeight> mZoneIndexMap;
+
+	float mHysteresis{0.f};
+
+	// store current key for each touch to implement hysteresis.
+	int mCurrentKeyX[Capacity];
+	int mCurrentKeyY[Capacity];
+};
+
+typedef ZoneMapN<kMaxTouches> ZoneMap;